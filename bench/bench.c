@@ -0,0 +1,50 @@
+/* Unique ANSI C Compiler */
+/* bench/bench.c - Shared code of the benchmarks */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "bench.h"
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+bench_load(Strbuf *text, char **paths, int num_paths,
+  int64 min_bytes)
+{
+  Source src;
+  int64 length = 0;
+  int i = 0;
+  /**/
+  for (i = 0; i < num_paths; i++) {
+    mem_clear(&src, sizeof(src));
+    if (!src_load(&src, paths[i])) {
+      fprintf(stderr, "%s%s%s%s", paths[i], ": ", strerror(errno),
+        "\n"
+      );
+      exit(EXIT_FAILURE);
+    }
+    sb_append_sv(text, src.text);
+    src_unload(&src);
+  }
+  length = text->length;
+  if (length == 0) {
+    fprintf(stderr, "%s", "bench: no text to run on\n");
+    exit(EXIT_FAILURE);
+  }
+  /* The copies come after the text, so it only grows. */
+  while (text->length < min_bytes) {
+    sb_append_bytes(text, text->at, length);
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+bench_print_speed(const char *name, int64 bytes, double seconds)
+{
+  printf("  %-28s %8.1f MB/s\n", name, bytes / seconds / 1e6);
+}
@@ -0,0 +1,32 @@
+/* Unique ANSI C Compiler */
+/* bench/bench.h - Shared code of the benchmarks */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS                                                */
+/*----------------------------------------------------------*/
+
+/*
+Append the files by `paths` to `text` over and over until it
+has at least `min_bytes` characters. Exits with a message if
+a file cannot be loaded or they are all empty.
+*/
+void
+bench_load(Strbuf *text, char **paths, int num_paths,
+  int64 min_bytes);
+
+/*
+Print the speed of scanning `bytes` in `seconds` as MB/s.
+*/
+void
+bench_print_speed(const char *name, int64 bytes, double seconds);
+
+#endif /* BENCH_H */
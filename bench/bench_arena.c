@@ -0,0 +1,123 @@
+/* Unique ANSI C Compiler */
+/* bench/bench_arena.c - Benchmark of Arena against mem_alloc */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Objects of a run, like the nodes of a translation unit, of
+`BENCH_MIN_SIZE` to `BENCH_MIN_SIZE + 7` bytes.
+*/
+#define BENCH_NUM_OBJECTS (1000 * 1000)
+#define BENCH_MIN_SIZE 24
+
+/*
+Runs of each allocator. The best one is printed.
+*/
+#define BENCH_NUM_RUNS 10
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Allocate and touch the objects from `arena`, then clear it.
+Returns the seconds it took.
+*/
+static double
+run_arena(Arena *arena);
+
+/*
+Allocate and touch the objects by `mem_alloc`, then free each.
+Returns the seconds it took.
+*/
+static double
+run_heap(void **objects);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+static Globals static_G;
+
+THREAD_LOCAL Globals *G = &static_G;
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(void)
+{
+  Arena arena;
+  void **objects = NULL;
+  double heap = 0;
+  double bump = 0;
+  double seconds = 0;
+  int i = 0;
+  /**/
+  mem_clear(&arena, sizeof(arena));
+  arena_init(&arena, 0);
+  objects = mem_alloc(BENCH_NUM_OBJECTS * sizeof(void *));
+  for (i = 0; i < BENCH_NUM_RUNS; i++) {
+    seconds = run_heap(objects);
+    heap = i == 0 || seconds < heap ? seconds : heap;
+    seconds = run_arena(&arena);
+    bump = i == 0 || seconds < bump ? seconds : bump;
+  }
+  printf("%s%d%s", "Allocation of ", BENCH_NUM_OBJECTS,
+    " small objects, best run\n"
+  );
+  printf("  %-28s %8.1f ms\n", "mem_alloc and mem_free", heap * 1e3);
+  printf("  %-28s %8.1f ms\n", "arena_alloc and arena_clear",
+    bump * 1e3
+  );
+  mem_free(objects);
+  arena_deinit(&arena);
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+double
+run_arena(Arena *arena)
+{
+  double start = 0;
+  char *object = NULL;
+  int i = 0;
+  /**/
+  start = time_now();
+  for (i = 0; i < BENCH_NUM_OBJECTS; i++) {
+    object = arena_alloc(arena, BENCH_MIN_SIZE + i % 8);
+    object[0] = (char)i;
+  }
+  arena_clear(arena);
+  return time_now() - start;
+}
+
+/*----------------------------------------------------------*/
+double
+run_heap(void **objects)
+{
+  double start = 0;
+  char *object = NULL;
+  int i = 0;
+  /**/
+  start = time_now();
+  for (i = 0; i < BENCH_NUM_OBJECTS; i++) {
+    object = mem_alloc(BENCH_MIN_SIZE + i % 8);
+    object[0] = (char)i;
+    objects[i] = object;
+  }
+  for (i = 0; i < BENCH_NUM_OBJECTS; i++) {
+    mem_free(objects[i]);
+  }
+  return time_now() - start;
+}
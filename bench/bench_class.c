@@ -0,0 +1,128 @@
+/* Unique ANSI C Compiler */
+/* bench/bench_class.c - Benchmark of character classes */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "bench.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+The files are repeated to be at least this long.
+*/
+#define BENCH_MIN_BYTES (32L * 1024 * 1024)
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Scan `text` like a lexer by `sv_filter` and the callbacks of
+`<ctype.h>`: skip blanks, then a word, else one character.
+Returns the number of words.
+*/
+static int64
+run_filter(Strview text);
+
+/*
+Scan `text` like `run_filter` by `sv_span_class`.
+Returns the number of words.
+*/
+static int64
+run_span(Strview text);
+
+/*
+`isalnum` or `_`, the characters of C identifiers.
+*/
+static int
+is_ident(int ch);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+static Globals static_G;
+
+THREAD_LOCAL Globals *G = &static_G;
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  Strbuf text;
+  Strview view;
+  double start = 0;
+  int64 filtered = 0;
+  int64 spanned = 0;
+  /**/
+  mem_clear(&text, sizeof(text));
+  sb_init(&text);
+  bench_load(&text, argv + 1, argc - 1, BENCH_MIN_BYTES);
+  view = sb_view(&text);
+  printf("%s%ld%s", "Lexer-like scan of ", (long)view.length,
+    " bytes, blanks then a word\n"
+  );
+  start = time_now();
+  filtered = run_filter(view);
+  bench_print_speed("sv_filter and <ctype.h>", view.length,
+    time_now() - start
+  );
+  start = time_now();
+  spanned = run_span(view);
+  bench_print_speed("sv_span_class", view.length,
+    time_now() - start
+  );
+  if (filtered != spanned) {
+    fprintf(stderr, "%s", "bench_class: the results differ\n");
+    return EXIT_FAILURE;
+  }
+  sb_deinit(&text);
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+int
+is_ident(int ch)
+{
+  return isalnum(ch) || ch == '_';
+}
+
+/*----------------------------------------------------------*/
+int64
+run_filter(Strview text)
+{
+  int64 count = 0;
+  int64 n = 0;
+  /**/
+  while (text.length > 0) {
+    text = sv_cut(text, sv_filter(text, isspace));
+    n = sv_filter(text, is_ident);
+    count += n > 0;
+    text = sv_cut(text, n > 0 ? n : 1);
+  }
+  return count;
+}
+
+/*----------------------------------------------------------*/
+int64
+run_span(Strview text)
+{
+  int64 count = 0;
+  int64 n = 0;
+  /**/
+  while (text.length > 0) {
+    text = sv_cut(text, sv_span_class(text, CC_SPACE));
+    n = sv_span_class(text, CC_IDENT);
+    count += n > 0;
+    text = sv_cut(text, n > 0 ? n : 1);
+  }
+  return count;
+}
@@ -0,0 +1,178 @@
+/* Unique ANSI C Compiler */
+/* bench/bench_find.c - Benchmark of substring search */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "bench.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+The files are repeated to be at least this long.
+*/
+#define BENCH_MIN_BYTES (8L * 1024 * 1024)
+
+/*----------------------------------------------------------*/
+/* TYPES                                                    */
+/*----------------------------------------------------------*/
+
+/*
+Search for the first or the last place of a string.
+*/
+typedef int64 (*Find)(Strview string, Strview substr);
+
+/*
+String to search for and the path of `sv_find_sv` it takes.
+*/
+typedef struct Needle {
+  const char *text;
+  const char *path;
+} Needle;
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+`sv_find_sv` as it was: `memcmp` at every offset.
+*/
+static int64
+naive_find(Strview string, Strview substr);
+
+/*
+`sv_find_sv_end` as it was: `memcmp` at every offset.
+*/
+static int64
+naive_find_end(Strview string, Strview substr);
+
+/*
+Find every place of `needle` in `text` by `find`, from the
+start if `is_forward`, else from the end, and print the speed.
+Returns the number of places.
+*/
+static int64
+run_find(const char *name, Find find, int is_forward, Strview text,
+  Strview needle);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+static Globals static_G;
+
+THREAD_LOCAL Globals *G = &static_G;
+
+/*
+Needles of the filter of first and last characters, SSE2 or
+`memchr` with `-DUACC_NO_SIMD`, and one long enough for
+Horspool's algorithm.
+*/
+static const Needle needles[] = {
+  {"*/", "first and last filter"},
+  {"#define", "first and last filter"},
+  {"the string is not found in any part of the text", "Horspool"},
+};
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  Strbuf text;
+  Strview view;
+  Strview needle;
+  int64 naive = 0;
+  int64 fast = 0;
+  int i = 0;
+  /**/
+  mem_clear(&text, sizeof(text));
+  sb_init(&text);
+  bench_load(&text, argv + 1, argc - 1, BENCH_MIN_BYTES);
+  view = sb_view(&text);
+  printf("%s%ld%s", "Substring search in ", (long)view.length,
+    " bytes\n"
+  );
+  for (i = 0; i < (int)(sizeof(needles) / sizeof(needles[0])); i++) {
+    needle = sv_cstr(needles[i].text);
+    printf("  %s%.24s%s%ld%s%s%s", "\"", needles[i].text, "\", ",
+      (long)needle.length, " chars, ", needles[i].path, "\n"
+    );
+    naive = run_find("naive forward", naive_find, 1, view, needle);
+    fast = run_find("sv_find_sv", sv_find_sv, 1, view, needle);
+    if (fast != naive) {
+      fprintf(stderr, "%s", "bench_find: the results differ\n");
+      return EXIT_FAILURE;
+    }
+    naive = run_find("naive backward", naive_find_end, 0, view, needle);
+    fast = run_find("sv_find_sv_end", sv_find_sv_end, 0, view, needle);
+    if (fast != naive) {
+      fprintf(stderr, "%s", "bench_find: the results differ\n");
+      return EXIT_FAILURE;
+    }
+  }
+  sb_deinit(&text);
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+int64
+naive_find(Strview string, Strview substr)
+{
+  int64 i = 0;
+  /**/
+  for (i = 0; i <= string.length - substr.length; i++) {
+    if (memcmp(string.at + i, substr.at, substr.length) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+int64
+naive_find_end(Strview string, Strview substr)
+{
+  int64 i = 0;
+  /**/
+  for (i = string.length - substr.length; i >= 0; i--) {
+    if (memcmp(string.at + i, substr.at, substr.length) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+int64
+run_find(const char *name, Find find, int is_forward, Strview text,
+  Strview needle)
+{
+  Strview rest;
+  double start = 0;
+  int64 count = 0;
+  int64 i = 0;
+  /**/
+  rest = text;
+  start = time_now();
+  for (;;) {
+    i = find(rest, needle);
+    if (i < 0) {
+      break;
+    }
+    count++;
+    if (is_forward) {
+      rest = sv_cut(rest, i + 1);
+    } else {
+      rest = sv_get(rest, i + needle.length - 1);
+    }
+  }
+  bench_print_speed(name, text.length, time_now() - start);
+  return count;
+}
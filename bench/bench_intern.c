@@ -0,0 +1,135 @@
+/* Unique ANSI C Compiler */
+/* bench/bench_intern.c - Benchmark of interning identifiers */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "bench.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+The identifiers of the files are taken in order, so their
+distribution is that of real code, and repeated to be at
+least this many.
+*/
+#define BENCH_MIN_WORDS (4L * 1000 * 1000)
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Push the identifiers and keywords in `text` to `words`.
+*/
+static void
+find_words(Strview text, Vector *words);
+
+/*
+Print the rate of `count` lookups done in `seconds`.
+*/
+static void
+print_rate(const char *name, int64 count, double seconds);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+static Globals static_G;
+
+THREAD_LOCAL Globals *G = &static_G;
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  Interns interns;
+  Strbuf text;
+  Vector words;
+  Strview *at = NULL;
+  double start = 0;
+  int64 num_words = 0;
+  int64 num_keywords = 0;
+  int64 misses = 0;
+  int64 i = 0;
+  int id = 0;
+  /**/
+  mem_clear(&interns, sizeof(interns));
+  mem_clear(&text, sizeof(text));
+  mem_clear(&words, sizeof(words));
+  sb_init(&text);
+  vec_init(&words, sizeof(Strview), 0);
+  bench_load(&text, argv + 1, argc - 1, 1);
+  find_words(sb_view(&text), &words);
+  num_words = words.length;
+  if (num_words == 0) {
+    fprintf(stderr, "%s", "bench_intern: no identifiers\n");
+    return EXIT_FAILURE;
+  }
+  /* Copied from the vector itself, so it must not move. */
+  vec_reserve(&words, BENCH_MIN_WORDS + num_words);
+  while (words.length < BENCH_MIN_WORDS) {
+    vec_insert(&words, words.length, words.at, num_words);
+  }
+  at = (Strview *)words.at;
+  intern_init(&interns);
+  start = time_now();
+  for (i = 0; i < words.length; i++) {
+    id = intern_sv(&interns, at[i]);
+    num_keywords += id < KW_COUNT;
+  }
+  start = time_now() - start;
+  printf("%s%ld%s%d%s%ld%s", "Interning ", (long)words.length,
+    " identifiers, ", ATOMIC_LOAD(&interns.num_strings) - 1,
+    " distinct, ", (long)num_keywords, " keywords\n"
+  );
+  print_rate("intern_sv", words.length, start);
+  start = time_now();
+  for (i = 0; i < words.length; i++) {
+    misses += intern_find(&interns, at[i]) == 0;
+  }
+  print_rate("intern_find, all found", words.length,
+    time_now() - start
+  );
+  if (misses != 0) {
+    fprintf(stderr, "%s", "bench_intern: an identifier is lost\n");
+    return EXIT_FAILURE;
+  }
+  intern_deinit(&interns);
+  vec_deinit(&words);
+  sb_deinit(&text);
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+void
+find_words(Strview text, Vector *words)
+{
+  Strview word;
+  int64 n = 0;
+  /**/
+  while (text.length > 0) {
+    text = sv_cut(text, sv_span_not_class(text, CC_IDENT));
+    /* Numbers such as `0x1F` are skipped whole. */
+    n = sv_span_class(text, CC_IDENT);
+    if (n > 0 && cc_is(text.at[0], CC_IDENT_START)) {
+      word = sv_get(text, n);
+      vec_push(words, &word);
+    }
+    text = sv_cut(text, n);
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+print_rate(const char *name, int64 count, double seconds)
+{
+  printf("  %-28s %8.2fM lookups/s\n", name, count / seconds / 1e6);
+}
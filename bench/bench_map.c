@@ -0,0 +1,169 @@
+/* Unique ANSI C Compiler */
+/* bench/bench_map.c - Benchmark of Map with nested scopes */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Names declared at file scope, IDs from 1.
+*/
+#define BENCH_NUM_GLOBALS (1024 * 1024)
+
+/*
+Functions whose bodies are simulated. Each one opens blocks
+`BENCH_DEPTH` deep, and in each block declares
+`BENCH_NUM_LOCALS` names that shadow globals and looks up
+`BENCH_NUM_USES` names.
+*/
+#define BENCH_NUM_FUNCTIONS 50000
+#define BENCH_DEPTH 8
+#define BENCH_NUM_LOCALS 16
+#define BENCH_NUM_USES 64
+
+/*
+Calls of each kind made on the whole map after the scopes.
+*/
+#define BENCH_NUM_RANDOM 4000000
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Next pseudo-random ID from 1 to `BENCH_NUM_GLOBALS`.
+*/
+static int
+next_id(void);
+
+/*
+Print the time per call of `count` calls done in `seconds`.
+*/
+static void
+print_time(const char *name, long count, double seconds);
+
+/*
+Simulate the scopes of the bodies of functions on `map`.
+Returns the calls made.
+*/
+static long
+run_scopes(Map *map);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+static Globals static_G;
+
+THREAD_LOCAL Globals *G = &static_G;
+
+/*
+Values of globals and of locals.
+*/
+static char global_mark;
+static char local_mark;
+
+/*
+State of `next_id`.
+*/
+static unsigned long random_state = 1;
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(void)
+{
+  Map map;
+  double start = 0;
+  long count = 0;
+  long i = 0;
+  /**/
+  mem_clear(&map, sizeof(map));
+  map_init(&map);
+  printf("%s%d%s", "Map with ", BENCH_NUM_GLOBALS, " globals\n");
+  start = time_now();
+  for (i = 1; i <= BENCH_NUM_GLOBALS; i++) {
+    map_set(&map, (int)i, &global_mark);
+  }
+  print_time("fill", BENCH_NUM_GLOBALS, time_now() - start);
+  start = time_now();
+  count = run_scopes(&map);
+  start = time_now() - start;
+  printf("  %-8s %6.1fM calls in %.2f s, %.1fM calls/s\n",
+    "scopes", count / 1e6, start, count / start / 1e6
+  );
+  start = time_now();
+  for (i = 0; i < BENCH_NUM_RANDOM; i++) {
+    count += map_get(&map, next_id()) != NULL;
+  }
+  print_time("get", BENCH_NUM_RANDOM, time_now() - start);
+  start = time_now();
+  for (i = 0; i < BENCH_NUM_RANDOM; i++) {
+    map_set(&map, next_id(), &global_mark);
+  }
+  print_time("set", BENCH_NUM_RANDOM, time_now() - start);
+  start = time_now();
+  for (i = 0; i < BENCH_NUM_RANDOM; i++) {
+    map_remove(&map, next_id());
+  }
+  print_time("remove", BENCH_NUM_RANDOM, time_now() - start);
+  map_deinit(&map);
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+int
+next_id(void)
+{
+  random_state = random_state * 1103515245UL + 12345UL;
+  return (int)((random_state >> 8) % BENCH_NUM_GLOBALS) + 1;
+}
+
+/*----------------------------------------------------------*/
+void
+print_time(const char *name, long count, double seconds)
+{
+  printf("  %-8s %6.1f ns per call\n", name, seconds / count * 1e9);
+}
+
+/*----------------------------------------------------------*/
+long
+run_scopes(Map *map)
+{
+  long count = 0;
+  int f = 0;
+  int level = 0;
+  int i = 0;
+  /**/
+  for (f = 0; f < BENCH_NUM_FUNCTIONS; f++) {
+    for (level = 0; level < BENCH_DEPTH; level++) {
+      map_push_scope(map);
+      for (i = 0; i < BENCH_NUM_LOCALS; i++) {
+        map_set(map, next_id(), &local_mark);
+      }
+      for (i = 0; i < BENCH_NUM_USES; i++) {
+        map_get(map, next_id());
+      }
+      count += 1 + BENCH_NUM_LOCALS + BENCH_NUM_USES;
+    }
+    for (level = 0; level < BENCH_DEPTH; level++) {
+      map_pop_scope(map);
+      count++;
+    }
+  }
+  /* Every local is gone, so only globals are found again. */
+  if (map_get(map, next_id()) != &global_mark) {
+    fprintf(stderr, "%s", "bench_map: scopes were not undone\n");
+    exit(EXIT_FAILURE);
+  }
+  return count;
+}
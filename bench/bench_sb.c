@@ -0,0 +1,180 @@
+/* Unique ANSI C Compiler */
+/* bench/bench_sb.c - Benchmark of Strbuf appends */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Appends of a line of assembly per run.
+*/
+#define BENCH_NUM_LINES 2000000
+
+/*
+Appends of a single character per run.
+*/
+#define BENCH_NUM_CHARS 10000000
+
+/*
+The string is cleared when it gets this long, so that the
+appends stay in the cache like those of a compiler do.
+*/
+#define BENCH_MAX_LENGTH (64 * 1024)
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Print the rate of `count` appends done in `seconds`.
+*/
+static void
+print_rate(const char *name, long count, double seconds);
+
+/*
+Append a line of assembly `count` times by `append`.
+Returns the seconds it took.
+*/
+static double
+run_lines(void (*append)(Strbuf *, const char *, ...), long count);
+
+/*
+Append a single character `count` times by `sb_append` if
+`is_format`, else by `sb_append_char`.
+Returns the seconds it took.
+*/
+static double
+run_chars(int is_format, long count);
+
+/*
+Append a formated string the way `sb_append` did before it
+had its own formatter: measure the result by `vfprintf` to
+`/dev/null`, then write it by `vsprintf`.
+*/
+static void
+two_pass_append(Strbuf *sb, const char *fmt, ...);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+static Globals static_G;
+
+THREAD_LOCAL Globals *G = &static_G;
+
+/*
+Where `two_pass_append` measures.
+*/
+static FILE *fnull;
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(void)
+{
+  double before = 0;
+  double after = 0;
+  /**/
+  fnull = fopen("/dev/null", "wb");
+  if (fnull == NULL) {
+    fprintf(stderr, "%s%s%s", "/dev/null: ", strerror(errno), "\n");
+    return EXIT_FAILURE;
+  }
+  printf("%s", "Strbuf appends per second\n");
+  before = run_lines(two_pass_append, BENCH_NUM_LINES);
+  after = run_lines(sb_append, BENCH_NUM_LINES);
+  print_rate("formated, two passes", BENCH_NUM_LINES, before);
+  print_rate("formated, one pass", BENCH_NUM_LINES, after);
+  before = run_chars(1, BENCH_NUM_CHARS);
+  after = run_chars(0, BENCH_NUM_CHARS);
+  print_rate("\"%c\" by sb_append", BENCH_NUM_CHARS, before);
+  print_rate("sb_append_char", BENCH_NUM_CHARS, after);
+  fclose(fnull);
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+void
+print_rate(const char *name, long count, double seconds)
+{
+  printf("  %-24s %8.2fM\n", name, count / seconds / 1e6);
+}
+
+/*----------------------------------------------------------*/
+double
+run_lines(void (*append)(Strbuf *, const char *, ...), long count)
+{
+  static const char *regs[4] = {"eax", "ebx", "ecx", "edx"};
+  Strbuf sb;
+  double start = 0;
+  long i = 0;
+  /**/
+  mem_clear(&sb, sizeof(sb));
+  sb_init(&sb);
+  start = time_now();
+  for (i = 0; i < count; i++) {
+    append(&sb, "  mov %s, %d ; %x %c\n",
+      regs[i % 4], (int)i, (unsigned)i, 'a' + (int)(i % 26)
+    );
+    if (sb.length > BENCH_MAX_LENGTH) {
+      sb_clear(&sb);
+    }
+  }
+  start = time_now() - start;
+  sb_deinit(&sb);
+  return start;
+}
+
+/*----------------------------------------------------------*/
+double
+run_chars(int is_format, long count)
+{
+  Strbuf sb;
+  double start = 0;
+  long i = 0;
+  /**/
+  mem_clear(&sb, sizeof(sb));
+  sb_init(&sb);
+  start = time_now();
+  for (i = 0; i < count; i++) {
+    if (is_format) {
+      sb_append(&sb, "%c", 'a' + (int)(i % 26));
+    } else {
+      sb_append_char(&sb, 'a' + (int)(i % 26));
+    }
+    if (sb.length > BENCH_MAX_LENGTH) {
+      sb_clear(&sb);
+    }
+  }
+  start = time_now() - start;
+  sb_deinit(&sb);
+  return start;
+}
+
+/*----------------------------------------------------------*/
+void
+two_pass_append(Strbuf *sb, const char *fmt, ...)
+{
+  va_list args;
+  int64 placed = 0;
+  /**/
+  va_start(args, fmt);
+  placed = vfprintf(fnull, fmt, args);
+  va_end(args);
+  if (sb->length + placed + 1 > sb->capacity) {
+    sb_reserve(sb, (sb->length + placed + 1) * 2);
+  }
+  va_start(args, fmt);
+  vsprintf(sb->at + sb->length, fmt, args);
+  va_end(args);
+  sb->length += placed;
+}
@@ -0,0 +1,180 @@
+/* Unique ANSI C Compiler */
+/* bench/gen_macros.c - Corpus of heavily nested macros */
+
+/*
+Prints a C file made of two macro libraries to `stdout`:
+X-macro tables, split in parts like big generated tables are,
+and expanded by many X macros each, and P99-style loops made
+of numbered macros and by deferred recursion, which `EVAL`
+rescans dozens of times.
+The file is the same every time, so runs of `uacc -E` on it
+can be compared.
+*/
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Rows of the table, in parts of `GEN_PART_ROWS`.
+*/
+#define GEN_NUM_ROWS 3000
+#define GEN_PART_ROWS 100
+
+/*
+Invocations of `EVAL(REPEAT(...))` and `EVAL(LOOP(...))` and
+their count.
+*/
+#define GEN_NUM_REPEATS 400
+#define GEN_REPEAT_MAX 16
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Print the P99-style library and its uses.
+*/
+static void
+print_repeats(void);
+
+/*
+Print the X-macro table and its expansions.
+*/
+static void
+print_tables(void);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+/*
+Bodies of the X macros, each printed with the number of the
+macro as `%d`. A row is `X(name, value, flags)`.
+*/
+static const char *x_bodies[] = {
+  "E%d_ ## name = value,",
+  "#name,",
+  "case value: return flags + %d;",
+  "int name ## _%d;",
+  "{ #name, value, flags, %d },",
+  "+ ((value) * (flags) ^ %d)",
+};
+
+/*
+Library in the style of P99: loops are tables of numbered
+macros, each calling the one before, or macros that call
+themselves through `LOOP_INDIRECT`, which `OBSTRUCT` keeps
+from expanding until the next scan. `EVAL` rescans the result
+dozens of times.
+*/
+static const char *repeat_library[] = {
+  "#define PASTE2(a, b) a ## b",
+  "#define PASTE(a, b) PASTE2(a, b)",
+  "#define EVAL(x) EVAL1(EVAL1(EVAL1(x)))",
+  "#define EVAL1(x) EVAL2(EVAL2(EVAL2(x)))",
+  "#define EVAL2(x) EVAL3(EVAL3(EVAL3(x)))",
+  "#define EVAL3(x) EVAL4(EVAL4(EVAL4(x)))",
+  "#define EVAL4(x) x",
+  "#define REPEAT(count, macro, data) \\",
+  "  PASTE(REPEAT_, count)(macro, data)",
+  "#define DECL(i, name) int PASTE(name, PASTE(_, i));",
+  "#define REPEAT_0(macro, data)",
+  "#define EMPTY()",
+  "#define DEFER(id) id EMPTY()",
+  "#define OBSTRUCT(id) id DEFER(EMPTY)()",
+  "#define EXPAND(x) x",
+  "#define EAT(x)",
+  "#define IIF(c) PASTE(IIF_, c)",
+  "#define IIF_0(t, f) f",
+  "#define IIF_1(t, f) t",
+  "#define WHEN(c) IIF(c)(EXPAND, EAT)",
+  "#define BOOL(n) PASTE(BOOL_, n)",
+  "#define DEC(n) PASTE(DEC_, n)",
+  "#define LOOP(n, name) WHEN(BOOL(n)) \\",
+  "  (OBSTRUCT(LOOP_INDIRECT)()(DEC(n), name) \\",
+  "  long PASTE(name, PASTE(_, n));)",
+  "#define LOOP_INDIRECT() LOOP",
+  "#define BOOL_0 0",
+  NULL
+};
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION                                           */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+main(void)
+{
+  printf("%s", "/* Generated by bench/gen_macros.c */\n\n");
+  print_tables();
+  print_repeats();
+  return EXIT_SUCCESS;
+}
+
+/*----------------------------------------------------------*/
+void
+print_repeats(void)
+{
+  int i = 0;
+  /**/
+  for (i = 0; repeat_library[i] != NULL; i++) {
+    printf("%s\n", repeat_library[i]);
+  }
+  for (i = 1; i <= GEN_REPEAT_MAX; i++) {
+    printf("#define REPEAT_%d(macro, data) REPEAT_%d(macro, data) "
+      "macro(%d, data)\n", i, i - 1, i - 1
+    );
+    printf("#define BOOL_%d 1\n", i);
+    printf("#define DEC_%d %d\n", i, i - 1);
+  }
+  printf("%s", "\n");
+  for (i = 0; i < GEN_NUM_REPEATS; i++) {
+    printf("EVAL(REPEAT(%d, DECL, r%d))\n",
+      i % GEN_REPEAT_MAX + 1, i
+    );
+    printf("EVAL(LOOP(%d, l%d))\n", i % GEN_REPEAT_MAX + 1, i);
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+print_tables(void)
+{
+  int num_bodies = 0;
+  int num_parts = 0;
+  int part = 0;
+  int row = 0;
+  int i = 0;
+  /**/
+  num_bodies = sizeof(x_bodies) / sizeof(x_bodies[0]);
+  num_parts = GEN_NUM_ROWS / GEN_PART_ROWS;
+  for (part = 0; part < num_parts; part++) {
+    printf("#define TABLE_%d(X) \\\n", part);
+    for (i = 0; i < GEN_PART_ROWS; i++) {
+      row = part * GEN_PART_ROWS + i;
+      printf("  X(item_%d, %d, 0x%x) \\\n", row, row, row * 7 % 256);
+    }
+    printf("%s", "\n");
+  }
+  printf("%s", "#define TABLE(X) \\\n");
+  for (part = 0; part < num_parts; part++) {
+    printf("  TABLE_%d(X) \\\n", part);
+  }
+  printf("%s", "\n");
+  /* Each body three times, by 18 X macros in all. */
+  for (i = 0; i < num_bodies * 3; i++) {
+    printf("#define X%d(name, value, flags) ", i);
+    printf(x_bodies[i % num_bodies], i);
+    printf("%s", "\n");
+    printf("TABLE(X%d)\n\n", i);
+  }
+}
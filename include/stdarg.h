@@ -0,0 +1,28 @@
+/* Unique ANSI C Compiler */
+/* include/stdarg.h - Variable arguments */
+
+/*
+The type the C library uses in its declarations such as
+`vprintf`. It asks for only this one by `__need___va_list`.
+*/
+#ifndef __GNUC_VA_LIST
+#define __GNUC_VA_LIST
+typedef __builtin_va_list __gnuc_va_list;
+#endif
+
+#ifdef __need___va_list
+#undef __need___va_list
+#else
+
+#ifndef __UACC_STDARG_H
+#define __UACC_STDARG_H
+
+typedef __gnuc_va_list va_list;
+
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_arg(ap, type) __builtin_va_arg(ap, type)
+#define va_end(ap) __builtin_va_end(ap)
+
+#endif
+
+#endif
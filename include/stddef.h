@@ -0,0 +1,32 @@
+/* Unique ANSI C Compiler */
+/* include/stddef.h - Common definitions */
+
+/*
+The C library may include this file for only some of the
+names by `__need_size_t` and the like. All of them are
+defined anyway, as they are the same each time.
+*/
+#undef __need_size_t
+#undef __need_ptrdiff_t
+#undef __need_wchar_t
+#undef __need_NULL
+#undef __need_wint_t
+
+#ifndef __UACC_STDDEF_H
+#define __UACC_STDDEF_H
+
+#ifdef __LP64__
+typedef unsigned long size_t;
+typedef long ptrdiff_t;
+#else
+typedef unsigned int size_t;
+typedef int ptrdiff_t;
+#endif
+
+typedef int wchar_t;
+
+#define NULL ((void *)0)
+
+#define offsetof(type, member) __builtin_offsetof(type, member)
+
+#endif
@@ -19,16 +19,219 @@ c - bugfix number (unique for each b).
 */
 #define UACC_VERSION "0.1.0"
 
+/*
+Most threads started by `-j`.
+*/
+#define UACC_MAX_JOBS 64
+
+/*
+Bytes the disk cache of `--cache` may take if `--cache-size`
+is not given.
+*/
+#define UACC_CACHE_SIZE (1024L * 1024 * 1024)
+
+/*
+Directory of the headers of uacc itself, such as `stddef.h`,
+searched before those of the host. Set by the Makefile.
+*/
+#ifndef UACC_INCLUDE_DIR
+#define UACC_INCLUDE_DIR "/usr/local/lib/uacc/include"
+#endif
+
+/*
+Multiarch name of the host, such as `x86_64-linux-gnu`, whose
+headers are in a directory of that name in `/usr/include`.
+Set by the Makefile, empty if the host has none.
+*/
+#ifndef UACC_MULTIARCH
+#define UACC_MULTIARCH ""
+#endif
+
+/*----------------------------------------------------------*/
+/* TYPES                                                    */
+/*----------------------------------------------------------*/
+
+/*
+File given on the command line. Its messages and output wait
+here until they can be printed in the order of the files.
+*/
+typedef struct Unit {
+  const char *path;
+  /* Messages of errors. */
+  Strbuf errors;
+  /* Output of `-E` kept in memory by a thread of `-j`. */
+  Writer out;
+  int is_ok;
+  int is_done;
+} Unit;
+
+/*
+Files to compile and the state shared by the threads of `-j`.
+Everything but `next_unit` and `is_done` of units is only read
+while the threads run. The headers are shared as well, each
+file is loaded once for all the threads.
+*/
+typedef struct Build {
+  Unit *units;
+  int num_units;
+  HeaderCache *cache;
+  /* Precompiled header of `--pch` or NULL. */
+  PCH *pch;
+  /* Where `--make-pch` saves the unit or NULL. */
+  const char *pch_out;
+  /* Disk cache of `--cache` or NULL. */
+  DiskCache *disk_cache;
+  /* Standard output of `-E` or NULL. */
+  Writer *writer;
+  /* Unit for the next free thread. */
+  int next_unit;
+#ifndef UACC_NO_THREADS
+  pthread_mutex_t lock;
+  /* Signaled when a unit is done. */
+  pthread_cond_t done;
+#endif
+} Build;
+
+/*
+Thread compiling units.
+*/
+typedef struct Worker {
+  Build *build;
+  /* Statistics of the thread, added up at the end. */
+  Globals globals;
+#ifndef UACC_NO_THREADS
+  pthread_t thread;
+#endif
+} Worker;
+
 /*----------------------------------------------------------*/
 /* STATIC FUNCTIONS                                         */
 /*----------------------------------------------------------*/
 
+#ifndef UACC_NO_THREADS
+
+/*
+Add the memory statistics `from` to `to`.
+*/
+static void
+add_mem_stats(MemStats *to, const MemStats *from);
+
+/*
+Add the statistics of `from` to the globals of the thread.
+*/
+static void
+add_stats(const Globals *from);
+
+#endif
+
+/*
+Run the phases after preprocessing on the output of `pp`,
+or take their result from the disk cache of `build`. Their
+messages are added to `pp->errors`. Returns 0 if they failed.
+*/
+static int
+compile_tokens(Build *build, Preprocessor *pp);
+
+/*
+Compile `unit` with the headers of `build`. If `writer` is
+not NULL, only preprocess it and print the result there.
+*/
+static void
+compile_unit(Build *build, Unit *unit, Writer *writer);
+
+/*
+Tell if `option` takes the next argument as its value.
+*/
+static int
+has_value(const char *option);
+
+/*
+Make the disk cache key of the output of `pp`: the tokens
+with their spacing and where they come from, since messages
+tell it, and the version of uacc.
+*/
+static void
+hash_unit(Preprocessor *pp, Digest *key);
+
+/*
+Parse the number of `-j`. Returns 0 if `text` is not a number
+from 1 to `UACC_MAX_JOBS`.
+*/
+static int
+parse_jobs(const char *text);
+
+/*
+Parse the bytes of `--cache-size`, a number with an optional
+suffix K, M or G. Returns -1 if `text` is not such a number.
+*/
+static int64
+parse_size(const char *text);
+
+/*
+Print the disk cache statistics to `stderr`.
+Registered with `atexit` by `--cache-stats`.
+*/
+static void
+print_cache_stats(void);
+
 /*
 Print the help message to `stdout`.
 */
 static void
 print_help(void);
 
+/*
+Print the memory statistics to `stderr`.
+Registered with `atexit` by `--mem-stats`.
+*/
+static void
+print_mem_stats(void);
+
+/*
+Print the preprocessor statistics to `stderr`.
+Registered with `atexit` by `--pp-stats`.
+*/
+static void
+print_pp_stats(void);
+
+/*
+Print the time statistics to `stderr`.
+Registered with `atexit` by `--time`.
+*/
+static void
+print_time_stats(void);
+
+/*
+Print the messages and the output of `unit` and free them.
+*/
+static void
+print_unit(Build *build, Unit *unit);
+
+#ifndef UACC_NO_THREADS
+
+/*
+Compile the units of `build` on `num_jobs` threads and print
+them in order as they get done. Returns 0 if no thread could
+be started.
+*/
+static int
+run_parallel(Build *build, int num_jobs);
+
+/*
+Body of a thread of `-j`: take units until none are left.
+*/
+static void *
+run_worker(void *arg);
+
+#endif
+
+/*
+Run the phases after preprocessing on the output of `pp`,
+adding their messages to `errors`. Returns 0 if they failed.
+*/
+static int
+translate_unit(Preprocessor *pp, Strbuf *errors);
+
 /*----------------------------------------------------------*/
 /* VARIABLES                                                */
 /*----------------------------------------------------------*/
@@ -39,9 +242,10 @@ The actual location of global variables.
 static Globals static_G;
 
 /*
-Vector to global variables.
+Vector to global variables. Threads of `-j` point it to their
+own ones.
 */
-Globals *G = &static_G;
+THREAD_LOCAL Globals *G = &static_G;
 
 /*----------------------------------------------------------*/
 /* IMPLEMENTATION                                           */
@@ -51,33 +255,457 @@ Globals *G = &static_G;
 int
 main(int argc, char *argv[])
 {
+  Build build;
+  Interns interns;
+  HeaderCache cache;
+  PCH pch;
+  DiskCache disk_cache;
+  Writer writer;
+  Strbuf message;
+  const char *option = NULL;
+  const char *value = NULL;
+  const char *jobs = NULL;
+  const char *pch_path = NULL;
+  const char *cache_dir = NULL;
+  const char *cache_size = NULL;
+  int64 max_size = UACC_CACHE_SIZE;
   int i = 0;
-  const char *fnull_name = "/dev/null";
+  int num_jobs = 1;
+  int is_preprocess_only = 0;
+  int is_cache_stats = 0;
+  int is_parallel = 0;
+  int is_ok = 0;
   /**/
   if (argc < 2) {
-    print_help();  
+    print_help();
     exit(EXIT_SUCCESS);
   }
   /**/
-  G->fnull = fopen(fnull_name, "wb");
-  if (G->fnull == NULL) {
-    fprintf(stderr, "%s%s%s%s",
-      fnull_name, ": ", strerror(errno), "\n"
+  mem_clear(&build, sizeof(build));
+  mem_clear(&interns, sizeof(interns));
+  mem_clear(&cache, sizeof(cache));
+  mem_clear(&pch, sizeof(pch));
+  mem_clear(&disk_cache, sizeof(disk_cache));
+  mem_clear(&writer, sizeof(writer));
+  mem_clear(&message, sizeof(message));
+  intern_init(&interns);
+  hc_init(&cache, &interns);
+  build.cache = &cache;
+  build.units = mem_alloc_zeros(argc * sizeof(Unit));
+  build.num_units = 0;
+  for (i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--help") == 0) {
+      print_help();
+      exit(EXIT_SUCCESS);
+    } else if (strcmp(argv[i], "--cache-stats") == 0) {
+      atexit(print_cache_stats);
+      is_cache_stats = 1;
+    } else if (strcmp(argv[i], "--mem-stats") == 0) {
+      atexit(print_mem_stats);
+    } else if (strcmp(argv[i], "--pp-stats") == 0) {
+      atexit(print_pp_stats);
+    } else if (strcmp(argv[i], "--time") == 0) {
+      atexit(print_time_stats);
+    } else if (strcmp(argv[i], "-E") == 0) {
+      is_preprocess_only = 1;
+    } else if (has_value(argv[i])) {
+      if (i + 1 == argc) {
+        fprintf(stderr, "%s%s%s",
+          "uacc: error: missing argument to '", argv[i], "'\n"
+        );
+        exit(EXIT_FAILURE);
+      }
+      option = argv[i++];
+      value = argv[i];
+      if (strcmp(option, "-I") == 0) {
+        hc_add_dir(&cache, value);
+      } else if (strcmp(option, "-j") == 0) {
+        jobs = value;
+      } else if (strcmp(option, "--cache") == 0) {
+        cache_dir = value;
+      } else if (strcmp(option, "--cache-size") == 0) {
+        cache_size = value;
+      } else if (strcmp(option, "--make-pch") == 0) {
+        build.pch_out = value;
+      } else {
+        pch_path = value;
+      }
+    } else if (strncmp(argv[i], "-I", 2) == 0) {
+      hc_add_dir(&cache, argv[i] + 2);
+    } else if (strncmp(argv[i], "-j", 2) == 0) {
+      jobs = argv[i] + 2;
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "%s%s%s",
+        "uacc: error: unrecognized option '", argv[i], "'\n"
+      );
+      exit(EXIT_FAILURE);
+    } else {
+      build.units[build.num_units++].path = argv[i];
+    }
+  }
+  if (jobs != NULL) {
+    num_jobs = parse_jobs(jobs);
+    if (num_jobs == 0) {
+      fprintf(stderr, "%s%s%s",
+        "uacc: error: invalid number of jobs '", jobs, "'\n"
+      );
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (cache_size != NULL) {
+    max_size = parse_size(cache_size);
+    if (max_size < 0) {
+      fprintf(stderr, "%s%s%s",
+        "uacc: error: invalid cache size '", cache_size, "'\n"
+      );
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (build.num_units == 0) {
+    fprintf(stderr, "%s", "uacc: error: no input files\n");
+    exit(EXIT_FAILURE);
+  }
+  if (build.pch_out != NULL && build.num_units != 1) {
+    fprintf(stderr, "%s",
+      "uacc: error: --make-pch takes exactly one input file\n"
     );
     exit(EXIT_FAILURE);
   }
+  if (build.pch_out != NULL && is_preprocess_only) {
+    fprintf(stderr, "%s",
+      "uacc: error: --make-pch cannot be used with -E\n"
+    );
+    exit(EXIT_FAILURE);
+  }
+  hc_add_dir(&cache, UACC_INCLUDE_DIR);
+  hc_add_dir(&cache, "/usr/local/include");
+  if (UACC_MULTIARCH[0] != '\0') {
+    hc_add_dir(&cache, "/usr/include/" UACC_MULTIARCH);
+  }
+  hc_add_dir(&cache, "/usr/include");
+  if (pch_path != NULL) {
+    sb_init(&message);
+    if (!pch_load(&pch, &cache, pch_path, &message)) {
+      fprintf(stderr, "%s%s", "uacc: error: ", message.at);
+      exit(EXIT_FAILURE);
+    }
+    sb_deinit(&message);
+    build.pch = &pch;
+  }
+  if (cache_dir != NULL) {
+    if (!dc_init(&disk_cache, cache_dir, max_size)) {
+      fprintf(stderr, "%s%s%s%s%s",
+        "uacc: error: ", cache_dir, ": ", strerror(errno), "\n"
+      );
+      exit(EXIT_FAILURE);
+    }
+    build.disk_cache = &disk_cache;
+  }
   /**/
-  for (i = 1; i < argc; i++) {
-    if (strcmp(argv[i], "--help") == 0) {
-      print_help();  
-      exit(EXIT_SUCCESS);
+  if (is_preprocess_only) {
+    wr_init(&writer, STDOUT_FILENO);
+    build.writer = &writer;
+  }
+  if (num_jobs > build.num_units) {
+    num_jobs = build.num_units;
+  }
+  is_parallel = 0;
+#ifndef UACC_NO_THREADS
+  if (num_jobs > 1) {
+    is_parallel = run_parallel(&build, num_jobs);
+  }
+#endif
+  if (!is_parallel) {
+    for (i = 0; i < build.num_units; i++) {
+      compile_unit(&build, &build.units[i], build.writer);
+      print_unit(&build, &build.units[i]);
+    }
+  }
+  is_ok = 1;
+  for (i = 0; i < build.num_units; i++) {
+    is_ok &= build.units[i].is_ok;
+  }
+  if (is_preprocess_only) {
+    if (!wr_flush(&writer)) {
+      fprintf(stderr, "%s%s%s",
+        "uacc: error: cannot write the output: ",
+        strerror(writer.error), "\n"
+      );
+      is_ok = 0;
     }
+    wr_deinit(&writer);
   }
-  printf("Hello, World!!!\n");
-  exit(EXIT_SUCCESS);
+  if (disk_cache.is_inited) {
+    if (G->cache_stats.num_stores > 0 || is_cache_stats) {
+      dc_trim(&disk_cache);
+    }
+    dc_deinit(&disk_cache);
+  }
+  mem_free(build.units);
+  hc_deinit(&cache);
+  if (pch.is_inited) {
+    pch_deinit(&pch);
+  }
+  intern_deinit(&interns);
+  exit(is_ok ? EXIT_SUCCESS : EXIT_FAILURE);
   return 0;
 }
 
+#ifndef UACC_NO_THREADS
+
+/*----------------------------------------------------------*/
+void
+add_mem_stats(MemStats *to, const MemStats *from)
+{
+  /* Peaks of threads may not overlap, the sum is a bound. */
+  to->live_bytes += from->live_bytes;
+  to->peak_bytes += from->peak_bytes;
+  to->num_allocs += from->num_allocs;
+  to->num_reallocs += from->num_reallocs;
+}
+
+/*----------------------------------------------------------*/
+void
+add_stats(const Globals *from)
+{
+  PhaseStats *phase = NULL;
+  PPStats *pp = NULL;
+  CacheStats *cache = NULL;
+  int i = 0;
+  /**/
+  assert(from != NULL);
+  /**/
+  for (i = 0; i < MEM_KIND_COUNT; i++) {
+    add_mem_stats(&G->mem_stats[i], &from->mem_stats[i]);
+  }
+  add_mem_stats(&G->mem_total, &from->mem_total);
+  for (i = 0; i < PHASE_COUNT; i++) {
+    phase = &G->phase_stats[i];
+    phase->seconds += from->phase_stats[i].seconds;
+    phase->bytes += from->phase_stats[i].bytes;
+    phase->items += from->phase_stats[i].items;
+  }
+  pp = &G->pp_stats;
+  pp->num_includes += from->pp_stats.num_includes;
+  pp->num_loads += from->pp_stats.num_loads;
+  pp->num_reuses += from->pp_stats.num_reuses;
+  pp->num_guard_skips += from->pp_stats.num_guard_skips;
+  pp->num_once_skips += from->pp_stats.num_once_skips;
+  pp->num_stats += from->pp_stats.num_stats;
+  pp->num_missing_hits += from->pp_stats.num_missing_hits;
+  pp->num_expansions += from->pp_stats.num_expansions;
+  pp->num_pch_tokens += from->pp_stats.num_pch_tokens;
+  cache = &G->cache_stats;
+  cache->num_hits += from->cache_stats.num_hits;
+  cache->num_misses += from->cache_stats.num_misses;
+  cache->num_stores += from->cache_stats.num_stores;
+}
+
+#endif
+
+/*----------------------------------------------------------*/
+int
+compile_tokens(Build *build, Preprocessor *pp)
+{
+  Digest key;
+  Strbuf entry;
+  int64 start = 0;
+  int is_ok = 0;
+  /**/
+  assert(build != NULL);
+  assert(pp != NULL);
+  /**/
+  if (build->disk_cache == NULL) {
+    return translate_unit(pp, &pp->errors);
+  }
+  mem_clear(&entry, sizeof(entry));
+  sb_init(&entry);
+  hash_unit(pp, &key);
+  /* An entry is the result, '1' or '0', and the messages. */
+  if (dc_get(build->disk_cache, &key, &entry) && entry.length > 0) {
+    is_ok = entry.at[0] == '1';
+    sb_append_bytes(&pp->errors, entry.at + 1, entry.length - 1);
+  } else {
+    start = pp->errors.length;
+    is_ok = translate_unit(pp, &pp->errors);
+    sb_clear(&entry);
+    sb_append_char(&entry, is_ok ? '1' : '0');
+    sb_append_bytes(&entry, pp->errors.at + start,
+      pp->errors.length - start
+    );
+    dc_put(build->disk_cache, &key, sb_view(&entry));
+  }
+  sb_deinit(&entry);
+  return is_ok;
+}
+
+/*----------------------------------------------------------*/
+void
+compile_unit(Build *build, Unit *unit, Writer *writer)
+{
+  Preprocessor pp;
+  Tokens tokens;
+  /**/
+  assert(build != NULL);
+  assert(unit != NULL);
+  /**/
+  mem_clear(&pp, sizeof(pp));
+  mem_clear(&tokens, sizeof(tokens));
+  tok_init(&tokens);
+  pp_init(&pp, build->cache, &tokens);
+  if (writer != NULL) {
+    pp_stream(&pp, writer);
+  }
+  if (build->pch != NULL) {
+    pp_use_pch(&pp, build->pch);
+  }
+  unit->is_ok = pp_run(&pp, unit->path);
+  if (unit->is_ok && build->pch_out != NULL) {
+    unit->is_ok = pch_save(&pp, build->pch_out);
+  } else if (unit->is_ok && writer == NULL) {
+    unit->is_ok = compile_tokens(build, &pp);
+  }
+  sb_init(&unit->errors);
+  sb_append_sv(&unit->errors, sb_view(&pp.errors));
+  pp_deinit(&pp);
+  tok_deinit(&tokens);
+}
+
+/*----------------------------------------------------------*/
+int
+has_value(const char *option)
+{
+  static const char *options[] = {
+    "-I", "-j", "--cache", "--cache-size", "--make-pch", "--pch"
+  };
+  int i = 0;
+  /**/
+  assert(option != NULL);
+  /**/
+  for (i = 0; i < (int)(sizeof(options) / sizeof(*options)); i++) {
+    if (strcmp(option, options[i]) == 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*----------------------------------------------------------*/
+void
+hash_unit(Preprocessor *pp, Digest *key)
+{
+  static const char version[] = "uacc " UACC_VERSION;
+  Tokens *out = NULL;
+  Header *header = NULL;
+  Strview text;
+  int64 offset = 0;
+  int flags = 0;
+  int i = 0;
+  /**/
+  assert(pp != NULL);
+  assert(key != NULL);
+  /**/
+  out = pp->out;
+  dg_init(key);
+  dg_add(key, version, sizeof(version));
+  for (i = 0; i < out->count; i++) {
+    flags = out->flags[i];
+    offset = out->offsets[i];
+    dg_add_int(key, out->kinds[i]);
+    dg_add_int(key, flags & (TF_BOL | TF_SPACE));
+    dg_add_int(key, out->lengths[i]);
+    if (flags & TF_SCRATCH) {
+      dg_add(key, pp->scratch.at + offset, out->lengths[i]);
+      continue;
+    }
+    /* Tokens mostly come in runs from the same file. */
+    if (header == NULL || offset < header->base
+        || offset > header->base + header->src.text.length) {
+      header = hc_locate(pp->cache, offset);
+      dg_add(key, header->src.path.at, header->src.path.length + 1);
+    }
+    text = sv_array(header->src.text.at + offset - header->base,
+      out->lengths[i]
+    );
+    dg_add(key, text.at, text.length);
+    dg_add_int(key, offset - header->base);
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+parse_jobs(const char *text)
+{
+  int n = 0;
+  /**/
+  assert(text != NULL);
+  /**/
+  if (*text == '\0') {
+    return 0;
+  }
+  for (; *text != '\0'; text++) {
+    if (!cc_is(*text, CC_DIGIT)) {
+      return 0;
+    }
+    n = n * 10 + (*text - '0');
+    if (n > UACC_MAX_JOBS) {
+      return 0;
+    }
+  }
+  return n;
+}
+
+/*----------------------------------------------------------*/
+int64
+parse_size(const char *text)
+{
+  int64 n = 0;
+  int64 unit = 1;
+  int digit = 0;
+  /**/
+  assert(text != NULL);
+  /**/
+  if (!cc_is(*text, CC_DIGIT)) {
+    return -1;
+  }
+  for (; cc_is(*text, CC_DIGIT); text++) {
+    digit = *text - '0';
+    if (n > (MEM_SIZE_MAX - digit) / 10) {
+      return -1;
+    }
+    n = n * 10 + digit;
+  }
+  switch (*text) {
+  case 'K':
+  case 'k':
+    unit = 1024L;
+    break;
+  case 'M':
+  case 'm':
+    unit = 1024L * 1024;
+    break;
+  case 'G':
+  case 'g':
+    unit = 1024L * 1024 * 1024;
+    break;
+  case '\0':
+    return n;
+  default:
+    return -1;
+  }
+  if (text[1] != '\0' || n > MEM_SIZE_MAX / unit) {
+    return -1;
+  }
+  return n * unit;
+}
+
+/*----------------------------------------------------------*/
+void
+print_cache_stats(void)
+{
+  dc_print_stats(stderr);
+}
+
 /*----------------------------------------------------------*/
 void
 print_help(void)
@@ -91,9 +719,202 @@ print_help(void)
     "uacc [options] file...\n"
     "\n"
     "      OPTIONS\n"
+    "  --cache dir\n"
+    "Keep the results of compiling in dir and reuse them for\n"
+    "files that preprocess to the same tokens again.\n"
+    "\n"
+    "  --cache-size n\n"
+    "Remove the least recently used results when the cache\n"
+    "takes more than n bytes, 1G if not given. The suffix K,\n"
+    "M or G multiplies n by 1024 that many times. 0 is no limit.\n"
+    "\n"
+  );
+  printf("%s",
+    "  --cache-stats\n"
+    "Print disk cache statistics at exit.\n"
+    "\n"
+    "  -E\n"
+    "Only preprocess and write the result to the standard\n"
+    "output.\n"
+    "\n"
     "  --help\n"
     "Display this information.\n"
     "\n"
+    "  -I dir\n"
+    "Search dir for included files before the system directories.\n"
+    "\n"
   );
+  printf("%s",
+    "  -j n\n"
+    "Compile up to n files at once, at most 64. Messages and\n"
+    "output are in the order of the files anyway.\n"
+    "\n"
+    "  --make-pch file\n"
+    "Preprocess the one input file, a header, and save the\n"
+    "state at its end to file as a precompiled header.\n"
+    "\n"
+    "  --mem-stats\n"
+    "Print memory statistics at exit.\n"
+    "\n"
+  );
+  printf("%s",
+    "  --pch file\n"
+    "Start every input file with the precompiled header file,\n"
+    "as if it included the header first. It is an error if\n"
+    "the files of the header have changed since.\n"
+    "\n"
+    "  --pp-stats\n"
+    "Print preprocessor statistics at exit: includes, files\n"
+    "loaded and re-reads skipped by the header cache.\n"
+    "\n"
+    "  --time\n"
+    "Print the time of each phase at exit.\n"
+    "\n"
+  );
+}
+
+/*----------------------------------------------------------*/
+void
+print_mem_stats(void)
+{
+  mem_print_stats(stderr);
+}
+
+/*----------------------------------------------------------*/
+void
+print_pp_stats(void)
+{
+  pp_print_stats(stderr);
+}
+
+/*----------------------------------------------------------*/
+void
+print_time_stats(void)
+{
+  time_print_stats(stderr);
+}
+
+/*----------------------------------------------------------*/
+void
+print_unit(Build *build, Unit *unit)
+{
+  assert(build != NULL);
+  assert(unit != NULL);
+  /**/
+  fprintf(stderr, "%s", unit->errors.at);
+  sb_deinit(&unit->errors);
+  if (unit->out.is_inited) {
+    wr_write(build->writer, unit->out.at, unit->out.length);
+    wr_deinit(&unit->out);
+  }
+}
+
+#ifndef UACC_NO_THREADS
+
+/*----------------------------------------------------------*/
+int
+run_parallel(Build *build, int num_jobs)
+{
+  Worker *workers = NULL;
+  Unit *unit = NULL;
+  int num_started = 0;
+  int error = 0;
+  int i = 0;
+  /**/
+  assert(build != NULL);
+  assert(num_jobs > 1);
+  /**/
+  workers = mem_alloc_zeros(num_jobs * sizeof(Worker));
+  pthread_mutex_init(&build->lock, NULL);
+  pthread_cond_init(&build->done, NULL);
+  for (i = 0; i < num_jobs; i++) {
+    workers[i].build = build;
+    error = pthread_create(&workers[i].thread, NULL, run_worker,
+      &workers[i]
+    );
+    if (error != 0) {
+      break;
+    }
+    num_started++;
+  }
+  if (num_started == 0) {
+    pthread_cond_destroy(&build->done);
+    pthread_mutex_destroy(&build->lock);
+    mem_free(workers);
+    return 0;
+  }
+  for (i = 0; i < build->num_units; i++) {
+    unit = &build->units[i];
+    pthread_mutex_lock(&build->lock);
+    while (!unit->is_done) {
+      pthread_cond_wait(&build->done, &build->lock);
+    }
+    pthread_mutex_unlock(&build->lock);
+    print_unit(build, unit);
+  }
+  for (i = 0; i < num_started; i++) {
+    pthread_join(workers[i].thread, NULL);
+    add_stats(&workers[i].globals);
+  }
+  pthread_cond_destroy(&build->done);
+  pthread_mutex_destroy(&build->lock);
+  mem_free(workers);
+  return 1;
 }
 
+/*----------------------------------------------------------*/
+void *
+run_worker(void *arg)
+{
+  Worker *worker = NULL;
+  Build *build = NULL;
+  Unit *unit = NULL;
+  Writer *writer = NULL;
+  /**/
+  assert(arg != NULL);
+  /**/
+  worker = arg;
+  build = worker->build;
+  G = &worker->globals;
+  for (;;) {
+    pthread_mutex_lock(&build->lock);
+    unit = NULL;
+    if (build->next_unit < build->num_units) {
+      unit = &build->units[build->next_unit++];
+    }
+    pthread_mutex_unlock(&build->lock);
+    if (unit == NULL) {
+      break;
+    }
+    writer = NULL;
+    if (build->writer != NULL) {
+      wr_init(&unit->out, -1);
+      writer = &unit->out;
+    }
+    compile_unit(build, unit, writer);
+    pthread_mutex_lock(&build->lock);
+    unit->is_done = 1;
+    pthread_cond_broadcast(&build->done);
+    pthread_mutex_unlock(&build->lock);
+  }
+  return NULL;
+}
+
+#endif
+
+/*----------------------------------------------------------*/
+int
+translate_unit(Preprocessor *pp, Strbuf *errors)
+{
+  Ast ast;
+  int is_ok = 0;
+  /**/
+  assert(pp != NULL);
+  assert(errors != NULL);
+  /**/
+  mem_clear(&ast, sizeof(ast));
+  ast_init(&ast, pp->out->count);
+  is_ok = parse_unit(&ast, pp, errors);
+  ast_deinit(&ast);
+  return is_ok;
+}
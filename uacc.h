@@ -28,399 +28,2453 @@ extern "C" {
 #include <string.h>
 #include <time.h>
 
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+#ifndef UACC_NO_THREADS
+#include <pthread.h>
+#endif
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Access to memory shared by threads without a lock.
+`ATOMIC_STORE` publishes the writes made before it to the
+threads that `ATOMIC_LOAD` the stored value. `ATOMIC_CAS`
+stores `v` at `p` if `p` has `*e` and returns 1, otherwise
+it sets `*e` to the value at `p` and returns 0.
+*/
+#ifdef UACC_NO_THREADS
+#define ATOMIC_LOAD(p) (*(p))
+#define ATOMIC_STORE(p, v) (*(p) = (v))
+#define ATOMIC_CAS(p, e, v) \
+  (*(p) == *(e) ? (*(p) = (v), 1) : (*(e) = *(p), 0))
+#else
+#define ATOMIC_LOAD(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define ATOMIC_CAS(p, e, v) __atomic_compare_exchange_n( \
+  p, e, v, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+/*
+Flags of `AST_D_FUNC` in `AstNode.op`.
+*/
+#define AST_OLD_STYLE 0x01 /* names of parameters only, or none */
+#define AST_VARIADIC  0x02 /* ends with `...` */
+
+/*
+Alignment of memory returned by `arena_alloc`.
+Enough for every scalar type uacc stores in an arena.
+*/
+#define ARENA_ALIGN 8
+
+/*
+Size of an arena block if `arena_init` gets 0.
+*/
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/*
+Character classes for `char_classes`.
+They are the classes of C source and do not depend
+on the locale.
+*/
+#define CC_IDENT_START 0x01 /* A-Z a-z _ */
+#define CC_IDENT       0x02 /* A-Z a-z _ 0-9 */
+#define CC_SPACE       0x04 /* space \t \n \v \f \r */
+#define CC_DIGIT       0x08 /* 0-9 */
+#define CC_HEX         0x10 /* 0-9 A-F a-f */
+#define CC_PUNCT       0x20 /* first characters of punctuators */
+
+/*
+Sets with at most this many characters are also searched
+by comparing with each character, many bytes at a time.
+*/
+#define CHARSET_FEW 4
+
+/*
+Largest size of memory and strings, the largest `int64`.
+*/
+#define MEM_SIZE_MAX LONG_MAX
+
+/*
+Marks of a header in the translation unit of a `Preprocessor`.
+*/
+#define PP_MARK_ENTERED 0x01 /* entered at least once */
+#define PP_MARK_ONCE    0x02 /* has done `#pragma once` */
+
+/*
+Number of slots in a pool chunk if `pool_init` gets 0.
+*/
+#define POOL_CHUNK_SLOTS 256
+
+/*
+Size of the storage inside a `Strbuf`. Strings shorter than
+this never allocate.
+*/
+#define SB_SMALL 24
+
+/*
+Flags of `AST_SPECS`: storage classes, type qualifiers and
+the words of basic types. Pointers keep their qualifiers in
+`AstNode.op`, so those fit in a byte.
+*/
+#define SPEC_TYPEDEF   0x00001
+#define SPEC_EXTERN    0x00002
+#define SPEC_STATIC    0x00004
+#define SPEC_AUTO      0x00008
+#define SPEC_REGISTER  0x00010
+#define SPEC_CONST     0x00020
+#define SPEC_VOLATILE  0x00040
+#define SPEC_VOID      0x00080
+#define SPEC_CHAR      0x00100
+#define SPEC_SHORT     0x00200
+#define SPEC_INT       0x00400
+#define SPEC_LONG      0x00800
+#define SPEC_FLOAT     0x01000
+#define SPEC_DOUBLE    0x02000
+#define SPEC_SIGNED    0x04000
+#define SPEC_UNSIGNED  0x08000
+/* Not C89, but the headers of the host use it. */
+#define SPEC_LONG_LONG 0x10000
+
+/*
+Flags of a token in `Tokens`.
+*/
+#define TF_BOL      0x01 /* first on a line */
+#define TF_SPACE    0x02 /* space or comment before */
+#define TF_DIRTY    0x04 /* has line splices or trigraphs */
+#define TF_UNCLOSED 0x08 /* literal without the closing quote */
+#define TF_SCRATCH  0x10 /* text is in the scratch of `pp_run` */
+#define TF_EXPANDED 0x20 /* made by a macro expansion */
+
+/*
+Storage of variables that each thread has its own copy of.
+Built with `UACC_NO_THREADS` uacc has only one thread.
+*/
+#ifdef UACC_NO_THREADS
+#define THREAD_LOCAL
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/*
+Flags of a `Vector`.
+By default it doubles the capacity and leaves new items as
+they are.
+*/
+#define VEC_EXACT 0x01 /* grow only to the capacity needed */
+#define VEC_ZEROS 0x02 /* zero items added without a value */
+
+/*
+Size of the buffer of a `Writer`. Output reaches `write` in
+chunks this big.
+*/
+#define WRITER_SIZE (1024 * 1024)
+
 /*----------------------------------------------------------*/
 /* TYPES                                                    */
 /*----------------------------------------------------------*/
 
 /*
-Unsigned 64-bit integer.
+Unsigned 64-bit integer.
+*/
+typedef unsigned long uint64;
+
+/*
+Signed 64-bit integer.
+Sizes, lengths and indices of memory and strings.
+*/
+typedef long int64;
+
+/*
+String buffer.
+Only `length + 1` bytes of `at` are meaningful, the last
+one is always '\0'.
+`at` points into the buffer itself while the string is
+short, so never copy a `Strbuf` by value.
+*/
+typedef struct Strbuf {
+  char *at;
+  int64 length;
+  int64 capacity;
+  int is_inited;
+  char small[SB_SMALL];
+} Strbuf;
+
+/*
+String view.
+*/
+typedef struct Strview {
+  const char *at;
+  int64 length;
+} Strview;
+
+/*
+Growable array of items of the same size.
+*/
+typedef struct Vector {
+  char *at;
+  int64 length;
+  int64 capacity;
+  int64 item_size;
+  /* `VEC_*` flags. */
+  int flags;
+  int is_inited;
+} Vector;
+
+/*
+Users of memory told apart by the memory statistics.
+*/
+typedef enum MemKind {
+  MEM_KIND_OTHER,
+  MEM_KIND_STRBUF,
+  MEM_KIND_ARENA,
+  MEM_KIND_POOL,
+  MEM_KIND_VECTOR,
+  MEM_KIND_TOKENS,
+  MEM_KIND_COUNT
+} MemKind;
+
+/*
+Memory statistics of one kind of users.
+They are counted only if uacc is built with `UACC_MEM_STATS`.
+*/
+typedef struct MemStats {
+  long live_bytes;
+  long peak_bytes;
+  long num_allocs;
+  long num_reallocs;
+} MemStats;
+
+/*
+Set of characters for the span functions.
+Made once by `cs_init` and reused for many strings.
+*/
+typedef struct Charset {
+  /* Non-zero for the characters in the set. */
+  unsigned char has[UCHAR_MAX + 1];
+  /* The characters if there are at most `CHARSET_FEW`. */
+  char few[CHARSET_FEW];
+  /* The number of characters in the set. */
+  int count;
+} Charset;
+
+/*
+Block of memory owned by an arena.
+The bytes of the block follow this header.
+*/
+typedef struct ArenaBlock {
+  struct ArenaBlock *prev;
+  int64 size;
+} ArenaBlock;
+
+/*
+Arena (region) allocator.
+Allocation moves a pointer forward inside the current block.
+Everything is freed at once by `arena_deinit`, `arena_clear`
+or `arena_rewind`.
+*/
+typedef struct Arena {
+  ArenaBlock *block;
+  char *at;
+  char *end;
+  int64 block_size;
+  int is_inited;
+} Arena;
+
+/*
+Position in an arena made by `arena_mark`.
+*/
+typedef struct ArenaMark {
+  ArenaBlock *block;
+  char *at;
+} ArenaMark;
+
+/*
+Chunk of slots owned by a pool.
+The slots of the chunk follow this header.
+*/
+typedef struct PoolChunk {
+  struct PoolChunk *prev;
+} PoolChunk;
+
+/*
+Pool of fixed-size slots.
+Freed slots are linked into a free list through their first
+bytes and are given out again before new ones.
+*/
+typedef struct Pool {
+  PoolChunk *chunk;
+  void *free_list;
+  char *at;
+  char *end;
+  int slot_size;
+  int chunk_slots;
+  /* Slots in use now. */
+  int live_slots;
+  /* High-water mark of `live_slots`. */
+  int peak_slots;
+  int is_inited;
+} Pool;
+
+/*
+Source file loaded into memory.
+Regular files are mapped, so `text` views the pages of
+the file directly. Pipes and other files are read into
+the heap.
+*/
+typedef struct Source {
+  /* The whole content of the file. */
+  Strview text;
+  /* The path the file was loaded by. */
+  Strbuf path;
+  /* Mapping of the file or NULL. */
+  char *map;
+  int64 map_size;
+  /* Copy of the file in the heap or NULL. */
+  char *heap;
+  /* Identity of the file. */
+  unsigned long device;
+  unsigned long inode;
+  long mtime;
+  /* Offsets where lines start, made by the first `src_locate`. */
+  int64 *lines;
+  int64 num_lines;
+  int is_inited;
+} Source;
+
+/*
+Output to a file descriptor through a big buffer, so that
+`write` is called rarely. Without a file descriptor the output
+is kept in the buffer, which grows.
+*/
+typedef struct Writer {
+  /* -1 to keep the output in memory. */
+  int fd;
+  char *at;
+  int64 length;
+  int64 capacity;
+  /* `errno` of the first failed `write` or 0. */
+  int error;
+  int is_inited;
+} Writer;
+
+/*
+128-bit hash of bytes added a piece at a time, for keys that
+must not collide by chance. Not cryptographic.
+*/
+typedef struct Digest {
+  uint64 a;
+  uint64 b;
+} Digest;
+
+/*
+Results of compilation kept on disk between runs, by a
+`Digest` of what was compiled. Each entry is a file named by
+the key in hex, in a subdirectory named by its first two
+digits. Entries are written whole under another name and
+renamed, so runs and threads can share the directory. The
+time of an entry is when it was last used, and the least
+recently used go first when all take more than `max_size`.
+*/
+typedef struct DiskCache {
+  Strbuf dir;
+  /* Bytes the entries may take, 0 for no limit. */
+  int64 max_size;
+  int is_inited;
+} DiskCache;
+
+/*
+Keywords of C. `intern_init` interns them first, so the ID
+of a keyword is its value here and any ID below `KW_COUNT`
+is a keyword.
+*/
+typedef enum Keyword {
+  KW_NONE,
+  KW_AUTO,
+  KW_BREAK,
+  KW_CASE,
+  KW_CHAR,
+  KW_CONST,
+  KW_CONTINUE,
+  KW_DEFAULT,
+  KW_DO,
+  KW_DOUBLE,
+  KW_ELSE,
+  KW_ENUM,
+  KW_EXTERN,
+  KW_FLOAT,
+  KW_FOR,
+  KW_GOTO,
+  KW_IF,
+  KW_INT,
+  KW_LONG,
+  KW_REGISTER,
+  KW_RETURN,
+  KW_SHORT,
+  KW_SIGNED,
+  KW_SIZEOF,
+  KW_STATIC,
+  KW_STRUCT,
+  KW_SWITCH,
+  KW_TYPEDEF,
+  KW_UNION,
+  KW_UNSIGNED,
+  KW_VOID,
+  KW_VOLATILE,
+  KW_WHILE,
+  KW_COUNT
+} Keyword;
+
+/*
+Words of the preprocessor. `intern_init` interns them right
+after the keywords, so the ID of a word is its value here.
+`#if` and `#else` are `KW_IF` and `KW_ELSE`.
+*/
+typedef enum PPWord {
+  PW_DEFINE = KW_COUNT,
+  PW_DEFINED,
+  PW_ELIF,
+  PW_ENDIF,
+  PW_ERROR,
+  PW_IFDEF,
+  PW_IFNDEF,
+  PW_INCLUDE,
+  PW_LINE,
+  PW_ONCE,
+  PW_PRAGMA,
+  PW_UNDEF,
+  /* Macros of the preprocessor itself. */
+  PW_MACRO_DATE,
+  PW_MACRO_FILE,
+  PW_MACRO_LINE,
+  PW_MACRO_TIME,
+  PW_COUNT
+} PPWord;
+
+/*
+Lock held by one thread at a time. It does nothing if uacc is
+built with `UACC_NO_THREADS`.
+*/
+typedef struct Lock {
+#ifndef UACC_NO_THREADS
+  pthread_mutex_t mutex;
+#endif
+  int is_inited;
+} Lock;
+
+/*
+Slot of the hash table of `Interns`.
+*/
+typedef struct InternSlot {
+  unsigned hash;
+  int id;
+} InternSlot;
+
+/*
+Hash table of `Interns`, replaced as a whole when it grows.
+*/
+typedef struct InternTable {
+  InternSlot *slots;
+  int num_slots;
+} InternTable;
+
+/*
+Table of interned strings.
+Every distinct string gets a small ID starting from 1 and
+one canonical copy, so interned strings are compared by ID
+or by pointer. Threads find strings without a lock, so what
+grows is copied and the old copies are kept until deinit.
+*/
+typedef struct Interns {
+  /* Storage of the canonical copies. */
+  Arena arena;
+  /* Open addressing with linear probing, 0 ID is empty. */
+  InternTable *table;
+  /* The canonical copies by ID. */
+  Strview *strings;
+  int num_strings;
+  int cap_strings;
+  /* Tables and copies of `strings` replaced by bigger ones. */
+  Vector retired;
+  /* Held to add a string. */
+  Lock lock;
+  int is_inited;
+} Interns;
+
+/*
+Entry of a `Map`. Key 0 means an empty entry.
+*/
+typedef struct MapEntry {
+  int key;
+  void *value;
+} MapEntry;
+
+/*
+Change of a `Map` made inside a scope, so it can be undone.
+*/
+typedef struct MapUndo {
+  int key;
+  /* The value before the change or NULL if there was none. */
+  void *value;
+} MapUndo;
+
+/*
+Hash map from interned IDs to pointers.
+Entries are stored flat with linear probing and removed by
+shifting the next entries back, so there are no tombstones.
+When the map grows, the entries move to the new table a few
+at a time by later calls, so no single call stalls.
+Changes made inside a scope are logged and undone when the
+scope is popped.
+*/
+typedef struct Map {
+  MapEntry *entries;
+  int num_entries;
+  int count;
+  /* The previous table while entries move out of it. */
+  MapEntry *old_entries;
+  int num_old_entries;
+  int old_count;
+  int old_index;
+  /* Changes made in scopes, the newest at the end. */
+  MapUndo *undo;
+  int num_undo;
+  int cap_undo;
+  /* Where each scope starts in `undo`. */
+  int *scopes;
+  int num_scopes;
+  int cap_scopes;
+  int is_inited;
+} Map;
+
+/*
+Kinds of tokens. Keywords are `TK_IDENT` with an ID below
+`KW_COUNT`.
+*/
+typedef enum TokenKind {
+  TK_EOF,
+  TK_IDENT,
+  TK_NUMBER,
+  TK_CHAR,
+  TK_STRING,
+  /* Characters that cannot start any other token. */
+  TK_OTHER,
+  TK_LBRACK,     /* [ */
+  TK_RBRACK,     /* ] */
+  TK_LPAREN,     /* ( */
+  TK_RPAREN,     /* ) */
+  TK_LBRACE,     /* { */
+  TK_RBRACE,     /* } */
+  TK_DOT,        /* . */
+  TK_ARROW,      /* -> */
+  TK_INC,        /* ++ */
+  TK_DEC,        /* -- */
+  TK_AMP,        /* & */
+  TK_STAR,       /* * */
+  TK_PLUS,       /* + */
+  TK_MINUS,      /* - */
+  TK_TILDE,      /* ~ */
+  TK_NOT,        /* ! */
+  TK_SLASH,      /* / */
+  TK_PERCENT,    /* % */
+  TK_SHL,        /* << */
+  TK_SHR,        /* >> */
+  TK_LT,         /* < */
+  TK_GT,         /* > */
+  TK_LE,         /* <= */
+  TK_GE,         /* >= */
+  TK_EQ,         /* == */
+  TK_NE,         /* != */
+  TK_CARET,      /* ^ */
+  TK_PIPE,       /* | */
+  TK_AND,        /* && */
+  TK_OR,         /* || */
+  TK_QUESTION,   /* ? */
+  TK_COLON,      /* : */
+  TK_SEMI,       /* ; */
+  TK_ELLIPSIS,   /* ... */
+  TK_ASSIGN,     /* = */
+  TK_MUL_ASSIGN, /* *= */
+  TK_DIV_ASSIGN, /* /= */
+  TK_MOD_ASSIGN, /* %= */
+  TK_ADD_ASSIGN, /* += */
+  TK_SUB_ASSIGN, /* -= */
+  TK_SHL_ASSIGN, /* <<= */
+  TK_SHR_ASSIGN, /* >>= */
+  TK_AND_ASSIGN, /* &= */
+  TK_XOR_ASSIGN, /* ^= */
+  TK_OR_ASSIGN,  /* |= */
+  TK_COMMA,      /* , */
+  TK_HASH,       /* # */
+  TK_HASH_HASH,  /* ## */
+  TK_COUNT
+} TokenKind;
+
+/*
+Tokens of a text as a structure of arrays: the token `i`
+is `kinds[i]`, `flags[i]`, `offsets[i]` and so on.
+The last token is always `TK_EOF`.
+*/
+typedef struct Tokens {
+  /* `TK_*` kinds. */
+  unsigned char *kinds;
+  /* `TF_*` flags. */
+  unsigned char *flags;
+  /* Where the text of the token starts. */
+  int64 *offsets;
+  /* Length of the text with splices and trigraphs. */
+  int *lengths;
+  /* Interned IDs of identifiers, 0 for other tokens. */
+  int *ids;
+  int count;
+  int capacity;
+  int is_inited;
+} Tokens;
+
+/*
+File loaded and lexed once for the whole run of uacc and
+shared by every translation unit that includes it. It does
+not change after `HeaderCache` has published it.
+*/
+typedef struct Header {
+  Source src;
+  Tokens tokens;
+  /* Where the text starts among the offsets of `pp_run`. */
+  int64 base;
+  /* Position in `HeaderCache.headers`. */
+  int index;
+  /* Interned path the file was first found by. */
+  int path_id;
+  /* Macro of the include guard around the whole file or 0. */
+  int guard_id;
+  int is_lex_ok;
+  /* The text and the tokens are in the mapping of a `PCH`. */
+  int is_pch;
+  /* Messages of the lexer, given to each translation unit
+  that enters the file. */
+  Strbuf errors;
+} Header;
+
+/*
+Headers of the whole run of uacc. Paths found missing are
+remembered too, so they are never looked up again.
+Threads find headers without a lock. A file is loaded and
+lexed by a thread alone, then published under `lock`; if
+another thread has published the path first, its header wins.
+Arrays that grow are copied and the old copies kept.
+*/
+typedef struct HeaderCache {
+  Interns *interns;
+  /* Header by interned path, NULL if the path was not looked
+  up yet or a mark of a missing path. */
+  Header **paths;
+  int num_paths;
+  /* All headers in the order of `base`. */
+  Header **headers;
+  int num_headers;
+  int cap_headers;
+  /* Directories searched by `#include`, `char *` each. */
+  Vector dirs;
+  /* Definitions made before every translation unit. */
+  Header *builtin;
+  /* Base of the next header. */
+  int64 next_base;
+  /* Copies of `paths` and `headers` replaced by bigger ones. */
+  Vector retired;
+  /* Held to publish a header or a path. */
+  Lock lock;
+  int is_inited;
+} HeaderCache;
+
+/*
+Macro made by `#define`. Its body is a range of tokens of the
+header it is defined in.
+*/
+typedef struct Macro {
+  /* NULL for the macros of the preprocessor itself. */
+  Header *header;
+  /* Index of the name token. */
+  int name;
+  /* Body is tokens from `first` to `first + num_body - 1`. */
+  int first;
+  int num_body;
+  /* IDs of parameters, -1 of them for object-like macros. */
+  int *params;
+  int num_params;
+} Macro;
+
+/*
+Precompiled header: the state of a translation unit after it
+has preprocessed a header, saved by `pch_save`. The file is
+mapped and used in place: it has no pointers, only offsets,
+and the headers in it are published in the `HeaderCache`
+with their tokens in the mapping.
+*/
+typedef struct PCH {
+  /* The mapped file. */
+  Source src;
+  /* Headers of the file in the order they were published. */
+  Header **headers;
+  int num_headers;
+  /* `PP_MARK_*` flags of `headers` at the end of the unit. */
+  unsigned char *marks;
+  /* Macros defined at the end and the IDs of their names. */
+  Macro *macros;
+  int *macro_ids;
+  int num_macros;
+  /* Output tokens, offsets as they were when it was made. */
+  Tokens out;
+  /* Text of the output tokens with `TF_SCRATCH`. */
+  Strview scratch;
+  /* Where the headers started when it was made and how far
+  they have moved in this run. */
+  int64 first_base;
+  int64 delta;
+  int is_inited;
+} PCH;
+
+/*
+Preprocessing of one translation unit. Output tokens keep
+their kinds, flags, lengths and IDs, the offset is `base` of
+the header plus the offset in its text. Tokens made by `#`,
+`##` and the macros of the preprocessor have `TF_SCRATCH`
+and their offset is in `scratch`.
+*/
+typedef struct Preprocessor {
+  HeaderCache *cache;
+  Tokens *out;
+  /* Macro by ID of its name. */
+  Map macros;
+  /* Storage of macros. */
+  Arena arena;
+  /* Tokens being expanded, freed after each expansion. */
+  Arena expand_arena;
+  /* Text of the tokens made by expansion. */
+  Strbuf scratch;
+  /* Offsets of `__DATE__` and `__TIME__` in `scratch`. */
+  int64 date_offset;
+  int64 time_offset;
+  /* Token where the expansion being done started. */
+  Header *site;
+  int site_token;
+  /* File being read, a `PPFile` of uacc_pp.c. */
+  struct PPFile *file;
+  /* Where `pp_stream` prints the output or NULL. */
+  Writer *writer;
+  /* Header and line of the text line being printed. */
+  Header *print_header;
+  int64 print_line;
+  /* Kind, flags and last character of the token printed last,
+  the character is '\n' at the start of a line. */
+  int print_kind;
+  int print_flags;
+  int print_last;
+  /* Output tokens printed and cleared. */
+  int64 num_printed;
+  /* Lines of the output tokens that start a line with an
+  expansion, while printed. */
+  Vector sites;
+  /* Message being composed. */
+  Strbuf message;
+  /* Messages of the errors of the unit for the caller. */
+  Strbuf errors;
+  /* Spelling of a dirty token. */
+  Strbuf spelling;
+  /* Nesting of `#include`. */
+  int depth;
+  /* `PP_MARK_*` flags of headers by `Header.index`. */
+  Vector marks;
+  /* Path being looked up by `hc_find`. */
+  Strbuf path;
+  /* State to start the unit with or NULL. */
+  PCH *pch;
+  int num_errors;
+  int is_inited;
+} Preprocessor;
+
+/*
+Kinds of `AstNode`. The comments tell what `a`, `b` and `c`
+hold. A list is a range of `Ast.lists` given by its start and
+count, an ID is interned and a token is an index of the output
+of the preprocessor. Missing children are 0.
+*/
+typedef enum AstKind {
+  AST_NONE,
+  /* List of AST_DECL and AST_FUNC. */
+  AST_UNIT,
+  /* AST_SPECS, list of AST_INIT_DECL or, in a struct,
+  of AST_FIELD. */
+  AST_DECL,
+  /* AST_SPECS or 0 for `int`, declarator, AST_COMPOUND. */
+  AST_FUNC,
+  /* `SPEC_*` flags, AST_STRUCT, AST_UNION, AST_ENUM or
+  AST_TYPEDEF_NAME. */
+  AST_SPECS,
+  /* ID. */
+  AST_TYPEDEF_NAME,
+  /* ID of the tag or 0, list of AST_DECL. The count is -1
+  if there is no body. */
+  AST_STRUCT,
+  AST_UNION,
+  /* ID of the tag or 0, list of AST_ENUMERATOR. The count is
+  -1 if there is no body. */
+  AST_ENUM,
+  /* ID, value. */
+  AST_ENUMERATOR,
+  /* Declarator, initializer. */
+  AST_INIT_DECL,
+  /* Declarator, width. */
+  AST_FIELD,
+  /* AST_SPECS, declarator. AST_SPECS is 0 for a name of an
+  old style definition that is not declared, it is `int`. */
+  AST_PARAM,
+  /* AST_SPECS, abstract declarator. */
+  AST_TYPE_NAME,
+  /* Declarators. Each applies to the type of the one outside
+  it, down to the AST_D_NAME which is always there. */
+  /* ID or 0 if abstract. */
+  AST_D_NAME,
+  /* Declarator. `op` has SPEC_CONST and SPEC_VOLATILE. */
+  AST_D_POINTER,
+  /* Declarator, size. */
+  AST_D_ARRAY,
+  /* Declarator, list of AST_PARAM. `op` has `AST_OLD_STYLE`
+  and `AST_VARIADIC`. */
+  AST_D_FUNC,
+  /* List of initializers. */
+  AST_INIT_LIST,
+  /* List of AST_DECL and then statements. */
+  AST_COMPOUND,
+  /* Expression or 0 for `;`. */
+  AST_EXPR_STMT,
+  /* Condition, statement, `else` statement. */
+  AST_IF,
+  /* Expression, statement. */
+  AST_SWITCH,
+  /* Condition, statement. */
+  AST_WHILE,
+  /* Statement, condition. */
+  AST_DO,
+  /* Start of the 3 expressions in `lists`, statement. */
+  AST_FOR,
+  /* ID, statement. */
+  AST_LABEL,
+  /* Expression, statement. */
+  AST_CASE,
+  /* Statement. */
+  AST_DEFAULT,
+  /* ID. */
+  AST_GOTO,
+  AST_CONTINUE,
+  AST_BREAK,
+  /* Expression. */
+  AST_RETURN,
+  /* Expressions. `op` is the `TK_*` kind of the operator. */
+  /* ID. */
+  AST_NAME,
+  /* Token of a number or a character. */
+  AST_CONSTANT,
+  /* Token of the first literal, number of literals. */
+  AST_STRING,
+  /* Operand, for `&`, `*`, `+`, `-`, `~`, `!` and prefix `++`
+  and `--`. */
+  AST_UNARY,
+  /* Operand, for postfix `++` and `--`. */
+  AST_POSTFIX,
+  /* Operand. */
+  AST_SIZEOF_EXPR,
+  /* AST_TYPE_NAME. */
+  AST_SIZEOF_TYPE,
+  /* AST_TYPE_NAME, operand. */
+  AST_CAST,
+  /* Operands, also for `&&`, `||` and `,`. */
+  AST_BINARY,
+  /* Operands, for `=` and the compound assignments. */
+  AST_ASSIGN,
+  /* Condition, operands. */
+  AST_COND,
+  /* Function, list of arguments. */
+  AST_CALL,
+  /* Array, index. */
+  AST_INDEX,
+  /* Operand, ID, for `.` and `->`. */
+  AST_MEMBER,
+  /* Operand, AST_TYPE_NAME, for `__builtin_va_arg` of the
+  headers of the host. */
+  AST_VA_ARG,
+  /* AST_TYPE_NAME, AST_MEMBER and AST_INDEX of operand 0, for
+  `__builtin_offsetof` of the headers of the host. */
+  AST_OFFSETOF,
+  AST_KIND_COUNT
+} AstKind;
+
+/*
+Node of an `Ast`. Nodes refer to each other by 32-bit indices,
+so a node takes 24 bytes.
+*/
+typedef struct AstNode {
+  /* `AST_*` kind. */
+  unsigned char kind;
+  /* Operator or flags by the kind. */
+  unsigned char op;
+  /* Children, IDs and lists by the kind, see `AstKind`. */
+  int a;
+  int b;
+  int c;
+  /* Where the node starts as in `Tokens.offsets`. Tokens with
+  `TF_SCRATCH` give the place of the token before them. */
+  int64 offset;
+} AstNode;
+
+/*
+Syntax tree of a translation unit. Nodes and lists live in
+`arena` as arrays that are moved when they grow, so the tree
+is freed at once. Node 0 stands for a missing child.
+*/
+typedef struct Ast {
+  Arena arena;
+  AstNode *nodes;
+  int num_nodes;
+  int cap_nodes;
+  /* Indices of the nodes in lists, see `AstKind`. */
+  int *lists;
+  int num_lists;
+  int cap_lists;
+  /* The AST_UNIT node. */
+  int root;
+  int is_inited;
+} Ast;
+
+/*
+Statistics of the preprocessor printed by `--pp-stats`.
+*/
+typedef struct PPStats {
+  /* `#include` lines done. */
+  int64 num_includes;
+  /* Files read and lexed. */
+  int64 num_loads;
+  /* Includes of a loaded file that reused its tokens. */
+  int64 num_reuses;
+  /* Includes skipped by an include guard. */
+  int64 num_guard_skips;
+  /* Includes skipped by `#pragma once`. */
+  int64 num_once_skips;
+  /* Calls of `stat` to find files. */
+  int64 num_stats;
+  /* Paths known to be missing without `stat`. */
+  int64 num_missing_hits;
+  /* Macro invocations replaced by their bodies. */
+  int64 num_expansions;
+  /* Output tokens taken from precompiled headers. */
+  int64 num_pch_tokens;
+} PPStats;
+
+/*
+Statistics of the disk cache printed by `--cache-stats`.
+*/
+typedef struct CacheStats {
+  /* Results found in the cache. */
+  int64 num_hits;
+  /* Results not found, so they were made. */
+  int64 num_misses;
+  /* Results written to the cache. */
+  int64 num_stores;
+  /* Entries removed to fit the size, and their bytes. */
+  int64 num_evictions;
+  int64 evicted_bytes;
+  /* Entries and their bytes after `dc_trim`. */
+  int64 num_entries;
+  int64 size;
+  int is_trimmed;
+} CacheStats;
+
+/*
+Phases of compilation timed for `--time`.
+*/
+typedef enum Phase {
+  PHASE_LOAD,
+  PHASE_LEX,
+  PHASE_PP,
+  PHASE_PARSE,
+  PHASE_COUNT
+} Phase;
+
+/*
+Time spent in a phase and the work done there.
+*/
+typedef struct PhaseStats {
+  double seconds;
+  /* Bytes of source text. */
+  int64 bytes;
+  /* Files for loading, tokens for lexing, output tokens
+  for preprocessing and nodes for parsing. */
+  int64 items;
+} PhaseStats;
+
+/*
+Global variables.
+*/
+typedef struct Globals {
+  /* Memory statistics by `MemKind`. */
+  MemStats mem_stats[MEM_KIND_COUNT];
+  /* Memory statistics of all kinds together. */
+  MemStats mem_total;
+  /* Time statistics by `Phase`. */
+  PhaseStats phase_stats[PHASE_COUNT];
+  /* Preprocessor statistics of all translation units. */
+  PPStats pp_stats;
+  /* Disk cache statistics of all translation units. */
+  CacheStats cache_stats;
+} Globals;
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: CHARACTER SET                                 */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+cc_is   | Check if the character is in the classes
+cs_has  | Check if the set has the character
+cs_init | Make a set from the characters of a string
+*/
+
+/*
+Check if `ch` is in any of `classes`, which are `CC_*`
+flags joined by `|`.
+*/
+int
+cc_is(char ch, int classes);
+
+/*
+Check if `cs` has `ch`.
+*/
+int
+cs_has(const Charset *cs, char ch);
+
+/*
+Init `cs` to the set of characters in `sample`.
+*/
+void
+cs_init(Charset *cs, Strview sample);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: INTERN                                        */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+intern_deinit | Free the memory used by the table
+intern_find   | Find the ID of a string
+intern_init   | Prepare a table for work
+intern_sv     | Intern a string
+intern_view   | Get the canonical copy by ID
+*/
+
+/*
+Deinit `interns`. Canonical copies become invalid.
+*/
+void
+intern_deinit(Interns *interns);
+
+/*
+Find the ID of `string` in `interns`.
+Returns 0 if `string` was never interned.
+*/
+int
+intern_find(Interns *interns, Strview string);
+
+/*
+Init `interns` with the keywords of C as the first strings.
+*/
+void
+intern_init(Interns *interns);
+
+/*
+Get the ID of `string` interning it if needed.
+*/
+int
+intern_sv(Interns *interns, Strview string);
+
+/*
+Get the canonical copy of the string with `id`.
+The copy is followed by the null character.
+*/
+Strview
+intern_view(Interns *interns, int id);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: MAP                                           */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+map_deinit     | Free the memory used by the map
+map_get        | Get the value by a key
+map_init       | Prepare a map for work
+map_pop_scope  | Undo the changes of the innermost scope
+map_push_scope | Start a new scope
+map_remove     | Remove a key
+map_set        | Set the value of a key
+*/
+
+/*
+Deinit `map`. You cannot use `map` unless you init it again.
+*/
+void
+map_deinit(Map *map);
+
+/*
+Get the value of `key` in `map` or NULL if there is none.
+*/
+void *
+map_get(Map *map, int key);
+
+/*
+Init `map` to an empty map with no scopes.
+*/
+void
+map_init(Map *map);
+
+/*
+Undo all changes made to `map` since the matching
+`map_push_scope`. Takes time proportional to the number
+of the changes.
+*/
+void
+map_pop_scope(Map *map);
+
+/*
+Start a new scope in `map`.
+*/
+void
+map_push_scope(Map *map);
+
+/*
+Remove `key` from `map` if it is there.
+*/
+void
+map_remove(Map *map, int key);
+
+/*
+Set the value of `key` in `map` to `value`.
+`key` must be positive and `value` must not be NULL.
+*/
+void
+map_set(Map *map, int key, void *value);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: MEMORY                                        */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+mem_alloc         | Allocate memory
+mem_alloc_for     | Allocate memory for some kind of users
+mem_alloc_zeros   | Allocate memory and clear all bytes
+mem_clear         | Set all bytes to zero
+mem_free          | Free previously allocated memory
+mem_print_stats   | Print the memory statistics
+mem_realloc       | Reallocate memory
+mem_realloc_zeros | Reallocate memory and clear new bytes
+mem_size_add      | Add sizes checking for overflow
+mem_size_mul      | Multiply sizes checking for overflow
+*/
+
+/*
+Allocate `size` bytes of memory.
+*/
+void *
+mem_alloc(int64 size);
+
+/*
+Allocate `size` bytes of memory used by `kind`.
+Reallocations and frees are counted for the same kind.
+*/
+void *
+mem_alloc_for(MemKind kind, int64 size);
+
+/*
+Allocate `size` bytes of memory and fill it with zeros.
+*/
+void *
+mem_alloc_zeros(int64 size);
+
+/*
+Set `size` bytes by `ptr` to zero.
+*/
+void
+mem_clear(void *ptr, int64 size);
+
+/*
+Free previously allocated memory.
+*/
+void
+mem_free(void *ptr);
+
+/*
+Print the memory statistics and the peak resident set size
+to `file`.
+*/
+void
+mem_print_stats(FILE *file);
+
+/*
+Change the size of previously allocated memory.
+`ptr` - the pointer to the memory.
+`size` - new size.
+*/
+void *
+mem_realloc(void *ptr, int64 size);
+
+/*
+Change the size of previously allocated memory.
+`ptr` - the pointer to the memory.
+`size` - new size.
+`old_size` - the size of the memory.
+All new bytes set to 0.
+*/
+void *
+mem_realloc_zeros(void *ptr, int64 size, int64 old_size);
+
+/*
+Add sizes `a` and `b`. If the sum does not fit `int64`,
+print an error and exit.
+*/
+int64
+mem_size_add(int64 a, int64 b);
+
+/*
+Multiply sizes `a` and `b`. If the product does not fit
+`int64`, print an error and exit.
+*/
+int64
+mem_size_mul(int64 a, int64 b);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: ARENA                                         */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+arena_alloc       | Allocate memory
+arena_alloc_align | Allocate memory with the given alignment
+arena_alloc_zeros | Allocate memory and clear all bytes
+arena_clear       | Free all allocations
+arena_deinit      | Free the memory used by the arena
+arena_init        | Prepare an arena for work
+arena_mark        | Remember the current position
+arena_rewind      | Free allocations made after the mark
+*/
+
+/*
+Allocate `size` bytes from `arena` aligned to `ARENA_ALIGN`.
+The memory lives until the arena is cleared, rewound
+or deinited.
+*/
+void *
+arena_alloc(Arena *arena, int64 size);
+
+/*
+Allocate `size` bytes from `arena` aligned to `align`.
+`align` must be a power of two.
+*/
+void *
+arena_alloc_align(Arena *arena, int64 size, int align);
+
+/*
+Allocate `size` bytes from `arena` and fill them with zeros.
+*/
+void *
+arena_alloc_zeros(Arena *arena, int64 size);
+
+/*
+Free all allocations made from `arena` at once.
+The first block is kept for the next allocations.
+*/
+void
+arena_clear(Arena *arena);
+
+/*
+Deinit `arena` and free all its memory.
+You cannot use `arena` unless you init it again.
+*/
+void
+arena_deinit(Arena *arena);
+
+/*
+Init `arena` with blocks of `block_size` bytes.
+If `block_size` is 0 then `ARENA_BLOCK_SIZE` is used.
+Bigger allocations get blocks of their own.
+*/
+void
+arena_init(Arena *arena, int64 block_size);
+
+/*
+Remember the current position of `arena`.
+*/
+ArenaMark
+arena_mark(Arena *arena);
+
+/*
+Free all allocations made from `arena` after `mark`.
+*/
+void
+arena_rewind(Arena *arena, ArenaMark mark);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: POOL                                          */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+pool_alloc       | Allocate a slot
+pool_alloc_zeros | Allocate a slot and clear all bytes
+pool_clear       | Free all slots
+pool_deinit      | Free the memory used by the pool
+pool_free        | Free a slot
+pool_init        | Prepare a pool for work
+*/
+
+/*
+Allocate a slot from `pool`.
+The slot is aligned to `ARENA_ALIGN`.
+*/
+void *
+pool_alloc(Pool *pool);
+
+/*
+Allocate a slot from `pool` and fill it with zeros.
+*/
+void *
+pool_alloc_zeros(Pool *pool);
+
+/*
+Free all slots of `pool` at once.
+One chunk is kept for the next allocations.
+*/
+void
+pool_clear(Pool *pool);
+
+/*
+Deinit `pool` and free all its memory.
+You cannot use `pool` unless you init it again.
+*/
+void
+pool_deinit(Pool *pool);
+
+/*
+Give the slot by `ptr` back to `pool`.
+*/
+void
+pool_free(Pool *pool, void *ptr);
+
+/*
+Init `pool` for slots of `slot_size` bytes, usually
+the size of some type. Memory is taken `chunk_slots` slots
+at a time. If `chunk_slots` is 0 then `POOL_CHUNK_SLOTS`
+is used.
+*/
+void
+pool_init(Pool *pool, int slot_size, int chunk_slots);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: STRING BUFFER                                 */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+sb_append        | Append a string
+sb_append_bytes  | Append an array of characters
+sb_append_char   | Append a character
+sb_append_hex    | Append a hexadecimal number
+sb_append_int    | Append a decimal number
+sb_append_sv     | Append a string view
+sb_append_uint   | Append an unsigned decimal number
+sb_at            | Reference the character by index
+sb_clear         | Remove all characters
+sb_copy          | Copy a string
+sb_deinit        | Free the memory used by the string buffer
+sb_init          | Prepare a string buffer for work
+sb_insert        | Insert a string
+sb_insert_bytes  | Insert an array of characters
+sb_insert_sv     | Insert a string view
+sb_remove        | Remove characters
+sb_replace       | Replace characters with a string
+sb_replace_bytes | Replace characters with an array of characters
+sb_replace_sv    | Replace characters with a string view
+sb_reserve       | Reserve memory for characters
+sb_view          | Make a string view
+*/
+
+/*
+Append a formated string.
+Formating is done by uacc itself in a single pass and
+supports the flags `-0+ #`, width, precision, `*`,
+the `h` and `l` modifiers and the conversions
+`%d %i %u %o %x %X %c %s %p %%`. Any other conversion, such
+as `%f`, fails an assertion, as its argument cannot be read.
+*/
+void
+sb_append(Strbuf *sb, const char *fmt, ...);
+
+/*
+Append `n` characters from `at` without formating.
+*/
+void
+sb_append_bytes(Strbuf *sb, const char *at, int64 n);
+
+/*
+Append the character `ch`.
+*/
+void
+sb_append_char(Strbuf *sb, char ch);
+
+/*
+Append `value` as a lower case hexadecimal number
+without the `0x` prefix.
+*/
+void
+sb_append_hex(Strbuf *sb, unsigned long value);
+
+/*
+Append `value` as a decimal number.
+*/
+void
+sb_append_int(Strbuf *sb, long value);
+
+/*
+Append the characters of `sv` without formating.
+*/
+void
+sb_append_sv(Strbuf *sb, Strview sv);
+
+/*
+Append `value` as an unsigned decimal number.
+*/
+void
+sb_append_uint(Strbuf *sb, unsigned long value);
+
+/*
+Get the pointer to the character in `sb` at `i`.
+Negative values of `i` are used as a reverse index.
+If `sb->length` is 0 this function returns the pointer
+to the null character.
+*/
+char *
+sb_at(Strbuf *sb, int64 i);
+
+/*
+Remove all characters from `sb`. Keeps the memory.
+*/
+void
+sb_clear(Strbuf *sb);
+
+/*
+Replace the content of `sb` with a formated string.
+*/
+void
+sb_copy(Strbuf *sb, const char *fmt, ...);
+
+/*
+Deinit `sb`. You cannot use `sb` unless you init it again.
+*/
+void
+sb_deinit(Strbuf *sb);
+
+/*
+Init `sb` to an empty string.
+You should init `sb` before using it in other functions.
+Does not allocate memory until the string outgrows `SB_SMALL`.
+*/
+void
+sb_init(Strbuf *sb);
+
+/*
+Insert a formated string into `sb` at `i`.
+Negative values of `i` are used as a reverse index.
+If `i` equals `sb->length` then this function appends
+the fromated string.
+*/
+void
+sb_insert(Strbuf *sb, int64 i, const char *fmt, ...);
+
+/*
+Insert `n` characters from `at` into `sb` at `i`
+without formating.
+Negative values of `i` are used as a reverse index.
+*/
+void
+sb_insert_bytes(Strbuf *sb, int64 i, const char *at, int64 n);
+
+/*
+Insert the characters of `sv` into `sb` at `i`
+without formating.
+Negative values of `i` are used as a reverse index.
+*/
+void
+sb_insert_sv(Strbuf *sb, int64 i, Strview sv);
+
+/*
+Remove `n` characters in `sb` at `i`.
+Negative values of `i` are used as a reverse index.
+If `i` equals `sb->length` then this function does nothing.
+*/
+void
+sb_remove(Strbuf *sb, int64 i, int64 n);
+
+/*
+Replace `n` characters in `sb` at `i` with a formated string.
+Negative values of `i` are used as a reverse index.
+If `i` equals `sb->length` then this function appends
+the fromated string.
+*/
+void
+sb_replace(Strbuf *sb, int64 i, int64 n, const char *fmt, ...);
+
+/*
+Replace `n` characters in `sb` at `i` with `count`
+characters from `at` without formating.
+Negative values of `i` are used as a reverse index.
+*/
+void
+sb_replace_bytes(Strbuf *sb, int64 i, int64 n, const char *at, int64 count);
+
+/*
+Replace `n` characters in `sb` at `i` with the characters
+of `sv` without formating.
+Negative values of `i` are used as a reverse index.
+*/
+void
+sb_replace_sv(Strbuf *sb, int64 i, int64 n, Strview sv);
+
+/*
+Prepare `sb` to store at least `cap` characters.
+*/
+void
+sb_reserve(Strbuf *sb, int64 cap);
+
+/*
+String view from `sb`.
+*/
+Strview
+sb_view(Strbuf *sb);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: SOURCE                                        */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+src_load   | Load a source file
+src_locate | Find the line and the column of an offset
+src_unload | Free the memory used by the source file
+*/
+
+/*
+Load the file by `path` into `src`.
+The path `-` means the standard input.
+Returns 0 and sets `errno` if the file cannot be loaded.
+*/
+int
+src_load(Source *src, const char *path);
+
+/*
+Find the `line` and the `column` of the character at `offset`
+in `src->text`, both count from 1. The first call indexes
+the starts of all lines, so the lexer does not track them.
+*/
+void
+src_locate(Source *src, int64 offset, int64 *line, int64 *column);
+
+/*
+Unload `src`. Views of `src->text` become invalid.
+*/
+void
+src_unload(Source *src);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: STRING VIEW                                   */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+
+sv_array              | View an array
+sv_compare            | Compare two strings
+sv_contains_char      | Check if the string contains the character
+sv_contains_sv        | Check if the string contains another
+sv_cstr               | View a zero terminated string
+sv_cut                | Remove the first characters
+sv_count_char         | Count such characters
+sv_cut_end            | Remove the last characters
+sv_equal              | Check if two strings are equal
+sv_equal_no_case      | Check if two strings are equal
+sv_filter             | Count from the start while filter
+sv_filter_end         | Count from the end while filter
+sv_filter_not         | Count from the start until filter
+sv_filter_not_end     | Count from the end until filter
+sv_find_char          | Find the first such character
+sv_find_char_end      | Find the last such character
+sv_find_sv            | Find the first such string
+sv_find_sv_end        | Find the last such string
+sv_get                | Take the first characters
+sv_get_end            | Take the last characters
+sv_hash               | Hash the string
+sv_prefix             | Check if the string starts with prefix
+sv_span               | Count from the start while in the sample
+sv_span_class         | Count from the start while in the classes
+sv_span_class_end     | Count from the end while in the classes
+sv_span_end           | Count from the end while in the sample
+sv_span_not           | Count from the start until in the sample
+sv_span_not_class     | Count from the start until in the classes
+sv_span_not_class_end | Count from the end until in the classes
+sv_span_not_end       | Count from the end until in the sample
+sv_span_not_set       | Count from the start until in the set
+sv_span_not_set_end   | Count from the end until in the set
+sv_span_set           | Count from the start while in the set
+sv_span_set_end       | Count from the end while in the set
+sv_substr             | Get the sub-string from the string
+sv_suffix             | Check if the string ends with suffix
+
+*/
+
+/*
+String view from an array of characters.
+*/
+Strview
+sv_array(const char *chars, int64 length);
+
+/*
+Compare `string` to `another`.
+*/
+int
+sv_compare(Strview string, Strview another);
+
+/*
+Check if `string` contains `ch`.
+*/
+int
+sv_contains_char(Strview string, char ch);
+
+/*
+Check if `string` contains `substr`.
+*/
+int
+sv_contains_sv(Strview string, Strview substr);
+
+/*
+String view from a zero terminated string.
+*/
+Strview
+sv_cstr(const char *cstr);
+
+/*
+Count `ch` in `string`.
+*/
+int64
+sv_count_char(Strview string, char ch);
+
+/*
+Remove the first `count` characters from `string`.
+*/
+Strview
+sv_cut(Strview string, int64 count);
+
+/*
+Remove the last `count` characters from `string`.
+*/
+Strview
+sv_cut_end(Strview string, int64 count);
+
+/*
+Check if `string` equal `another`.
+*/
+int
+sv_equal(Strview string, Strview another);
+
+/*
+Check if `string` equal `another`. Ignore the differnce
+between upper case and lower case ASCII letters.
+*/
+int
+sv_equal_no_case(Strview string, Strview another);
+
+/*
+Count the first characters in `string` that pass `filter`.
+*/
+int64
+sv_filter(Strview string, int(*filter)(int));
+
+/*
+Count the last characters in `string` that pass `filter`.
+*/
+int64
+sv_filter_end(Strview string, int(*filter)(int));
+
+/*
+Count the first characters in `string` that did not
+pass `filter`.
+*/
+int64
+sv_filter_not(Strview string, int(*filter)(int));
+
+/*
+Count the last characters in `string` that did not
+pass `filter`.
+*/
+int64
+sv_filter_not_end(Strview string, int(*filter)(int));
+
+/*
+Find the first apearance of `ch` in `string`.
+*/
+int64
+sv_find_char(Strview string, char ch);
+
+/*
+Find the last apearance of `ch` in `string`.
+*/
+int64
+sv_find_char_end(Strview string, char ch);
+
+/*
+Find the first apearance of `substr` in `string`.
+*/
+int64
+sv_find_sv(Strview string, Strview substr);
+
+/*
+Find the last apearance of `substr` in `string`.
+*/
+int64
+sv_find_sv_end(Strview string, Strview substr);
+
+/*
+Get the first `count` characters from `string`.
+*/
+Strview
+sv_get(Strview string, int64 count);
+
+/*
+Get the last `count` characters from `string`.
+*/
+Strview
+sv_get_end(Strview string, int64 count);
+
+/*
+Hash `string` for hash tables. Not cryptographic.
+*/
+unsigned long
+sv_hash(Strview string);
+
+/*
+Check if `string` starts with `prefix`.
+*/
+int
+sv_prefix(Strview string, Strview prefix);
+
+/*
+Count the first characters from `string` that are in `sample`.
+*/
+int64
+sv_span(Strview string, Strview sample);
+
+/*
+Count the first characters from `string` that are in any
+of `classes`. See `cc_is`.
+*/
+int64
+sv_span_class(Strview string, int classes);
+
+/*
+Count the last characters from `string` that are in any
+of `classes`. See `cc_is`.
+*/
+int64
+sv_span_class_end(Strview string, int classes);
+
+/*
+Count the last characters from `string` that are in `sample`.
+*/
+int64
+sv_span_end(Strview string, Strview sample);
+
+/*
+Count the first characters from `string` that are not
+in `sample`.
+*/
+int64
+sv_span_not(Strview string, Strview sample);
+
+/*
+Count the first characters from `string` that are not in
+any of `classes`. See `cc_is`.
+*/
+int64
+sv_span_not_class(Strview string, int classes);
+
+/*
+Count the last characters from `string` that are not in
+any of `classes`. See `cc_is`.
+*/
+int64
+sv_span_not_class_end(Strview string, int classes);
+
+/*
+Count the last characters from `string` that are not
+in `sample`.
+*/
+int64
+sv_span_not_end(Strview string, Strview sample);
+
+/*
+Count the first characters from `string` that are not
+in `cs`.
+*/
+int64
+sv_span_not_set(Strview string, const Charset *cs);
+
+/*
+Count the last characters from `string` that are not
+in `cs`.
+*/
+int64
+sv_span_not_set_end(Strview string, const Charset *cs);
+
+/*
+Count the first characters from `string` that are in `cs`.
+*/
+int64
+sv_span_set(Strview string, const Charset *cs);
+
+/*
+Count the last characters from `string` that are in `cs`.
+*/
+int64
+sv_span_set_end(Strview string, const Charset *cs);
+
+/*
+Get `length` characters from `start` in `string`.
+*/
+Strview
+sv_substr(Strview string, int64 start, int64 length);
+
+/*
+Check if `string` ends with `suffix`.
+*/
+int
+sv_suffix(Strview string, Strview suffix);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: VECTOR                                        */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+vec_at      | Reference the item by index
+vec_clear   | Remove all items
+vec_deinit  | Free the memory used by the vector
+vec_init    | Prepare a vector for work
+vec_insert  | Insert items
+vec_pop     | Remove the last item
+vec_push    | Add an item to the end
+vec_remove  | Remove items
+vec_reserve | Make sure there is memory for more items
+vec_shrink  | Free the memory not used by items
+*/
+
+/*
+Reference the item at `i` of `vec`.
+Negative `i` counts from the end.
+*/
+void *
+vec_at(Vector *vec, int64 i);
+
+/*
+Remove all items of `vec`. Keeps the memory.
+*/
+void
+vec_clear(Vector *vec);
+
+/*
+Deinit `vec`. You cannot use `vec` unless you init it again.
+*/
+void
+vec_deinit(Vector *vec);
+
+/*
+Init `vec` for items of `item_size` bytes with `VEC_*` `flags`.
+Does not allocate memory until the first item.
+*/
+void
+vec_init(Vector *vec, int64 item_size, int flags);
+
+/*
+Insert `n` items from `items` at `i` of `vec`.
+If `items` is NULL the new items are left for the caller.
+`items` must not point into `vec`. Returns the first new item.
+*/
+void *
+vec_insert(Vector *vec, int64 i, const void *items, int64 n);
+
+/*
+Remove the last item of `vec` and return it.
+It stays valid until `vec` changes.
+*/
+void *
+vec_pop(Vector *vec);
+
+/*
+Add `item` to the end of `vec` and return the new item.
+If `item` is NULL the new item is left for the caller.
+`item` must not point into `vec`.
 */
-typedef unsigned long uint64;
+void *
+vec_push(Vector *vec, const void *item);
 
 /*
-String buffer.
+Remove `n` items at `i` of `vec`.
 */
-typedef struct Strbuf {
-  char *at;
-  int length;
-  int capacity;
-  int is_inited;
-} Strbuf;
+void
+vec_remove(Vector *vec, int64 i, int64 n);
 
 /*
-String view.
+Make `vec` have memory for at least `cap` items.
 */
-typedef struct Strview {
-  const char *at;
-  int length;
-} Strview;
+void
+vec_reserve(Vector *vec, int64 cap);
 
 /*
-Global variables.
+Make the capacity of `vec` equal to its length.
 */
-typedef struct Globals {
-  /* In case you want to get rid of some output. */
-  FILE *fnull;
-} Globals;
+void
+vec_shrink(Vector *vec);
 
 /*----------------------------------------------------------*/
-/* FUNCTIONS: MEMORY                                        */
+/* FUNCTIONS: LOCK                                          */
 /*----------------------------------------------------------*/
 
 /*
     GLOSSARY
-mem_alloc         | Allocate memory
-mem_alloc_zeros   | Allocate memory and clear all bytes
-mem_clear         | Set all bytes to zero
-mem_free          | Free previously allocated memory
-mem_realloc       | Reallocate memory
-mem_realloc_zeros | Reallocate memory and clear new bytes
+lock_acquire | Wait for the lock and hold it
+lock_deinit  | Free the resources of the lock
+lock_init    | Prepare a lock for work
+lock_release | Let other threads take the lock
 */
 
 /*
-Allocate `size` bytes of memory.
+Wait until no other thread holds `lock` and hold it.
 */
-void *
-mem_alloc(int size);
+void
+lock_acquire(Lock *lock);
 
 /*
-Allocate `size` bytes of memory and fill it with zeros.
+Deinit `lock`, which must not be held.
 */
-void *
-mem_alloc_zeros(int size);
+void
+lock_deinit(Lock *lock);
 
 /*
-Set `size` bytes by `ptr` to zero.
+Init `lock`, not held by anyone.
 */
 void
-mem_clear(void *ptr, int size);
+lock_init(Lock *lock);
 
 /*
-Free previously allocated memory.
+Stop holding `lock`.
 */
 void
-mem_free(void *ptr);
+lock_release(Lock *lock);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: TIME                                          */
+/*----------------------------------------------------------*/
 
 /*
-Change the size of previously allocated memory.
-`ptr` - the pointer to the memory.
-`size` - new size.
+    GLOSSARY
+time_now         | Get the current time
+time_print_stats | Print the time statistics
 */
-void *
-mem_realloc(void *ptr, int size);
 
 /*
-Change the size of previously allocated memory.
-`ptr` - the pointer to the memory.
-`size` - new size.
-`old_size` - the size of the memory.
-All new bytes set to 0.
+Seconds from some moment in the past. Only differences of
+the results are meaningful.
 */
-void *
-mem_realloc_zeros(void *ptr, int size, int old_size);
+double
+time_now(void);
+
+/*
+Print the time spent in each phase to `file`.
+*/
+void
+time_print_stats(FILE *file);
 
 /*----------------------------------------------------------*/
-/* FUNCTIONS: STRING BUFFER                                 */
+/* FUNCTIONS: WRITER                                        */
 /*----------------------------------------------------------*/
 
 /*
     GLOSSARY
-sb_append   | Append a string
-sb_at       | Reference the character by index
-sb_clear    | Remove all characters
-sb_copy     | Copy a string
-sb_deinit   | Free the memory used by the string buffer
-sb_init     | Prepare a string buffer for work
-sb_insert   | Insert a string
-sb_remove   | Remove characters
-sb_replace  | Replace characters with a string
-sb_reserve  | Reserve memory for characters
-sb_view     | Make a string view
+wr_char   | Write a character
+wr_deinit | Free the memory used by the writer
+wr_flush  | Write out the buffered bytes
+wr_init   | Prepare a writer for work
+wr_save   | Write a whole file at once
+wr_write  | Write an array of characters
 */
 
 /*
-Append a formated string.
+Write `ch` to `w`.
 */
 void
-sb_append(Strbuf *sb, const char *fmt, ...);
+wr_char(Writer *w, char ch);
 
 /*
-Get the pointer to the character in `sb` at `i`.
-Negative values of `i` are used as a reverse index.
-If `sb->length` is 0 this function returns the pointer
-to the null character.
+Deinit `w`. The bytes not flushed are lost.
 */
-char *
-sb_at(Strbuf *sb, int i);
+void
+wr_deinit(Writer *w);
+
+/*
+Write out the buffered bytes of `w`. After a failure the
+bytes are dropped and `w->error` is kept. Returns 0 if any
+`write` to `w` has failed.
+*/
+int
+wr_flush(Writer *w);
 
 /*
-Remove all characters from `sb`.
+Init `w` to write to the file descriptor `fd`, or to memory
+if `fd` is -1. The output in memory is `w->at` and
+`w->length`, it is never flushed.
 */
 void
-sb_clear(Strbuf *sb);
+wr_init(Writer *w, int fd);
 
 /*
-Replace the content of `sb` with a formated string.
+Write `n` bytes at `at` as the file by `path`. They go to a
+new file that is renamed to `path` when complete, so readers
+of `path` never see a part. Returns 0 and sets `errno` if it
+fails.
+*/
+int
+wr_save(const char *path, const char *at, int64 n);
+
+/*
+Write `n` characters from `at` to `w`.
 */
 void
-sb_copy(Strbuf *sb, const char *fmt, ...);
+wr_write(Writer *w, const char *at, int64 n);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: DIGEST                                        */
+/*----------------------------------------------------------*/
 
 /*
-Deinit `sb`. You cannot use `sb` unless you init it again.
+    GLOSSARY
+dg_add     | Add bytes
+dg_add_int | Add an integer
+dg_init    | Start a digest
+*/
+
+/*
+Add `n` bytes at `at` to `dg`.
 */
 void
-sb_deinit(Strbuf *sb);
+dg_add(Digest *dg, const void *at, int64 n);
 
 /*
-Init `sb` to an empty string.
-You should init `sb` before using it in other functions.
+Add `value` to `dg` as 8 bytes, the same on every host.
 */
 void
-sb_init(Strbuf *sb);
+dg_add_int(Digest *dg, int64 value);
 
 /*
-Insert a formated string into `sb` at `i`.
-Negative values of `i` are used as a reverse index.
-If `i` equals `sb->length` then this function appends
-the fromated string.
+Start `dg` with no bytes added.
 */
 void
-sb_insert(Strbuf *sb, int i, const char *fmt, ...);
+dg_init(Digest *dg);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: DISK CACHE                                    */
+/*----------------------------------------------------------*/
 
 /*
-Remove `n` characters in `sb` at `i`.
-Negative values of `i` are used as a reverse index.
-If `i` equals `sb->length` then this function does nothing.
+    GLOSSARY
+dc_deinit      | Free the memory used by the cache
+dc_get         | Find an entry and mark it used
+dc_init        | Open a cache directory
+dc_print_stats | Print the disk cache statistics
+dc_put         | Add an entry
+dc_trim        | Remove the least recently used entries
+*/
+
+/*
+Deinit `dc`. The entries stay on disk.
 */
 void
-sb_remove(Strbuf *sb, int i, int n);
+dc_deinit(DiskCache *dc);
 
 /*
-Replace `n` characters in `sb` at `i` with a formated string.
-Negative values of `i` are used as a reverse index.
-If `i` equals `sb->length` then this function appends
-the fromated string.
+Append the entry of `key` to `value` and mark it used.
+Returns 0 if there is no such entry.
+*/
+int
+dc_get(DiskCache *dc, const Digest *key, Strbuf *value);
+
+/*
+Init `dc` with the directory `dir`, made if it is missing.
+`max_size` is in bytes, 0 for no limit. Returns 0 and sets
+`errno` if the directory cannot be made.
+*/
+int
+dc_init(DiskCache *dc, const char *dir, int64 max_size);
+
+/*
+Print the statistics of the disk cache to `file`.
 */
 void
-sb_replace(Strbuf *sb, int i, int n, const char *fmt, ...);
+dc_print_stats(FILE *file);
 
 /*
-Prepare `sb` to store at least `cap` characters.
+Make `value` the entry of `key`. Failures are ignored, the
+entry is just made again next time.
 */
 void
-sb_reserve(Strbuf *sb, int cap);
+dc_put(DiskCache *dc, const Digest *key, Strview value);
 
 /*
-String view from `sb`.
+Remove the least recently used entries until the rest take
+at most 90% of `max_size`, if they take more than all of it.
+Counts the entries left.
 */
-Strview
-sb_view(Strbuf *sb);
+void
+dc_trim(DiskCache *dc);
 
 /*----------------------------------------------------------*/
-/* FUNCTIONS: STRING VIEW                                   */
+/* FUNCTIONS: LEXER                                         */
 /*----------------------------------------------------------*/
 
 /*
     GLOSSARY
+lex_single | Lex a string that must be one token
+lex_source | Split a source into tokens
+lex_spell  | Get the spelling of a token
+*/
 
-sv_array          | View an array
-sv_compare        | Compare two strings
-sv_contains_char  | Check if the string contains the character
-sv_contains_sv    | Check if the string contains another
-sv_cstr           | View a zero terminated string
-sv_cut            | Remove the first characters
-sv_cut_end        | Remove the last characters
-sv_equal          | Check if two strings are equal
-sv_equal_no_case  | Check if two strings are equal
-sv_filter         | Count from the start while filter
-sv_filter_end     | Count from the end while filter
-sv_filter_not     | Count from the start until filter
-sv_filter_not_end | Count from the end until filter
-sv_find_char      | Find the first such character
-sv_find_char_end  | Find the last such character
-sv_find_sv        | Find the first such string
-sv_find_sv_end    | Find the last such string
-sv_get            | Take the first characters
-sv_get_end        | Take the last characters
-sv_prefix         | Check if the string starts with prefix
-sv_span           | Count from the start while in the sample
-sv_span_end       | Count from the end while in the sample
-sv_span_not       | Count from the start until in the sample
-sv_span_not_end   | Count from the end until in the sample
-sv_substr         | Get the sub-string from the string
-sv_suffix         | Check if the string ends with suffix
+/*
+Lex `text` as exactly one token, interning an identifier
+into `interns` and setting `*id`. Returns the kind of the
+token or -1 if `text` is not one token.
+*/
+int
+lex_single(Interns *interns, Strview text, int *id);
 
+/*
+Split the text of `src` into tokens appended to `tokens`.
+Identifiers are interned into `interns`. Messages of errors
+are appended to `errors` and lexing goes on. Returns 0 if
+there were any.
+Literals without the closing quote are not errors here, they
+get `TF_UNCLOSED`: they are fine in skipped groups.
 */
+int
+lex_source(Tokens *tokens, Interns *interns, Source *src,
+  Strbuf *errors);
 
 /*
-String view from an array of characters.
+Append the spelling of the token `text` to `out`: line
+splices removed and trigraphs replaced. Only needed for
+tokens with `TF_DIRTY`.
 */
-Strview
-sv_array(const char *chars, int length);
+void
+lex_spell(Strbuf *out, Strview text);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: TOKENS                                        */
+/*----------------------------------------------------------*/
 
 /*
-Compare `string` to `another`.
+    GLOSSARY
+tok_clear   | Remove all tokens
+tok_deinit  | Free the memory used by the tokens
+tok_init    | Prepare tokens for work
+tok_push    | Add a token to the end
+tok_reserve | Make sure there is memory for more tokens
+tok_text    | Get the text of a token
 */
-int
-sv_compare(Strview string, Strview another);
 
 /*
-Check if `string` contains `ch`.
+Remove all tokens from `tokens`. Keeps the memory.
 */
-int
-sv_contains_char(Strview string, char ch);
+void
+tok_clear(Tokens *tokens);
 
 /*
-Check if `string` contains `substr`.
+Deinit `tokens`. You cannot use `tokens` unless you init
+it again.
+*/
+void
+tok_deinit(Tokens *tokens);
+
+/*
+Init `tokens` with no tokens.
+*/
+void
+tok_init(Tokens *tokens);
+
+/*
+Add a token to the end of `tokens` and return its index.
 */
 int
-sv_contains_sv(Strview string, Strview substr);
+tok_push(Tokens *tokens, int kind, int flags, int64 offset,
+  int length, int id);
 
 /*
-String view from a zero terminated string.
+Make `tokens` have memory for at least `cap` tokens.
 */
-Strview
-sv_cstr(const char *cstr);
+void
+tok_reserve(Tokens *tokens, int cap);
 
 /*
-Remove the first `count` characters from `string`.
+Get the text of the token `i` of `tokens` in `text`, the text
+the tokens were made from.
 */
 Strview
-sv_cut(Strview string, int count);
+tok_text(const Tokens *tokens, int i, Strview text);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: HEADER CACHE                                  */
+/*----------------------------------------------------------*/
 
 /*
-Remove the last `count` characters from `string`.
+    GLOSSARY
+hc_add_dir | Add a directory searched by `#include`
+hc_deinit  | Free the memory used by the cache
+hc_find    | Find a header included by name
+hc_init    | Prepare a cache for work
+hc_locate  | Find the header of an offset
+hc_open    | Find a header by path
 */
-Strview
-sv_cut_end(Strview string, int count);
 
 /*
-Check if `string` equal `another`.
+Add `dir` to the end of the directories searched by
+`#include`. `dir` must live as long as `hc`.
 */
-int
-sv_equal(Strview string, Strview another);
+void
+hc_add_dir(HeaderCache *hc, const char *dir);
 
 /*
-Check if `string` equal `another`. Ignore the differnce
-between upper case and lower case.
+Deinit `hc`. All headers become invalid.
 */
-int
-sv_equal_no_case(Strview string, Strview another);
+void
+hc_deinit(HeaderCache *hc);
 
 /*
-Count the first characters in `string` that pass `filter`.
+Find the header `name` included by `from`: in the directory
+of `from` if it is not NULL, then in the directories of
+`hc_add_dir`. The paths tried are made in `path`. Returns
+NULL if there is no such file.
 */
-int
-sv_filter(Strview string, int(*filter)(int));
+Header *
+hc_find(HeaderCache *hc, Strview name, const Header *from,
+  Strbuf *path);
 
 /*
-Count the last characters in `string` that pass `filter`.
+Init `hc` with no headers. Paths and identifiers of headers
+are interned into `interns`.
 */
-int
-sv_filter_end(Strview string, int(*filter)(int));
+void
+hc_init(HeaderCache *hc, Interns *interns);
 
 /*
-Count the first characters in `string` that did not
-pass `filter`.
+Find the header that has `offset` between its `base` and
+the end of its text.
 */
-int
-sv_filter_not(Strview string, int(*filter)(int));
+Header *
+hc_locate(HeaderCache *hc, int64 offset);
 
 /*
-Count the last characters in `string` that did not
-pass `filter`.
+Find the header by `path`, loading and lexing it the first
+time. Lexing errors are kept in `errors` of the header.
+Returns NULL and sets `errno` if the file cannot be loaded.
 */
-int
-sv_filter_not_end(Strview string, int(*filter)(int));
+Header *
+hc_open(HeaderCache *hc, Strview path);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: PREPROCESSOR                                  */
+/*----------------------------------------------------------*/
 
 /*
-Find the first apearance of `ch` in `string`.
+    GLOSSARY
+pp_deinit      | Free the memory used by the preprocessor
+pp_init        | Prepare a preprocessor for work
+pp_print_stats | Print the preprocessor statistics
+pp_run         | Preprocess a file
+pp_stream      | Print the output as text while it is made
+pp_token_text  | Get the text of an output token
+pp_use_pch     | Start the unit with a precompiled header
 */
-int
-sv_find_char(Strview string, char ch);
 
 /*
-Find the last apearance of `ch` in `string`.
+Deinit `pp`. Output tokens stay.
 */
-int
-sv_find_char_end(Strview string, char ch);
+void
+pp_deinit(Preprocessor *pp);
 
 /*
-Find the first apearance of `substr` in `string`.
+Init `pp` for a new translation unit with headers from
+`cache`. Tokens are appended to `out`.
 */
-int
-sv_find_sv(Strview string, Strview substr);
+void
+pp_init(Preprocessor *pp, HeaderCache *cache, Tokens *out);
 
 /*
-Find the last apearance of `substr` in `string`.
+Print the statistics of all preprocessing to `file`.
+*/
+void
+pp_print_stats(FILE *file);
+
+/*
+Preprocess the file by `path` and everything it includes.
+Messages of errors are appended to `pp->errors` in the order
+of the text. Returns 0 if there were any.
 */
 int
-sv_find_sv_end(Strview string, Strview substr);
+pp_run(Preprocessor *pp, const char *path);
 
 /*
-Get the first `count` characters from `string`.
+Print the output of `pp` to `writer` as text while it is made
+instead of keeping the tokens. `#line` is printed only where
+the lines of the text would differ from the source. Pragmas
+other than `#pragma once` are printed as written.
 */
-Strview
-sv_get(Strview string, int count);
+void
+pp_stream(Preprocessor *pp, Writer *writer);
 
 /*
-Get the last `count` characters from `string`.
+Get the text of the output token `i` of `pp`. The text of a
+token with `TF_DIRTY` is its spelling, valid until the next
+call.
 */
 Strview
-sv_get_end(Strview string, int count);
+pp_token_text(Preprocessor *pp, int i);
 
 /*
-Check if `string` starts with `prefix`.
+Start the translation unit with the state of `pch` instead of
+the definitions of the host, as if it included the header
+first. `pch` must be loaded with the cache of `pp`.
 */
-int
-sv_prefix(Strview string, Strview prefix);
+void
+pp_use_pch(Preprocessor *pp, PCH *pch);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: PRECOMPILED HEADER                            */
+/*----------------------------------------------------------*/
 
 /*
-Count the first characters from `string` that are in `sample`.
+    GLOSSARY
+pch_deinit | Unmap the precompiled header
+pch_load   | Map a precompiled header and check it is fresh
+pch_save   | Save the state of a translation unit
 */
-int
-sv_span(Strview string, Strview sample);
 
 /*
-Count the last characters from `string` that are in `sample`.
+Deinit `pch`. Must be done after `hc_deinit` of the cache it
+was loaded with.
 */
-int
-sv_span_end(Strview string, Strview sample);
+void
+pch_deinit(PCH *pch);
 
 /*
-Count the first characters from `string` that are not
-in `sample`.
+Map the precompiled header by `path` into `pch` and publish
+its headers in `hc`. Must be done before `hc` finds any file.
+The file is checked by a hash of itself and the files it was
+made of by size and a hash of the content. Returns 0 and
+appends a message to `errors` if the file is not a
+precompiled header, is corrupt, was made with other
+definitions of the host or include directories, or is out
+of date.
 */
 int
-sv_span_not(Strview string, Strview sample);
+pch_load(PCH *pch, HeaderCache *hc, const char *path,
+  Strbuf *errors);
 
 /*
-Count the last characters from `string` that are not
-in `sample`.
+Save the state of `pp` after `pp_run` to the file by `path`:
+its headers, macros and output tokens. `pp` must keep its
+output, not stream it. Returns 0 and appends a message to
+`pp->errors` if the file cannot be written.
 */
 int
-sv_span_not_end(Strview string, Strview sample);
+pch_save(Preprocessor *pp, const char *path);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: SYNTAX TREE                                   */
+/*----------------------------------------------------------*/
 
 /*
-Get `length` characters from `start` in `string`.
+    GLOSSARY
+ast_deinit | Free the whole tree
+ast_init   | Prepare an empty tree
 */
-Strview
-sv_substr(Strview string, int start, int length);
 
 /*
-Check if `string` ends with `suffix`.
+Deinit `ast`, all its nodes and lists at once.
+*/
+void
+ast_deinit(Ast *ast);
+
+/*
+Init `ast` with room for about `num_nodes` nodes. It has only
+the node 0.
+*/
+void
+ast_init(Ast *ast, int num_nodes);
+
+/*----------------------------------------------------------*/
+/* FUNCTIONS: PARSER                                        */
+/*----------------------------------------------------------*/
+
+/*
+    GLOSSARY
+parse_unit | Parse a translation unit
+*/
+
+/*
+Parse the output tokens of `pp` after `pp_run` into `ast`.
+Messages of errors are appended to `errors` and parsing goes
+on from the next declaration or statement. Returns 0 if there
+were any.
 */
 int
-sv_suffix(Strview string, Strview suffix);
+parse_unit(Ast *ast, Preprocessor *pp, Strbuf *errors);
 
 /*----------------------------------------------------------*/
 /* VARIABLES                                                */
 /*----------------------------------------------------------*/
 
 /*
-Vector to global variables.
+Classes of characters, `CC_*` flags by the character
+converted to `unsigned char`.
+*/
+extern const unsigned char char_classes[UCHAR_MAX + 1];
+
+/*
+Vector to global variables of the thread.
 */
-extern Globals *G;
+extern THREAD_LOCAL Globals *G;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,808 @@
+/* Unique ANSI C Compiler */
+/* uacc_lex.c - Lexer */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Returned by `lex_char` at the end of the text.
+*/
+#define LEX_END (-1)
+
+/*----------------------------------------------------------*/
+/* TYPES                                                    */
+/*----------------------------------------------------------*/
+
+/*
+State of lexing one text.
+*/
+typedef struct Lexer {
+  const char *at;
+  int64 end;
+  /* Where the next token starts. */
+  int64 pos;
+  /* Where the token or comment being lexed starts. */
+  int64 start;
+  Source *src;
+  Tokens *tokens;
+  Interns *interns;
+  /* Where the messages of errors go. */
+  Strbuf *errors;
+  /* Characters that stop the scan of a literal. */
+  Charset string_stops;
+  Charset char_stops;
+  /* Spelling of a dirty identifier. */
+  Strbuf spelling;
+  int is_unclosed;
+  int num_errors;
+} Lexer;
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS                                         */
+/*----------------------------------------------------------*/
+
+/*
+Logical character at `pos` of `lx`: line splices skipped and
+trigraphs replaced. `*next` is set to the position after it.
+Returns `LEX_END` at the end of the text.
+*/
+static int
+lex_char(Lexer *lx, int64 pos, int64 *next);
+
+/*
+`lex_char` for the positions of '\\' and '?'.
+*/
+static int
+lex_char_slow(Lexer *lx, int64 pos, int64 *next);
+
+/*
+Skip a comment which body starts at `lx->pos`.
+*/
+static void
+lex_comment(Lexer *lx);
+
+/*
+Print an error at `offset` of the text of `lx`.
+*/
+static void
+lex_error(Lexer *lx, int64 offset, const char *message);
+
+/*
+Check if `text` has line splices or trigraphs.
+*/
+static int
+lex_is_dirty(Strview text);
+
+/*
+Lex the rest of a character constant or a string literal
+which ends with `quote`. Returns 0 if there is no `quote`
+before the end of the line.
+*/
+static int
+lex_quoted(Lexer *lx, int quote);
+
+/*
+Skip spaces and comments. Returns the `TF_*` flags for the
+next token.
+*/
+static int
+lex_space(Lexer *lx);
+
+/*
+Lex the token at `lx->pos` and return its kind.
+Sets `lx->is_unclosed` for literals without the closing quote.
+*/
+static int
+lex_token(Lexer *lx);
+
+/*
+Character of the trigraph "??`ch`" or 0 if there is none.
+*/
+static int
+trigraph(int ch);
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: LEXER                                    */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+lex_char(Lexer *lx, int64 pos, int64 *next)
+{
+  int ch = 0;
+  /**/
+  if (pos >= lx->end) {
+    *next = pos;
+    return LEX_END;
+  }
+  ch = (unsigned char)lx->at[pos];
+  if (ch == '\\' || ch == '?') {
+    return lex_char_slow(lx, pos, next);
+  }
+  *next = pos + 1;
+  return ch;
+}
+
+/*----------------------------------------------------------*/
+int
+lex_char_slow(Lexer *lx, int64 pos, int64 *next)
+{
+  const char *at = NULL;
+  int64 end = 0;
+  int64 after = 0;
+  int ch = 0;
+  int width = 0;
+  /**/
+  at = lx->at;
+  end = lx->end;
+  for (;;) {
+    if (pos >= end) {
+      *next = pos;
+      return LEX_END;
+    }
+    ch = (unsigned char)at[pos];
+    width = 1;
+    if (ch == '?' && end - pos >= 3 && at[pos + 1] == '?'
+        && trigraph(at[pos + 2]) != 0) {
+      ch = trigraph(at[pos + 2]);
+      width = 3;
+    }
+    if (ch != '\\') {
+      break;
+    }
+    after = pos + width;
+    if (after < end && at[after] == '\n') {
+      pos = after + 1;
+    } else if (end - after >= 2 && at[after] == '\r'
+        && at[after + 1] == '\n') {
+      pos = after + 2;
+    } else {
+      break;
+    }
+  }
+  *next = pos + width;
+  return ch;
+}
+
+/*----------------------------------------------------------*/
+void
+lex_comment(Lexer *lx)
+{
+  const char *star = NULL;
+  int64 next = 0;
+  /**/
+  for (;;) {
+    star = memchr(lx->at + lx->pos, '*', lx->end - lx->pos);
+    if (star == NULL) {
+      lex_error(lx, lx->start, "unterminated comment");
+      lx->pos = lx->end;
+      return;
+    }
+    lx->pos = star - lx->at + 1;
+    if (lex_char(lx, lx->pos, &next) == '/') {
+      lx->pos = next;
+      return;
+    }
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+lex_error(Lexer *lx, int64 offset, const char *message)
+{
+  int64 line = 0;
+  int64 column = 0;
+  /**/
+  src_locate(lx->src, offset, &line, &column);
+  sb_append(lx->errors, "%s:%ld:%ld: error: %s\n",
+    lx->src->path.at, (long)line, (long)column, message
+  );
+  lx->num_errors++;
+}
+
+/*----------------------------------------------------------*/
+int
+lex_is_dirty(Strview text)
+{
+  int64 i = 0;
+  /**/
+  for (i = 0; i < text.length; i++) {
+    if (text.at[i] == '\\' && i + 1 < text.length
+        && (text.at[i + 1] == '\n' || text.at[i + 1] == '\r')) {
+      return 1;
+    }
+    if (text.at[i] == '?' && i + 2 < text.length
+        && text.at[i + 1] == '?' && trigraph(text.at[i + 2]) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*----------------------------------------------------------*/
+int
+lex_quoted(Lexer *lx, int quote)
+{
+  const Charset *stops = NULL;
+  int64 next = 0;
+  int ch = 0;
+  /**/
+  stops = quote == '"' ? &lx->string_stops : &lx->char_stops;
+  for (;;) {
+    lx->pos += sv_span_not_set(
+      sv_array(lx->at + lx->pos, lx->end - lx->pos), stops
+    );
+    ch = lex_char(lx, lx->pos, &next);
+    if (ch == quote) {
+      lx->pos = next;
+      return 1;
+    }
+    if (ch == LEX_END || ch == '\n') {
+      return 0;
+    }
+    lx->pos = next;
+    if (ch == '\\') {
+      /* Any character but a new line may be escaped. */
+      ch = lex_char(lx, lx->pos, &next);
+      if (ch != LEX_END && ch != '\n') {
+        lx->pos = next;
+      }
+    }
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+lex_single(Interns *interns, Strview text, int *id)
+{
+  Lexer lx;
+  int kind = 0;
+  /**/
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  assert(id != NULL);
+  /**/
+  *id = 0;
+  if (text.length == 0
+      || (char_classes[(unsigned char)text.at[0]] & CC_SPACE)
+      || sv_prefix(text, sv_cstr("/*"))) {
+    return -1;
+  }
+  mem_clear(&lx, sizeof(lx));
+  lx.at = text.at;
+  lx.end = text.length;
+  cs_init(&lx.string_stops, sv_cstr("\"\\\n?"));
+  cs_init(&lx.char_stops, sv_cstr("'\\\n?"));
+  kind = lex_token(&lx);
+  if (lx.pos != lx.end || lx.is_unclosed) {
+    return -1;
+  }
+  if (kind == TK_IDENT) {
+    *id = intern_sv(interns, text);
+  }
+  return kind;
+}
+
+/*----------------------------------------------------------*/
+int
+lex_source(Tokens *tokens, Interns *interns, Source *src,
+  Strbuf *errors)
+{
+  Lexer lx;
+  Strview text;
+  int64 start = 0;
+  int flags = 0;
+  int kind = 0;
+  int id = 0;
+  /**/
+  assert(tokens != NULL);
+  assert(tokens->is_inited);
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  assert(src != NULL);
+  assert(src->is_inited);
+  assert(errors != NULL);
+  assert(errors->is_inited);
+  /**/
+  mem_clear(&lx, sizeof(lx));
+  lx.at = src->text.at;
+  lx.end = src->text.length;
+  lx.pos = 0;
+  lx.src = src;
+  lx.tokens = tokens;
+  lx.interns = interns;
+  lx.errors = errors;
+  cs_init(&lx.string_stops, sv_cstr("\"\\\n?"));
+  cs_init(&lx.char_stops, sv_cstr("'\\\n?"));
+  sb_init(&lx.spelling);
+  /* C has about one token for every five bytes. */
+  if (lx.end / 5 < INT_MAX - tokens->count) {
+    tok_reserve(tokens, tokens->count + (int)(lx.end / 5) + 1);
+  }
+  flags = TF_BOL;
+  for (;;) {
+    flags |= lex_space(&lx);
+    if (lx.pos >= lx.end) {
+      break;
+    }
+    start = lx.pos;
+    lx.start = start;
+    lx.is_unclosed = 0;
+    kind = lex_token(&lx);
+    if (lx.is_unclosed) {
+      flags |= TF_UNCLOSED;
+    }
+    text = sv_array(lx.at + start, lx.pos - start);
+    if (text.length > INT_MAX) {
+      lex_error(&lx, start, "token is too long");
+      text.length = INT_MAX;
+    }
+    if (memchr(text.at, '\\', text.length) != NULL
+        || memchr(text.at, '?', text.length) != NULL) {
+      if (lex_is_dirty(text)) {
+        flags |= TF_DIRTY;
+      }
+    }
+    id = 0;
+    if (kind == TK_IDENT && (flags & TF_DIRTY)) {
+      sb_clear(&lx.spelling);
+      lex_spell(&lx.spelling, text);
+      id = intern_sv(interns, sb_view(&lx.spelling));
+    } else if (kind == TK_IDENT) {
+      id = intern_sv(interns, text);
+    }
+    tok_push(tokens, kind, flags, start, (int)text.length, id);
+    flags = 0;
+  }
+  tok_push(tokens, TK_EOF, flags, lx.end, 0, 0);
+  sb_deinit(&lx.spelling);
+  return lx.num_errors == 0;
+}
+
+/*----------------------------------------------------------*/
+int
+lex_space(Lexer *lx)
+{
+  const char *at = NULL;
+  int64 next = 0;
+  int64 after = 0;
+  int flags = 0;
+  int ch = 0;
+  /**/
+  at = lx->at;
+  while (lx->pos < lx->end) {
+    ch = (unsigned char)at[lx->pos];
+    if (char_classes[ch] & CC_SPACE) {
+      if (ch == '\n') {
+        flags |= TF_BOL;
+      }
+      flags |= TF_SPACE;
+      lx->pos++;
+      continue;
+    }
+    ch = lex_char(lx, lx->pos, &next);
+    if (ch == '/' && lex_char(lx, next, &after) == '*') {
+      lx->start = lx->pos;
+      lx->pos = after;
+      lex_comment(lx);
+      flags |= TF_SPACE;
+      continue;
+    }
+    if (next - lx->pos > 1 && ch != LEX_END
+        && (char_classes[ch] & CC_SPACE)) {
+      /* A space after a line splice. */
+      if (ch == '\n') {
+        flags |= TF_BOL;
+      }
+      flags |= TF_SPACE;
+      lx->pos = next;
+      continue;
+    }
+    if (ch == LEX_END) {
+      /* Splices at the very end. */
+      lx->pos = lx->end;
+    }
+    break;
+  }
+  return flags;
+}
+
+/*----------------------------------------------------------*/
+void
+lex_spell(Strbuf *out, Strview text)
+{
+  const char *at = NULL;
+  int64 end = 0;
+  int64 i = 0;
+  int64 after = 0;
+  int ch = 0;
+  int width = 0;
+  /**/
+  assert(out != NULL);
+  assert(out->is_inited);
+  /**/
+  at = text.at;
+  end = text.length;
+  while (i < end) {
+    ch = (unsigned char)at[i];
+    width = 1;
+    if (ch == '?' && end - i >= 3 && at[i + 1] == '?'
+        && trigraph(at[i + 2]) != 0) {
+      ch = trigraph(at[i + 2]);
+      width = 3;
+    }
+    if (ch == '\\') {
+      after = i + width;
+      if (after < end && at[after] == '\n') {
+        i = after + 1;
+        continue;
+      }
+      if (end - after >= 2 && at[after] == '\r' && at[after + 1] == '\n') {
+        i = after + 2;
+        continue;
+      }
+    }
+    sb_append_char(out, (char)ch);
+    i += width;
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+lex_token(Lexer *lx)
+{
+  const char *at = NULL;
+  int64 next = 0;
+  int64 after = 0;
+  int64 last = 0;
+  int ch = 0;
+  int ch2 = 0;
+  /**/
+  at = lx->at;
+  ch = lex_char(lx, lx->pos, &next);
+  ch2 = lex_char(lx, next, &after);
+  assert(ch != LEX_END);
+  /* Wide character constants and string literals. */
+  if (ch == 'L' && (ch2 == '\'' || ch2 == '"')) {
+    lx->pos = after;
+    lx->is_unclosed = !lex_quoted(lx, ch2);
+    return ch2 == '"' ? TK_STRING : TK_CHAR;
+  }
+  if (char_classes[ch] & CC_IDENT_START) {
+    lx->pos = next;
+    for (;;) {
+      while (lx->pos < lx->end
+          && (char_classes[(unsigned char)at[lx->pos]] & CC_IDENT)) {
+        lx->pos++;
+      }
+      ch = lex_char(lx, lx->pos, &next);
+      if (ch == LEX_END || !(char_classes[ch] & CC_IDENT)) {
+        return TK_IDENT;
+      }
+      lx->pos = next;
+    }
+  }
+  /* Preprocessing numbers. */
+  if ((char_classes[ch] & CC_DIGIT)
+      || (ch == '.' && ch2 != LEX_END && (char_classes[ch2] & CC_DIGIT))) {
+    lx->pos = next;
+    for (;;) {
+      last = ch;
+      ch = lex_char(lx, lx->pos, &next);
+      if (ch == LEX_END) {
+        return TK_NUMBER;
+      }
+      if ((ch == '+' || ch == '-') && (last == 'e' || last == 'E')) {
+        lx->pos = next;
+      } else if ((char_classes[ch] & CC_IDENT) || ch == '.') {
+        lx->pos = next;
+      } else {
+        return TK_NUMBER;
+      }
+    }
+  }
+  lx->pos = next;
+  switch (ch) {
+  case '"':
+  case '\'':
+    lx->is_unclosed = !lex_quoted(lx, ch);
+    return ch == '"' ? TK_STRING : TK_CHAR;
+  case '[':
+    return TK_LBRACK;
+  case ']':
+    return TK_RBRACK;
+  case '(':
+    return TK_LPAREN;
+  case ')':
+    return TK_RPAREN;
+  case '{':
+    return TK_LBRACE;
+  case '}':
+    return TK_RBRACE;
+  case '~':
+    return TK_TILDE;
+  case '?':
+    return TK_QUESTION;
+  case ':':
+    return TK_COLON;
+  case ';':
+    return TK_SEMI;
+  case ',':
+    return TK_COMMA;
+  case '.':
+    if (ch2 == '.' && lex_char(lx, after, &last) == '.') {
+      lx->pos = last;
+      return TK_ELLIPSIS;
+    }
+    return TK_DOT;
+  case '-':
+    lx->pos = after;
+    if (ch2 == '>') {
+      return TK_ARROW;
+    }
+    if (ch2 == '-') {
+      return TK_DEC;
+    }
+    if (ch2 == '=') {
+      return TK_SUB_ASSIGN;
+    }
+    lx->pos = next;
+    return TK_MINUS;
+  case '+':
+    lx->pos = after;
+    if (ch2 == '+') {
+      return TK_INC;
+    }
+    if (ch2 == '=') {
+      return TK_ADD_ASSIGN;
+    }
+    lx->pos = next;
+    return TK_PLUS;
+  case '&':
+    lx->pos = after;
+    if (ch2 == '&') {
+      return TK_AND;
+    }
+    if (ch2 == '=') {
+      return TK_AND_ASSIGN;
+    }
+    lx->pos = next;
+    return TK_AMP;
+  case '|':
+    lx->pos = after;
+    if (ch2 == '|') {
+      return TK_OR;
+    }
+    if (ch2 == '=') {
+      return TK_OR_ASSIGN;
+    }
+    lx->pos = next;
+    return TK_PIPE;
+  case '#':
+    if (ch2 == '#') {
+      lx->pos = after;
+      return TK_HASH_HASH;
+    }
+    return TK_HASH;
+  case '<':
+  case '>':
+    if (ch2 == ch) {
+      lx->pos = after;
+      if (lex_char(lx, after, &last) == '=') {
+        lx->pos = last;
+        return ch == '<' ? TK_SHL_ASSIGN : TK_SHR_ASSIGN;
+      }
+      return ch == '<' ? TK_SHL : TK_SHR;
+    }
+    if (ch2 == '=') {
+      lx->pos = after;
+      return ch == '<' ? TK_LE : TK_GE;
+    }
+    return ch == '<' ? TK_LT : TK_GT;
+  default:
+    break;
+  }
+  /* The rest are single characters or the same with '='. */
+  if (ch2 == '=') {
+    switch (ch) {
+    case '*':
+      lx->pos = after;
+      return TK_MUL_ASSIGN;
+    case '/':
+      lx->pos = after;
+      return TK_DIV_ASSIGN;
+    case '%':
+      lx->pos = after;
+      return TK_MOD_ASSIGN;
+    case '^':
+      lx->pos = after;
+      return TK_XOR_ASSIGN;
+    case '!':
+      lx->pos = after;
+      return TK_NE;
+    case '=':
+      lx->pos = after;
+      return TK_EQ;
+    default:
+      break;
+    }
+  }
+  switch (ch) {
+  case '*':
+    return TK_STAR;
+  case '/':
+    return TK_SLASH;
+  case '%':
+    return TK_PERCENT;
+  case '^':
+    return TK_CARET;
+  case '!':
+    return TK_NOT;
+  case '=':
+    return TK_ASSIGN;
+  default:
+    break;
+  }
+  return TK_OTHER;
+}
+
+/*----------------------------------------------------------*/
+int
+trigraph(int ch)
+{
+  switch (ch) {
+  case '=':
+    return '#';
+  case '(':
+    return '[';
+  case '/':
+    return '\\';
+  case ')':
+    return ']';
+  case '\'':
+    return '^';
+  case '<':
+    return '{';
+  case '!':
+    return '|';
+  case '>':
+    return '}';
+  case '-':
+    return '~';
+  default:
+    return 0;
+  }
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: TOKENS                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+tok_clear(Tokens *tokens)
+{
+  assert(tokens != NULL);
+  assert(tokens->is_inited);
+  /**/
+  tokens->count = 0;
+}
+
+/*----------------------------------------------------------*/
+void
+tok_deinit(Tokens *tokens)
+{
+  assert(tokens != NULL);
+  assert(tokens->is_inited);
+  /**/
+  if (tokens->capacity > 0) {
+    mem_free(tokens->kinds);
+    mem_free(tokens->flags);
+    mem_free(tokens->offsets);
+    mem_free(tokens->lengths);
+    mem_free(tokens->ids);
+  }
+  mem_clear(tokens, sizeof(*tokens));
+}
+
+/*----------------------------------------------------------*/
+void
+tok_init(Tokens *tokens)
+{
+  assert(tokens != NULL);
+  assert(!tokens->is_inited);
+  /**/
+  tokens->kinds = NULL;
+  tokens->flags = NULL;
+  tokens->offsets = NULL;
+  tokens->lengths = NULL;
+  tokens->ids = NULL;
+  tokens->count = 0;
+  tokens->capacity = 0;
+  tokens->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+int
+tok_push(Tokens *tokens, int kind, int flags, int64 offset,
+  int length, int id)
+{
+  int i = 0;
+  /**/
+  assert(tokens != NULL);
+  assert(tokens->is_inited);
+  assert(kind >= 0 && kind < TK_COUNT);
+  assert(length >= 0);
+  /**/
+  if (tokens->count == tokens->capacity) {
+    if (tokens->capacity > INT_MAX / 2) {
+      fprintf(stderr, "%s", "uacc: error: sorry, too many tokens\n");
+      exit(EXIT_FAILURE);
+    }
+    tok_reserve(tokens, tokens->capacity * 2 + 256);
+  }
+  i = tokens->count++;
+  tokens->kinds[i] = (unsigned char)kind;
+  tokens->flags[i] = (unsigned char)flags;
+  tokens->offsets[i] = offset;
+  tokens->lengths[i] = length;
+  tokens->ids[i] = id;
+  return i;
+}
+
+/*----------------------------------------------------------*/
+void
+tok_reserve(Tokens *tokens, int cap)
+{
+  assert(tokens != NULL);
+  assert(tokens->is_inited);
+  /**/
+  if (cap <= tokens->capacity) {
+    return;
+  }
+  if (tokens->capacity == 0) {
+    tokens->kinds = mem_alloc_for(MEM_KIND_TOKENS, cap);
+    tokens->flags = mem_alloc_for(MEM_KIND_TOKENS, cap);
+    tokens->offsets = mem_alloc_for(MEM_KIND_TOKENS,
+      mem_size_mul(cap, sizeof(int64))
+    );
+    tokens->lengths = mem_alloc_for(MEM_KIND_TOKENS,
+      mem_size_mul(cap, sizeof(int))
+    );
+    tokens->ids = mem_alloc_for(MEM_KIND_TOKENS,
+      mem_size_mul(cap, sizeof(int))
+    );
+  } else {
+    tokens->kinds = mem_realloc(tokens->kinds, cap);
+    tokens->flags = mem_realloc(tokens->flags, cap);
+    tokens->offsets = mem_realloc(tokens->offsets,
+      mem_size_mul(cap, sizeof(int64))
+    );
+    tokens->lengths = mem_realloc(tokens->lengths,
+      mem_size_mul(cap, sizeof(int))
+    );
+    tokens->ids = mem_realloc(tokens->ids,
+      mem_size_mul(cap, sizeof(int))
+    );
+  }
+  tokens->capacity = cap;
+}
+
+/*----------------------------------------------------------*/
+Strview
+tok_text(const Tokens *tokens, int i, Strview text)
+{
+  assert(tokens != NULL);
+  assert(tokens->is_inited);
+  assert(i >= 0 && i < tokens->count);
+  assert(tokens->offsets[i] + tokens->lengths[i] <= text.length);
+  /**/
+  return sv_array(text.at + tokens->offsets[i], tokens->lengths[i]);
+}
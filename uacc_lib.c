@@ -7,690 +7,4148 @@
 
 #include "uacc.h"
 
+#if defined(__SSE2__) && !defined(UACC_NO_SIMD)
+#define UACC_SSE2
+#include <emmintrin.h>
+#endif
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Needles at least this long are searched by Horspool's
+algorithm, its skips beat checking every position.
+*/
+#define SV_HORSPOOL_MIN 32
+
+/*
+Spans with a sample are counted by searching the sample for
+this many characters before a `Charset` is made.
+*/
+#define SV_SPAN_SHORT 32
+
+/*
+First bytes of each disk cache entry. Files without them are
+not entries, such as ones cut short.
+*/
+#define DC_MAGIC "uaccdc1\n"
+#define DC_MAGIC_LENGTH 8
+
+/*
+Part of the size limit the disk cache is trimmed to, in
+percent, so that it is not trimmed again by the next store.
+*/
+#define DC_TRIM_PERCENT 90
+
+/*----------------------------------------------------------*/
+/* TYPES                                                    */
+/*----------------------------------------------------------*/
+
+#ifdef UACC_MEM_STATS
+/*
+Header in front of each allocation to know its size and
+kind when it is reallocated or freed.
+*/
+typedef union MemHeader {
+  struct {
+    int64 size;
+    int kind;
+  } info;
+  /* Keep the memory after the header aligned. */
+  double align[2];
+} MemHeader;
+#endif
+
+/*
+File found in the directory of a `DiskCache` by `dc_trim`.
+*/
+typedef struct DiskEntry {
+  /* Offset of the path in the buffer of all paths. */
+  int64 path;
+  int64 size;
+  long mtime;
+} DiskEntry;
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+#define L (CC_IDENT_START | CC_IDENT)
+#define X (CC_IDENT_START | CC_IDENT | CC_HEX)
+#define D (CC_IDENT | CC_DIGIT | CC_HEX)
+#define S CC_SPACE
+#define P CC_PUNCT
+
+/*
+Classes of characters, `CC_*` flags by the character
+converted to `unsigned char`.
+*/
+const unsigned char char_classes[UCHAR_MAX + 1] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, S, S, S, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  S, P, 0, P, 0, P, P, 0, P, P, P, P, P, P, P, P,
+  D, D, D, D, D, D, D, D, D, D, P, P, P, P, P, P,
+  0, X, X, X, X, X, X, L, L, L, L, L, L, L, L, L,
+  L, L, L, L, L, L, L, L, L, L, L, P, 0, P, P, L,
+  0, X, X, X, X, X, X, L, L, L, L, L, L, L, L, L,
+  L, L, L, L, L, L, L, L, L, L, L, P, P, P, P, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+#undef L
+#undef X
+#undef D
+#undef S
+#undef P
+
+/*
+Spelling of the keywords by `Keyword`.
+*/
+static const char *keywords[KW_COUNT] = {
+  "",
+  "auto",
+  "break",
+  "case",
+  "char",
+  "const",
+  "continue",
+  "default",
+  "do",
+  "double",
+  "else",
+  "enum",
+  "extern",
+  "float",
+  "for",
+  "goto",
+  "if",
+  "int",
+  "long",
+  "register",
+  "return",
+  "short",
+  "signed",
+  "sizeof",
+  "static",
+  "struct",
+  "switch",
+  "typedef",
+  "union",
+  "unsigned",
+  "void",
+  "volatile",
+  "while"
+};
+
+/*
+Spelling of the preprocessor words by `PPWord` minus
+`KW_COUNT`.
+*/
+static const char *pp_words[PW_COUNT - KW_COUNT] = {
+  "define",
+  "defined",
+  "elif",
+  "endif",
+  "error",
+  "ifdef",
+  "ifndef",
+  "include",
+  "line",
+  "once",
+  "pragma",
+  "undef",
+  "__DATE__",
+  "__FILE__",
+  "__LINE__",
+  "__TIME__"
+};
+
+/*
+Number of the next temporary file of `wr_save`, so that no two
+calls of a process, in any thread, use the same name.
+*/
+static long save_number;
+
 /*----------------------------------------------------------*/
 /* STATIC FUNCTIONS                                         */
 /*----------------------------------------------------------*/
 
+/*
+Convert `ch` to lower case if it is an ASCII upper case letter.
+*/
+static int
+ascii_lower(int ch);
+
+/*
+Convert every ASCII upper case letter in the bytes of `word`
+to lower case. Other bytes stay the same.
+*/
+static unsigned long
+ascii_lower_word(unsigned long word);
+
+/*
+Write the digits of `value` in `base` to the end of `buf`.
+`buf` must hold at least 32 characters.
+Returns the pointer to the first digit.
+*/
+static char *
+format_digits(char *buf, unsigned long value, int base, int upper);
+
+#ifdef UACC_SSE2
+/*
+Index of the highest set bit of `mask`, which is not 0.
+*/
+static int
+highest_bit(unsigned mask);
+
+/*
+Index of the lowest set bit of `mask`, which is not 0.
+*/
+static int
+lowest_bit(unsigned mask);
+#endif
+
 /*
 Returns `i` if it's in range `[0, n - 1]`.
 If it's not then wrapped around.
 */
+static int64
+normalize_index(int64 i, int64 n);
+
+/*
+Reverse `n` bytes at `at`.
+*/
+static void
+reverse_bytes(char *at, int64 n);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: CHARACTER SET                          */
+/*----------------------------------------------------------*/
+
+#ifdef UACC_SSE2
+/*
+Bit k of the result is set if `at[k]` is in `cs`, for k from
+0 to 15. `cs->count` must be from 1 to `CHARSET_FEW`.
+*/
+static unsigned
+cs_match_wide(const Charset *cs, const char *at);
+#endif
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: INTERN                                 */
+/*----------------------------------------------------------*/
+
+/*
+Add `string` with `hash` to `interns` at the free slot `i`.
+Only a thread holding the lock adds. Returns the new ID.
+*/
+static int
+intern_add(Interns *interns, Strview string, unsigned hash,
+  int i);
+
+/*
+Allocate a table of `num_slots` free slots.
+*/
+static InternTable *
+intern_alloc_table(int num_slots);
+
+/*
+Double the number of slots in `interns`.
+*/
+static void
+intern_grow(Interns *interns);
+
+/*
+Find `string` with `hash` in `interns` without the lock.
+Returns its ID, or 0 and sets `*free_slot` to the slot where
+it would go.
+*/
+static int
+intern_lookup(Interns *interns, Strview string, unsigned hash,
+  int *free_slot);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: MAP                                    */
+/*----------------------------------------------------------*/
+
+/*
+Find the index of `key` in `entries` of `num_entries`.
+Returns -1 if `key` is not there.
+*/
+static int
+map_find(const MapEntry *entries, int num_entries, int key);
+
+/*
+Index where the search for `key` starts in a table of
+`num_entries`.
+*/
+static int
+map_home(int key, int num_entries);
+
+/*
+Move a few entries from the old table of `map` to the new one.
+*/
+static void
+map_migrate(Map *map, int num_steps);
+
+/*
+Put `key` and `value` into the current table of `map`.
+*/
+static void
+map_put(Map *map, int key, void *value);
+
+/*
+Remove the entry at `i` from `entries` of `num_entries`
+shifting the next entries back.
+*/
+static void
+map_remove_at(MapEntry *entries, int num_entries, int i);
+
+/*
+Set or remove `key` without logging the change.
+NULL `value` removes `key`. Returns the previous value or NULL.
+*/
+static void *
+map_set_raw(Map *map, int key, void *value);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: MEMORY                                 */
+/*----------------------------------------------------------*/
+
+#ifdef UACC_MEM_STATS
+/*
+Add `delta` bytes to the live bytes of `kind`.
+*/
+static void
+mem_count(int kind, long delta);
+#endif
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: ARENA                                  */
+/*----------------------------------------------------------*/
+
+/*
+Start a new block in `arena` that fits at least `size`
+bytes aligned to `align`.
+*/
+static void
+arena_push_block(Arena *arena, int64 size, int align);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: POOL                                   */
+/*----------------------------------------------------------*/
+
+/*
+Add a new chunk of slots to `pool`.
+*/
+static void
+pool_push_chunk(Pool *pool);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: SOURCE                                 */
+/*----------------------------------------------------------*/
+
+/*
+Read everything from `fd` into the heap of `src`.
+Returns 0 and sets `errno` on failure.
+*/
+static int
+src_read(Source *src, int fd);
+
+/*
+Fill `src->lines` with the offsets where lines start unless
+another thread does it first. Returns the offsets stored.
+*/
+static int64 *
+src_index_lines(Source *src);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: STRING BUFFER                          */
+/*----------------------------------------------------------*/
+
+/*
+Make room for `extra` more characters after `sb->length`
+and the null character.
+*/
+static void
+sb_grow(Strbuf *sb, int64 extra);
+
+/*
+Append a formated string to the end of `sb` in a single pass.
+The buffer grows as the output is produced.
+Returns the number of appended characters.
+*/
+static int64
+sb_vformat(Strbuf *sb, const char *fmt, va_list args);
+
+/*
+Replace `n` characters in `sb` at `i` with a formated string.
+Negative values of `i` are used as a reverse index.
+If `i` equals `sb->length` then this function appends
+the fromated string.
+*/
+static void
+sb_vreplace(Strbuf *sb, int64 i, int64 n, const char *fmt, va_list args);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: STRING VIEW                            */
+/*----------------------------------------------------------*/
+
+/*
+Find the first apearance of `substr` in `string` using
+Horspool's algorithm.
+`substr` must not be longer than `string`.
+*/
+static int64
+sv_find_horspool(Strview string, Strview substr);
+
+/*
+Find the last apearance of `substr` in `string` using
+Horspool's algorithm run backwards.
+`substr` must not be longer than `string`.
+*/
+static int64
+sv_find_horspool_end(Strview string, Strview substr);
+
+/*
+Find the first apearance of `substr` in `string` checking
+its first and last characters at many positions at once.
+`substr` must have at least 2 characters and must not be
+longer than `string`.
+*/
+static int64
+sv_find_wide(Strview string, Strview substr);
+
+/*
+Find the last apearance of `substr` in `string` checking
+its first and last characters at many positions at once.
+`substr` must have at least 2 characters and must not be
+longer than `string`.
+*/
+static int64
+sv_find_wide_end(Strview string, Strview substr);
+
+/*
+Count the first characters from `string` that are in any of
+`classes` if `in` is 1 or that are not if `in` is 0.
+*/
+static int64
+sv_span_class_in(Strview string, int classes, int in);
+
+/*
+Count the last characters from `string` that are in any of
+`classes` if `in` is 1 or that are not if `in` is 0.
+*/
+static int64
+sv_span_class_in_end(Strview string, int classes, int in);
+
+/*
+Count the first characters from `string` that are in `cs`
+if `in` is 1 or that are not in `cs` if `in` is 0.
+*/
+static int64
+sv_span_in(Strview string, const Charset *cs, int in);
+
+/*
+Count the last characters from `string` that are in `cs`
+if `in` is 1 or that are not in `cs` if `in` is 0.
+*/
+static int64
+sv_span_in_end(Strview string, const Charset *cs, int in);
+
+/*
+Same as `sv_span_in` but for the characters of `sample`.
+Short spans are counted by searching `sample`, longer ones
+by a set made on the fly.
+*/
+static int64
+sv_span_sample(Strview string, Strview sample, int in);
+
+/*
+Same as `sv_span_in_end` but for the characters of `sample`.
+*/
+static int64
+sv_span_sample_end(Strview string, Strview sample, int in);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: WRITER                                 */
+/*----------------------------------------------------------*/
+
+/*
+Free the full buffer of `w`: flush it or grow it in memory.
+*/
+static void
+wr_make_room(Writer *w);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: DISK CACHE                             */
+/*----------------------------------------------------------*/
+
+/*
+Compare two `DiskEntry` by time for `qsort`, the least
+recently used first.
+*/
 static int
-normalize_index(int i, int n);
+dc_compare(const void *a, const void *b);
+
+/*
+Append the path of the entry of `key` to `path`.
+*/
+static void
+dc_path(DiskCache *dc, const Digest *key, Strbuf *path);
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: CHARACTER SET                            */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+cc_is(char ch, int classes)
+{
+  return (char_classes[(unsigned char)ch] & classes) != 0;
+}
+
+/*----------------------------------------------------------*/
+int
+cs_has(const Charset *cs, char ch)
+{
+  assert(cs != NULL);
+  /**/
+  return cs->has[(unsigned char)ch];
+}
+
+/*----------------------------------------------------------*/
+void
+cs_init(Charset *cs, Strview sample)
+{
+  unsigned char ch = 0;
+  int64 i = 0;
+  /**/
+  assert(cs != NULL);
+  /**/
+  mem_clear(cs, sizeof(*cs));
+  for (i = 0; i < sample.length; i++) {
+    ch = sample.at[i];
+    if (!cs->has[ch]) {
+      cs->has[ch] = 1;
+      if (cs->count < CHARSET_FEW) {
+        cs->few[cs->count] = ch;
+      }
+      cs->count++;
+    }
+  }
+}
+
+#ifdef UACC_SSE2
+/*----------------------------------------------------------*/
+unsigned
+cs_match_wide(const Charset *cs, const char *at)
+{
+  __m128i chars;
+  __m128i match;
+  int i = 0;
+  /**/
+  assert(cs->count >= 1 && cs->count <= CHARSET_FEW);
+  /**/
+  chars = _mm_loadu_si128((const __m128i *)at);
+  match = _mm_cmpeq_epi8(chars, _mm_set1_epi8(cs->few[0]));
+  for (i = 1; i < cs->count; i++) {
+    match = _mm_or_si128(match,
+      _mm_cmpeq_epi8(chars, _mm_set1_epi8(cs->few[i]))
+    );
+  }
+  return _mm_movemask_epi8(match);
+}
+#endif
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: INTERN                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+intern_add(Interns *interns, Strview string, unsigned hash,
+  int i)
+{
+  InternSlot *slot = NULL;
+  Strview *strings = NULL;
+  char *copy = NULL;
+  int id = 0;
+  /**/
+  if (interns->num_strings == interns->cap_strings) {
+    /* Readers may still use the old copy. */
+    strings = mem_alloc(mem_size_mul(interns->cap_strings * 2,
+      sizeof(*strings)
+    ));
+    memcpy(strings, interns->strings,
+      interns->num_strings * sizeof(*strings)
+    );
+    vec_push(&interns->retired, &interns->strings);
+    ATOMIC_STORE(&interns->strings, strings);
+    interns->cap_strings *= 2;
+  }
+  copy = arena_alloc_align(&interns->arena, string.length + 1, 1);
+  memcpy(copy, string.at, string.length);
+  copy[string.length] = '\0';
+  id = interns->num_strings;
+  interns->strings[id] = sv_array(copy, string.length);
+  ATOMIC_STORE(&interns->num_strings, id + 1);
+  slot = &interns->table->slots[i];
+  slot->hash = hash;
+  ATOMIC_STORE(&slot->id, id);
+  /* Keep the table at most half full. */
+  if (interns->num_strings * 2 > interns->table->num_slots) {
+    intern_grow(interns);
+  }
+  return id;
+}
+
+/*----------------------------------------------------------*/
+InternTable *
+intern_alloc_table(int num_slots)
+{
+  InternTable *table = NULL;
+  /**/
+  table = mem_alloc_zeros(mem_size_add(sizeof(*table),
+    mem_size_mul(num_slots, sizeof(InternSlot))
+  ));
+  table->slots = (InternSlot *)(table + 1);
+  table->num_slots = num_slots;
+  return table;
+}
+
+/*----------------------------------------------------------*/
+void
+intern_deinit(Interns *interns)
+{
+  int64 i = 0;
+  /**/
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  /**/
+  for (i = 0; i < interns->retired.length; i++) {
+    mem_free(((void **)interns->retired.at)[i]);
+  }
+  vec_deinit(&interns->retired);
+  lock_deinit(&interns->lock);
+  arena_deinit(&interns->arena);
+  mem_free(interns->table);
+  mem_free(interns->strings);
+  mem_clear(interns, sizeof(*interns));
+}
+
+/*----------------------------------------------------------*/
+int
+intern_find(Interns *interns, Strview string)
+{
+  int i = 0;
+  /**/
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  /**/
+  return intern_lookup(interns, string, sv_hash(string), &i);
+}
+
+/*----------------------------------------------------------*/
+void
+intern_grow(Interns *interns)
+{
+  InternTable *old = NULL;
+  InternTable *table = NULL;
+  InternSlot *slot = NULL;
+  int mask = 0;
+  int i = 0;
+  int k = 0;
+  /**/
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  /**/
+  old = interns->table;
+  table = intern_alloc_table(old->num_slots * 2);
+  mask = table->num_slots - 1;
+  for (k = 0; k < old->num_slots; k++) {
+    if (old->slots[k].id == 0) {
+      continue;
+    }
+    i = old->slots[k].hash & mask;
+    slot = &table->slots[i];
+    while (slot->id != 0) {
+      i = (i + 1) & mask;
+      slot = &table->slots[i];
+    }
+    *slot = old->slots[k];
+  }
+  /* Readers may still probe the old table. */
+  vec_push(&interns->retired, &old);
+  ATOMIC_STORE(&interns->table, table);
+}
+
+/*----------------------------------------------------------*/
+void
+intern_init(Interns *interns)
+{
+  int i = 0;
+  /**/
+  assert(interns != NULL);
+  assert(!interns->is_inited);
+  /**/
+  arena_init(&interns->arena, 0);
+  interns->table = intern_alloc_table(1024);
+  interns->cap_strings = 512;
+  interns->strings = mem_alloc(
+    interns->cap_strings * sizeof(*interns->strings)
+  );
+  /* ID 0 means no string. */
+  interns->strings[0] = sv_array("", 0);
+  interns->num_strings = 1;
+  vec_init(&interns->retired, sizeof(void *), 0);
+  lock_init(&interns->lock);
+  interns->is_inited = 1;
+  for (i = 1; i < KW_COUNT; i++) {
+    intern_sv(interns, sv_cstr(keywords[i]));
+  }
+  for (i = KW_COUNT; i < PW_COUNT; i++) {
+    intern_sv(interns, sv_cstr(pp_words[i - KW_COUNT]));
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+intern_lookup(Interns *interns, Strview string, unsigned hash,
+  int *free_slot)
+{
+  const InternTable *table = NULL;
+  const InternSlot *slot = NULL;
+  const Strview *strings = NULL;
+  int mask = 0;
+  int id = 0;
+  int i = 0;
+  /**/
+  table = ATOMIC_LOAD(&interns->table);
+  mask = table->num_slots - 1;
+  for (i = hash & mask;; i = (i + 1) & mask) {
+    slot = &table->slots[i];
+    id = ATOMIC_LOAD(&slot->id);
+    if (id == 0) {
+      *free_slot = i;
+      return 0;
+    }
+    if (slot->hash == hash) {
+      strings = ATOMIC_LOAD(&interns->strings);
+      if (sv_equal(strings[id], string)) {
+        return id;
+      }
+    }
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+intern_sv(Interns *interns, Strview string)
+{
+  unsigned hash = 0;
+  int id = 0;
+  int i = 0;
+  /**/
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  /**/
+  hash = sv_hash(string);
+  id = intern_lookup(interns, string, hash, &i);
+  if (id != 0) {
+    return id;
+  }
+  lock_acquire(&interns->lock);
+  /* Another thread may have added it meanwhile. */
+  id = intern_lookup(interns, string, hash, &i);
+  if (id == 0) {
+    id = intern_add(interns, string, hash, i);
+  }
+  lock_release(&interns->lock);
+  return id;
+}
+
+/*----------------------------------------------------------*/
+Strview
+intern_view(Interns *interns, int id)
+{
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  assert(id > 0 && id < ATOMIC_LOAD(&interns->num_strings));
+  /**/
+  return ATOMIC_LOAD(&interns->strings)[id];
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: MAP                                      */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+map_deinit(Map *map)
+{
+  assert(map != NULL);
+  assert(map->is_inited);
+  /**/
+  mem_free(map->entries);
+  if (map->old_entries != NULL) {
+    mem_free(map->old_entries);
+  }
+  mem_free(map->undo);
+  mem_free(map->scopes);
+  mem_clear(map, sizeof(*map));
+}
+
+/*----------------------------------------------------------*/
+int
+map_find(const MapEntry *entries, int num_entries, int key)
+{
+  int mask = 0;
+  int i = 0;
+  /**/
+  assert(entries != NULL);
+  assert(key > 0);
+  /**/
+  mask = num_entries - 1;
+  for (i = map_home(key, num_entries);; i = (i + 1) & mask) {
+    if (entries[i].key == key) {
+      return i;
+    }
+    if (entries[i].key == 0) {
+      return -1;
+    }
+  }
+}
+
+/*----------------------------------------------------------*/
+void *
+map_get(Map *map, int key)
+{
+  int i = 0;
+  /**/
+  assert(map != NULL);
+  assert(map->is_inited);
+  assert(key > 0);
+  /**/
+  i = map_find(map->entries, map->num_entries, key);
+  if (i >= 0) {
+    return map->entries[i].value;
+  }
+  if (map->old_entries != NULL) {
+    i = map_find(map->old_entries, map->num_old_entries, key);
+    if (i >= 0) {
+      return map->old_entries[i].value;
+    }
+  }
+  return NULL;
+}
+
+/*----------------------------------------------------------*/
+int
+map_home(int key, int num_entries)
+{
+  /* IDs are dense, multiplying by an odd number spreads them. */
+  return (int)((key * 0x9E3779B1UL) & (num_entries - 1));
+}
+
+/*----------------------------------------------------------*/
+void
+map_init(Map *map)
+{
+  assert(map != NULL);
+  assert(!map->is_inited);
+  /**/
+  map->num_entries = 64;
+  map->entries = mem_alloc_zeros(map->num_entries * sizeof(MapEntry));
+  map->count = 0;
+  map->old_entries = NULL;
+  map->num_old_entries = 0;
+  map->old_count = 0;
+  map->old_index = 0;
+  map->cap_undo = 64;
+  map->undo = mem_alloc(map->cap_undo * sizeof(MapUndo));
+  map->num_undo = 0;
+  map->cap_scopes = 16;
+  map->scopes = mem_alloc(map->cap_scopes * sizeof(int));
+  map->num_scopes = 0;
+  map->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+void
+map_migrate(Map *map, int num_steps)
+{
+  MapEntry entry;
+  int i = 0;
+  /**/
+  assert(map != NULL);
+  assert(map->is_inited);
+  /**/
+  while (map->old_entries != NULL && num_steps-- > 0) {
+    if (map->old_count == 0) {
+      mem_free(map->old_entries);
+      map->old_entries = NULL;
+      map->num_old_entries = 0;
+      break;
+    }
+    /*
+    Slots before `old_index` are empty: removing at `old_index`
+    only shifts later entries back into it.
+    */
+    i = map->old_index;
+    entry = map->old_entries[i];
+    if (entry.key == 0) {
+      map->old_index++;
+      continue;
+    }
+    map_remove_at(map->old_entries, map->num_old_entries, i);
+    map->old_count--;
+    map_put(map, entry.key, entry.value);
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+map_pop_scope(Map *map)
+{
+  MapUndo *undo = NULL;
+  int start = 0;
+  /**/
+  assert(map != NULL);
+  assert(map->is_inited);
+  assert(map->num_scopes > 0);
+  /**/
+  start = map->scopes[--map->num_scopes];
+  while (map->num_undo > start) {
+    undo = &map->undo[--map->num_undo];
+    map_set_raw(map, undo->key, undo->value);
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+map_push_scope(Map *map)
+{
+  assert(map != NULL);
+  assert(map->is_inited);
+  /**/
+  if (map->num_scopes == map->cap_scopes) {
+    map->cap_scopes *= 2;
+    map->scopes = mem_realloc(map->scopes,
+      map->cap_scopes * sizeof(int)
+    );
+  }
+  map->scopes[map->num_scopes++] = map->num_undo;
+}
+
+/*----------------------------------------------------------*/
+void
+map_put(Map *map, int key, void *value)
+{
+  MapEntry *entry = NULL;
+  int mask = 0;
+  int i = 0;
+  /**/
+  assert(map != NULL);
+  assert(map->is_inited);
+  /**/
+  mask = map->num_entries - 1;
+  for (i = map_home(key, map->num_entries);; i = (i + 1) & mask) {
+    entry = &map->entries[i];
+    if (entry->key == key) {
+      entry->value = value;
+      return;
+    }
+    if (entry->key == 0) {
+      break;
+    }
+  }
+  entry->key = key;
+  entry->value = value;
+  map->count++;
+}
+
+/*----------------------------------------------------------*/
+void
+map_remove(Map *map, int key)
+{
+  assert(map != NULL);
+  assert(map->is_inited);
+  assert(key > 0);
+  /**/
+  map_set(map, key, NULL);
+}
+
+/*----------------------------------------------------------*/
+void
+map_remove_at(MapEntry *entries, int num_entries, int i)
+{
+  int mask = 0;
+  int j = 0;
+  int home = 0;
+  /**/
+  assert(entries != NULL);
+  assert(entries[i].key != 0);
+  /**/
+  mask = num_entries - 1;
+  for (j = (i + 1) & mask; entries[j].key != 0; j = (j + 1) & mask) {
+    home = map_home(entries[j].key, num_entries);
+    /* Move the entry at `j` to `i` if `i` is in `[home, j)`. */
+    if (((i - home) & mask) < ((j - home) & mask)) {
+      entries[i] = entries[j];
+      i = j;
+    }
+  }
+  entries[i].key = 0;
+  entries[i].value = NULL;
+}
+
+/*----------------------------------------------------------*/
+void
+map_set(Map *map, int key, void *value)
+{
+  MapUndo *undo = NULL;
+  void *old_value = NULL;
+  /**/
+  assert(map != NULL);
+  assert(map->is_inited);
+  assert(key > 0);
+  /**/
+  old_value = map_set_raw(map, key, value);
+  if (map->num_scopes == 0 || old_value == value) {
+    return;
+  }
+  if (map->num_undo == map->cap_undo) {
+    map->cap_undo *= 2;
+    map->undo = mem_realloc(map->undo, map->cap_undo * sizeof(MapUndo));
+  }
+  undo = &map->undo[map->num_undo++];
+  undo->key = key;
+  undo->value = old_value;
+}
+
+/*----------------------------------------------------------*/
+void *
+map_set_raw(Map *map, int key, void *value)
+{
+  void *old_value = NULL;
+  int i = 0;
+  /**/
+  assert(map != NULL);
+  assert(map->is_inited);
+  /**/
+  map_migrate(map, 8);
+  i = map_find(map->entries, map->num_entries, key);
+  if (i >= 0) {
+    old_value = map->entries[i].value;
+    if (value == NULL) {
+      map_remove_at(map->entries, map->num_entries, i);
+      map->count--;
+    } else {
+      map->entries[i].value = value;
+    }
+    return old_value;
+  }
+  if (map->old_entries != NULL) {
+    i = map_find(map->old_entries, map->num_old_entries, key);
+    if (i >= 0) {
+      old_value = map->old_entries[i].value;
+      map_remove_at(map->old_entries, map->num_old_entries, i);
+      map->old_count--;
+    }
+  }
+  if (value == NULL) {
+    return old_value;
+  }
+  /* Keep the table at most half full. */
+  if (old_value == NULL
+      && (map->count + map->old_count + 1) * 2 > map->num_entries) {
+    /* The last move is over long before this, finish it anyway. */
+    map_migrate(map, INT_MAX);
+    map->old_entries = map->entries;
+    map->num_old_entries = map->num_entries;
+    map->old_count = map->count;
+    map->old_index = 0;
+    map->num_entries *= 2;
+    map->entries = mem_alloc_zeros(map->num_entries * sizeof(MapEntry));
+    map->count = 0;
+  }
+  map_put(map, key, value);
+  return old_value;
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: MEMORY                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void *
+mem_alloc(int64 size)
+{
+  assert(size > 0);
+  /**/
+  return mem_alloc_for(MEM_KIND_OTHER, size);
+}
+
+/*----------------------------------------------------------*/
+void *
+mem_alloc_for(MemKind kind, int64 size)
+{
+  void *ptr = NULL;
+#ifdef UACC_MEM_STATS
+  MemHeader *header = NULL;
+#endif
+  /**/
+  assert(kind >= 0 && kind < MEM_KIND_COUNT);
+  assert(size > 0);
+  /**/
+#ifdef UACC_MEM_STATS
+  ptr = malloc(sizeof(*header) + size);
+#else
+  ptr = malloc(size);
+#endif
+  if (ptr == NULL) {
+    fprintf(stderr, "%s",
+      "uacc: error: sorry, not enough memory\n"
+    );
+    exit(EXIT_FAILURE);
+  }
+#ifdef UACC_MEM_STATS
+  header = ptr;
+  header->info.size = size;
+  header->info.kind = kind;
+  G->mem_stats[kind].num_allocs++;
+  G->mem_total.num_allocs++;
+  mem_count(kind, size);
+  ptr = header + 1;
+#endif
+  return ptr;
+}
+
+/*----------------------------------------------------------*/
+void *
+mem_alloc_zeros(int64 size)
+{
+  void *ptr = NULL;
+  /**/
+  assert(size > 0);
+  /**/
+  ptr = mem_alloc(size);
+  mem_clear(ptr, size);
+  return ptr;
+}
+
+/*----------------------------------------------------------*/
+void
+mem_clear(void *ptr, int64 size)
+{
+  assert(size > 0);
+  /**/
+  memset(ptr, 0, size);
+}
+
+#ifdef UACC_MEM_STATS
+/*----------------------------------------------------------*/
+void
+mem_count(int kind, long delta)
+{
+  MemStats *stats = NULL;
+  /**/
+  stats = &G->mem_stats[kind];
+  stats->live_bytes += delta;
+  if (stats->live_bytes > stats->peak_bytes) {
+    stats->peak_bytes = stats->live_bytes;
+  }
+  stats = &G->mem_total;
+  stats->live_bytes += delta;
+  if (stats->live_bytes > stats->peak_bytes) {
+    stats->peak_bytes = stats->live_bytes;
+  }
+}
+#endif
+
+/*----------------------------------------------------------*/
+void
+mem_free(void *ptr)
+{
+#ifdef UACC_MEM_STATS
+  MemHeader *header = NULL;
+#endif
+  /**/
+  assert(ptr != NULL);
+  /**/
+#ifdef UACC_MEM_STATS
+  header = (MemHeader *)ptr - 1;
+  mem_count(header->info.kind, -header->info.size);
+  ptr = header;
+#endif
+  free(ptr);
+}
+
+/*----------------------------------------------------------*/
+void
+mem_print_stats(FILE *file)
+{
+#ifdef UACC_MEM_STATS
+  static const char *names[MEM_KIND_COUNT] = {
+    "other", "strbuf", "arena", "pool", "vector", "tokens"
+  };
+  MemStats *stats = NULL;
+  int i = 0;
+#endif
+  struct rusage usage;
+  /**/
+  assert(file != NULL);
+  /**/
+  fprintf(file, "%s", "      MEMORY\n");
+#ifdef UACC_MEM_STATS
+  fprintf(file, "%-8s %12s %12s %10s %10s\n",
+    "kind", "live bytes", "peak bytes", "allocs", "reallocs"
+  );
+  for (i = 0; i <= MEM_KIND_COUNT; i++) {
+    if (i < MEM_KIND_COUNT) {
+      stats = &G->mem_stats[i];
+    } else {
+      stats = &G->mem_total;
+    }
+    fprintf(file, "%-8s %12ld %12ld %10ld %10ld\n",
+      i < MEM_KIND_COUNT ? names[i] : "total",
+      stats->live_bytes, stats->peak_bytes,
+      stats->num_allocs, stats->num_reallocs
+    );
+  }
+#else
+  fprintf(file, "%s",
+    "uacc: note: build with -DUACC_MEM_STATS to count bytes\n"
+  );
+#endif
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    fprintf(file, "peak RSS: %ld KB\n", (long)usage.ru_maxrss);
+  }
+}
+
+/*----------------------------------------------------------*/
+void *
+mem_realloc(void *ptr, int64 size)
+{
+  void *new_ptr = NULL;
+#ifdef UACC_MEM_STATS
+  MemHeader *header = NULL;
+#endif
+  /**/
+  assert(ptr != NULL);
+  assert(size > 0);
+  /**/
+#ifdef UACC_MEM_STATS
+  header = (MemHeader *)ptr - 1;
+  mem_count(header->info.kind, size - header->info.size);
+  G->mem_stats[header->info.kind].num_reallocs++;
+  G->mem_total.num_reallocs++;
+  new_ptr = realloc(header, sizeof(*header) + size);
+#else
+  new_ptr = realloc(ptr, size);
+#endif
+  if (new_ptr == NULL) {
+    fprintf(stderr, "%s",
+      "uacc: error: sorry, not enough memory\n"
+    );
+    exit(EXIT_FAILURE);
+  }
+#ifdef UACC_MEM_STATS
+  header = new_ptr;
+  header->info.size = size;
+  new_ptr = header + 1;
+#endif
+  return new_ptr;
+}
+
+/*----------------------------------------------------------*/
+void *
+mem_realloc_zeros(void *ptr, int64 size, int64 old_size)
+{
+  void *new_ptr = NULL;
+  int64 num_new_bytes = 0;
+  /**/
+  assert(ptr != NULL);
+  assert(size > 0);
+  assert(old_size > 0);
+  /**/
+  if (size <= old_size) {
+    return ptr;
+  }
+  num_new_bytes = size - old_size;
+  new_ptr = mem_realloc(ptr, size);
+  mem_clear((char *)new_ptr + old_size, num_new_bytes);
+  return new_ptr;
+}
+
+/*----------------------------------------------------------*/
+int64
+mem_size_add(int64 a, int64 b)
+{
+  assert(a >= 0);
+  assert(b >= 0);
+  /**/
+  if (a > MEM_SIZE_MAX - b) {
+    fprintf(stderr, "%s",
+      "uacc: error: sorry, not enough memory\n"
+    );
+    exit(EXIT_FAILURE);
+  }
+  return a + b;
+}
+
+/*----------------------------------------------------------*/
+int64
+mem_size_mul(int64 a, int64 b)
+{
+  assert(a >= 0);
+  assert(b >= 0);
+  /**/
+  if (b != 0 && a > MEM_SIZE_MAX / b) {
+    fprintf(stderr, "%s",
+      "uacc: error: sorry, not enough memory\n"
+    );
+    exit(EXIT_FAILURE);
+  }
+  return a * b;
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: ARENA                                    */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void *
+arena_alloc(Arena *arena, int64 size)
+{
+  return arena_alloc_align(arena, size, ARENA_ALIGN);
+}
+
+/*----------------------------------------------------------*/
+void *
+arena_alloc_align(Arena *arena, int64 size, int align)
+{
+  char *ptr = NULL;
+  int64 skip = 0;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  assert(size >= 0);
+  assert(align > 0 && (align & (align - 1)) == 0);
+  /**/
+  skip = -(unsigned long)arena->at & (align - 1);
+  if (size > arena->end - arena->at - skip) {
+    arena_push_block(arena, size, align);
+    skip = -(unsigned long)arena->at & (align - 1);
+  }
+  ptr = arena->at + skip;
+  arena->at = ptr + size;
+  return ptr;
+}
+
+/*----------------------------------------------------------*/
+void *
+arena_alloc_zeros(Arena *arena, int64 size)
+{
+  void *ptr = NULL;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  assert(size >= 0);
+  /**/
+  ptr = arena_alloc(arena, size);
+  if (size > 0) {
+    mem_clear(ptr, size);
+  }
+  return ptr;
+}
+
+/*----------------------------------------------------------*/
+void
+arena_clear(Arena *arena)
+{
+  ArenaMark mark;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  /**/
+  mark.block = arena->block;
+  while (mark.block->prev != NULL) {
+    mark.block = mark.block->prev;
+  }
+  mark.at = (char *)(mark.block + 1);
+  arena_rewind(arena, mark);
+}
+
+/*----------------------------------------------------------*/
+void
+arena_deinit(Arena *arena)
+{
+  ArenaBlock *prev = NULL;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  /**/
+  while (arena->block != NULL) {
+    prev = arena->block->prev;
+    mem_free(arena->block);
+    arena->block = prev;
+  }
+  mem_clear(arena, sizeof(*arena));
+}
+
+/*----------------------------------------------------------*/
+void
+arena_init(Arena *arena, int64 block_size)
+{
+  assert(arena != NULL);
+  assert(!arena->is_inited);
+  assert(block_size >= 0);
+  /**/
+  if (block_size == 0) {
+    block_size = ARENA_BLOCK_SIZE;
+  }
+  arena->block = NULL;
+  arena->at = NULL;
+  arena->end = NULL;
+  arena->block_size = block_size;
+  arena->is_inited = 1;
+  arena_push_block(arena, 0, 1);
+}
+
+/*----------------------------------------------------------*/
+ArenaMark
+arena_mark(Arena *arena)
+{
+  ArenaMark mark;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  /**/
+  mark.block = arena->block;
+  mark.at = arena->at;
+  return mark;
+}
+
+/*----------------------------------------------------------*/
+void
+arena_push_block(Arena *arena, int64 size, int align)
+{
+  ArenaBlock *block = NULL;
+  int64 block_size = 0;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  /**/
+  block_size = arena->block_size;
+  if (size > block_size - align) {
+    block_size = mem_size_add(size, align);
+  }
+  block = mem_alloc_for(MEM_KIND_ARENA,
+    mem_size_add(sizeof(*block), block_size)
+  );
+  block->prev = arena->block;
+  block->size = block_size;
+  arena->block = block;
+  arena->at = (char *)(block + 1);
+  arena->end = arena->at + block_size;
+}
+
+/*----------------------------------------------------------*/
+void
+arena_rewind(Arena *arena, ArenaMark mark)
+{
+  ArenaBlock *prev = NULL;
+  /**/
+  assert(arena != NULL);
+  assert(arena->is_inited);
+  assert(mark.block != NULL);
+  /**/
+  while (arena->block != mark.block) {
+    assert(arena->block != NULL);
+    prev = arena->block->prev;
+    mem_free(arena->block);
+    arena->block = prev;
+  }
+  arena->at = mark.at;
+  arena->end = (char *)(mark.block + 1) + mark.block->size;
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: POOL                                     */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void *
+pool_alloc(Pool *pool)
+{
+  void *ptr = NULL;
+  /**/
+  assert(pool != NULL);
+  assert(pool->is_inited);
+  /**/
+  if (pool->free_list != NULL) {
+    ptr = pool->free_list;
+    pool->free_list = *(void **)ptr;
+  } else {
+    if (pool->at == pool->end) {
+      pool_push_chunk(pool);
+    }
+    ptr = pool->at;
+    pool->at += pool->slot_size;
+  }
+  pool->live_slots++;
+  if (pool->live_slots > pool->peak_slots) {
+    pool->peak_slots = pool->live_slots;
+  }
+  return ptr;
+}
+
+/*----------------------------------------------------------*/
+void *
+pool_alloc_zeros(Pool *pool)
+{
+  void *ptr = NULL;
+  /**/
+  assert(pool != NULL);
+  assert(pool->is_inited);
+  /**/
+  ptr = pool_alloc(pool);
+  mem_clear(ptr, pool->slot_size);
+  return ptr;
+}
+
+/*----------------------------------------------------------*/
+void
+pool_clear(Pool *pool)
+{
+  PoolChunk *prev = NULL;
+  /**/
+  assert(pool != NULL);
+  assert(pool->is_inited);
+  /**/
+  if (pool->chunk == NULL) {
+    return;
+  }
+  while (pool->chunk->prev != NULL) {
+    prev = pool->chunk->prev->prev;
+    mem_free(pool->chunk->prev);
+    pool->chunk->prev = prev;
+  }
+  pool->free_list = NULL;
+  pool->at = pool->end - pool->slot_size * pool->chunk_slots;
+  pool->live_slots = 0;
+}
+
+/*----------------------------------------------------------*/
+void
+pool_deinit(Pool *pool)
+{
+  PoolChunk *prev = NULL;
+  /**/
+  assert(pool != NULL);
+  assert(pool->is_inited);
+  /**/
+  while (pool->chunk != NULL) {
+    prev = pool->chunk->prev;
+    mem_free(pool->chunk);
+    pool->chunk = prev;
+  }
+  mem_clear(pool, sizeof(*pool));
+}
+
+/*----------------------------------------------------------*/
+void
+pool_free(Pool *pool, void *ptr)
+{
+  assert(pool != NULL);
+  assert(pool->is_inited);
+  assert(ptr != NULL);
+  assert(pool->live_slots > 0);
+  /**/
+  *(void **)ptr = pool->free_list;
+  pool->free_list = ptr;
+  pool->live_slots--;
+}
+
+/*----------------------------------------------------------*/
+void
+pool_init(Pool *pool, int slot_size, int chunk_slots)
+{
+  assert(pool != NULL);
+  assert(!pool->is_inited);
+  assert(slot_size > 0);
+  assert(chunk_slots >= 0);
+  /**/
+  if (slot_size < (int)sizeof(void *)) {
+    slot_size = sizeof(void *);
+  }
+  slot_size = (slot_size + ARENA_ALIGN - 1) & -ARENA_ALIGN;
+  if (chunk_slots == 0) {
+    chunk_slots = POOL_CHUNK_SLOTS;
+  }
+  pool->chunk = NULL;
+  pool->free_list = NULL;
+  pool->at = NULL;
+  pool->end = NULL;
+  pool->slot_size = slot_size;
+  pool->chunk_slots = chunk_slots;
+  pool->live_slots = 0;
+  pool->peak_slots = 0;
+  pool->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+void
+pool_push_chunk(Pool *pool)
+{
+  PoolChunk *chunk = NULL;
+  int size = 0;
+  /**/
+  assert(pool != NULL);
+  assert(pool->is_inited);
+  /**/
+  size = pool->slot_size * pool->chunk_slots;
+  chunk = mem_alloc_for(MEM_KIND_POOL, sizeof(*chunk) + ARENA_ALIGN + size);
+  chunk->prev = pool->chunk;
+  pool->chunk = chunk;
+  pool->at = (char *)(chunk + 1);
+  pool->at += -(unsigned long)pool->at & (ARENA_ALIGN - 1);
+  pool->end = pool->at + size;
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: STRING BUFFER                            */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+sb_append(Strbuf *sb, const char *fmt, ...)
+{
+  va_list args;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  va_start(args, fmt);
+  sb_vreplace(sb, sb->length, 0, fmt, args);
+  va_end(args);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_append_bytes(Strbuf *sb, const char *at, int64 n)
+{
+  int64 offset = 0;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  assert(n >= 0);
+  /**/
+  if (n == 0) {
+    return;
+  }
+  assert(at != NULL);
+  offset = at - sb->at;
+  if (n >= sb->capacity - sb->length) {
+    if (offset >= 0 && offset < sb->capacity) {
+      /* `at` points into `sb`, keep it valid after growing. */
+      sb_grow(sb, n);
+      at = sb->at + offset;
+    } else {
+      sb_grow(sb, n);
+    }
+  }
+  memcpy(sb->at + sb->length, at, n);
+  sb->length += n;
+  sb->at[sb->length] = '\0';
+}
+
+/*----------------------------------------------------------*/
+void
+sb_append_char(Strbuf *sb, char ch)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  if (sb->length + 2 > sb->capacity) {
+    sb_grow(sb, 1);
+  }
+  sb->at[sb->length++] = ch;
+  sb->at[sb->length] = '\0';
+}
+
+/*----------------------------------------------------------*/
+void
+sb_append_hex(Strbuf *sb, unsigned long value)
+{
+  char digits[32];
+  char *first = NULL;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  first = format_digits(digits, value, 16, 0);
+  sb_append_bytes(sb, first, digits + sizeof(digits) - first);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_append_int(Strbuf *sb, long value)
+{
+  char digits[32];
+  char *first = NULL;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  if (value < 0) {
+    first = format_digits(digits, 0UL - (unsigned long)value, 10, 0);
+    *--first = '-';
+  } else {
+    first = format_digits(digits, value, 10, 0);
+  }
+  sb_append_bytes(sb, first, digits + sizeof(digits) - first);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_append_sv(Strbuf *sb, Strview sv)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  sb_append_bytes(sb, sv.at, sv.length);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_append_uint(Strbuf *sb, unsigned long value)
+{
+  char digits[32];
+  char *first = NULL;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  first = format_digits(digits, value, 10, 0);
+  sb_append_bytes(sb, first, digits + sizeof(digits) - first);
+}
+
+/*----------------------------------------------------------*/
+char *
+sb_at(Strbuf *sb, int64 i)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  if (sb->length == 0) {
+    return sb->at;
+  }
+  i = normalize_index(i, sb->length);
+  return &sb->at[i];
+}
+
+/*----------------------------------------------------------*/
+void
+sb_clear(Strbuf *sb)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  sb->length = 0;
+  sb->at[0] = '\0';
+}
+
+/*----------------------------------------------------------*/
+void
+sb_copy(Strbuf *sb, const char *fmt, ...)
+{
+  va_list args;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  va_start(args, fmt);
+  sb_vreplace(sb, 0, sb->length, fmt, args);
+  va_end(args);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_deinit(Strbuf *sb)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  if (sb->at != sb->small) {
+    mem_free(sb->at);
+  }
+  mem_clear(sb, sizeof(*sb));
+}
+
+/*----------------------------------------------------------*/
+void
+sb_grow(Strbuf *sb, int64 extra)
+{
+  int64 new_size = 0;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  assert(extra >= 0);
+  /**/
+  new_size = mem_size_add(mem_size_add(sb->length, extra), 1);
+  if (new_size > sb->capacity) {
+    sb_reserve(sb, mem_size_mul(new_size, 2));
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+sb_init(Strbuf *sb)
+{
+  assert(sb != NULL);
+  assert(!sb->is_inited);
+  /**/
+  sb->length = 0;
+  sb->capacity = SB_SMALL;
+  sb->at = sb->small;
+  sb->at[0] = '\0';
+  sb->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+void
+sb_insert(Strbuf *sb, int64 i, const char *fmt, ...)
+{
+  va_list args;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  va_start(args, fmt);
+  sb_vreplace(sb, i, 0, fmt, args);
+  va_end(args);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_insert_bytes(Strbuf *sb, int64 i, const char *at, int64 n)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  sb_replace_bytes(sb, i, 0, at, n);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_insert_sv(Strbuf *sb, int64 i, Strview sv)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  sb_replace_bytes(sb, i, 0, sv.at, sv.length);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_remove(Strbuf *sb, int64 i, int64 n)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  sb_replace_bytes(sb, i, n, "", 0);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_replace(Strbuf *sb, int64 i, int64 n, const char *fmt, ...)
+{
+  va_list args;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  va_start(args, fmt);
+  sb_vreplace(sb, i, n, fmt, args);
+  va_end(args);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_replace_bytes(Strbuf *sb, int64 i, int64 n, const char *at, int64 count)
+{
+  char *copy = NULL;
+  char *dst = NULL;
+  int64 offset = 0;
+  int64 removed = 0;
+  int64 moved = 0;
+  int64 pos = 0;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  assert(n >= 0);
+  assert(count >= 0);
+  assert(count == 0 || at != NULL);
+  /**/
+  pos = i;
+  if (i != sb->length) {
+    pos = normalize_index(i, sb->length);
+  }
+  removed = n;
+  if (removed > sb->length - pos) {
+    removed = sb->length - pos;
+  }
+  offset = at - sb->at;
+  if (count != 0 && offset >= 0 && offset < sb->capacity) {
+    /* `at` points into `sb` and would be moved under our feet. */
+    copy = mem_alloc_for(MEM_KIND_STRBUF, count);
+    memcpy(copy, at, count);
+    at = copy;
+  }
+  if (count > removed) {
+    sb_grow(sb, count - removed);
+  }
+  dst = sb->at + pos;
+  moved = sb->length - pos - removed;
+  if (moved > 0 && count != removed) {
+    memmove(dst + count, dst + removed, moved);
+  }
+  if (count != 0) {
+    memcpy(dst, at, count);
+  }
+  sb->length = sb->length - removed + count;
+  sb->at[sb->length] = '\0';
+  if (copy != NULL) {
+    mem_free(copy);
+  }
+}
+
+/*----------------------------------------------------------*/
+void
+sb_replace_sv(Strbuf *sb, int64 i, int64 n, Strview sv)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  sb_replace_bytes(sb, i, n, sv.at, sv.length);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_reserve(Strbuf *sb, int64 cap)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  if (cap <= sb->capacity) {
+    return;
+  }
+  if (sb->at == sb->small) {
+    sb->at = mem_alloc_for(MEM_KIND_STRBUF, cap);
+    memcpy(sb->at, sb->small, sb->length + 1);
+  } else {
+    sb->at = mem_realloc(sb->at, cap);
+  }
+  sb->capacity = cap;
+}
+
+/*----------------------------------------------------------*/
+int64
+sb_vformat(Strbuf *sb, const char *fmt, va_list args)
+{
+  char digits[32];
+  const char *spec = NULL;
+  const char *body = NULL;
+  const char *prefix = NULL;
+  const char *end = NULL;
+  char *dst = NULL;
+  unsigned long value = 0;
+  long signed_value = 0;
+  int64 old_length = 0;
+  int is_left = 0;
+  int is_zero = 0;
+  int is_plus = 0;
+  int is_space = 0;
+  int is_alt = 0;
+  int is_long = 0;
+  int is_short = 0;
+  int is_number = 0;
+  int width = 0;
+  int precision = 0;
+  int64 body_length = 0;
+  int64 prefix_length = 0;
+  int64 zeros = 0;
+  int64 pad = 0;
+  int base = 0;
+  char conv = 0;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  assert(fmt != NULL);
+  /**/
+  old_length = sb->length;
+  while (*fmt != '\0') {
+    /* Literal text up to the next conversion. */
+    spec = fmt;
+    while (*fmt != '\0' && *fmt != '%') {
+      fmt++;
+    }
+    if (fmt != spec) {
+      body_length = fmt - spec;
+      sb_grow(sb, body_length);
+      memcpy(sb->at + sb->length, spec, body_length);
+      sb->length += body_length;
+      continue;
+    }
+    /* Flags. */
+    fmt++;
+    is_left = 0;
+    is_zero = 0;
+    is_plus = 0;
+    is_space = 0;
+    is_alt = 0;
+    for (;; fmt++) {
+      if (*fmt == '-') {
+        is_left = 1;
+      } else if (*fmt == '0') {
+        is_zero = 1;
+      } else if (*fmt == '+') {
+        is_plus = 1;
+      } else if (*fmt == ' ') {
+        is_space = 1;
+      } else if (*fmt == '#') {
+        is_alt = 1;
+      } else {
+        break;
+      }
+    }
+    /* Width. */
+    width = 0;
+    if (*fmt == '*') {
+      width = va_arg(args, int);
+      if (width < 0) {
+        is_left = 1;
+        width = -width;
+      }
+      fmt++;
+    }
+    while (isdigit((unsigned char)*fmt)) {
+      width = width * 10 + (*fmt++ - '0');
+    }
+    /* Precision. */
+    precision = -1;
+    if (*fmt == '.') {
+      fmt++;
+      precision = 0;
+      if (*fmt == '*') {
+        precision = va_arg(args, int);
+        fmt++;
+      }
+      while (isdigit((unsigned char)*fmt)) {
+        precision = precision * 10 + (*fmt++ - '0');
+      }
+    }
+    /* Length. */
+    is_long = 0;
+    is_short = 0;
+    if (*fmt == 'l') {
+      is_long = 1;
+      fmt++;
+    } else if (*fmt == 'h') {
+      is_short = 1;
+      fmt++;
+    }
+    /* Conversion. */
+    conv = *fmt;
+    if (conv != '\0') {
+      fmt++;
+    }
+    prefix = "";
+    is_number = 1;
+    base = 10;
+    value = 0;
+    switch (conv) {
+    case 'd':
+    case 'i':
+      if (is_long) {
+        signed_value = va_arg(args, long);
+      } else {
+        signed_value = va_arg(args, int);
+      }
+      if (is_short) {
+        signed_value = (short)signed_value;
+      }
+      if (signed_value < 0) {
+        value = 0UL - (unsigned long)signed_value;
+        prefix = "-";
+      } else {
+        value = signed_value;
+        if (is_plus) {
+          prefix = "+";
+        } else if (is_space) {
+          prefix = " ";
+        }
+      }
+      break;
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+      if (is_long) {
+        value = va_arg(args, unsigned long);
+      } else {
+        value = va_arg(args, unsigned int);
+      }
+      if (is_short) {
+        value = (unsigned short)value;
+      }
+      if (conv == 'o') {
+        base = 8;
+      } else if (conv != 'u') {
+        base = 16;
+        if (is_alt && value != 0) {
+          prefix = conv == 'x' ? "0x" : "0X";
+        }
+      }
+      break;
+    case 'p':
+      value = (unsigned long)va_arg(args, void *);
+      base = 16;
+      prefix = "0x";
+      break;
+    case 'c':
+      is_number = 0;
+      digits[0] = (char)va_arg(args, int);
+      body = digits;
+      body_length = 1;
+      break;
+    case 's':
+      is_number = 0;
+      body = va_arg(args, const char *);
+      if (body == NULL) {
+        body = "(null)";
+      }
+      if (precision >= 0) {
+        end = memchr(body, '\0', precision);
+        body_length = end != NULL ? end - body : precision;
+      } else {
+        body_length = strlen(body);
+      }
+      break;
+    case '%':
+      is_number = 0;
+      body = "%";
+      body_length = 1;
+      break;
+    default:
+      /* Its argument cannot be skipped without knowing its type,
+      and every later one would be read wrong. */
+      assert(0 && "unsupported conversion");
+      is_number = 0;
+      body = spec;
+      body_length = fmt - spec;
+      width = 0;
+      break;
+    }
+    prefix_length = strlen(prefix);
+    zeros = 0;
+    if (is_number) {
+      body = format_digits(digits, value, base, conv == 'X');
+      body_length = digits + sizeof(digits) - body;
+      if (precision == 0 && value == 0) {
+        body_length = 0;
+      }
+      if (precision > body_length) {
+        zeros = precision - body_length;
+      }
+      if (base == 8 && is_alt && zeros == 0
+          && (body_length == 0 || body[0] != '0')) {
+        zeros = 1;
+      }
+      if (is_zero && !is_left && precision < 0
+          && width > prefix_length + body_length) {
+        zeros = width - prefix_length - body_length;
+      }
+    }
+    pad = width - prefix_length - zeros - body_length;
+    if (pad < 0) {
+      pad = 0;
+    }
+    /* Write the whole conversion at once. */
+    sb_grow(sb, pad + prefix_length + zeros + body_length);
+    dst = sb->at + sb->length;
+    if (!is_left) {
+      memset(dst, ' ', pad);
+      dst += pad;
+    }
+    memcpy(dst, prefix, prefix_length);
+    dst += prefix_length;
+    memset(dst, '0', zeros);
+    dst += zeros;
+    memcpy(dst, body, body_length);
+    dst += body_length;
+    if (is_left) {
+      memset(dst, ' ', pad);
+      dst += pad;
+    }
+    sb->length = dst - sb->at;
+  }
+  sb->at[sb->length] = '\0';
+  return sb->length - old_length;
+}
+
+/*----------------------------------------------------------*/
+Strview
+sb_view(Strbuf *sb)
+{
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  /**/
+  return sv_array(sb->at, sb->length);
+}
+
+/*----------------------------------------------------------*/
+void
+sb_vreplace(Strbuf *sb, int64 i, int64 n, const char *fmt, va_list args)
+{
+  char temp[256];
+  char *at = NULL;
+  int64 placed = 0;
+  int64 removed = 0;
+  int64 moved = 0;
+  int64 pos = 0;
+  int64 old_length = 0;
+  /**/
+  assert(sb != NULL);
+  assert(sb->is_inited);
+  assert(n >= 0);
+  /**/
+  pos = i;
+  if (i != sb->length) {
+    pos = normalize_index(i, sb->length);
+  }
+  removed = n;
+  if (removed > sb->length - pos) {
+    removed = sb->length - pos;
+  }
+  /* Format after the end, then move the text into place. */
+  old_length = sb->length;
+  placed = sb_vformat(sb, fmt, args);
+  moved = old_length - pos - removed;
+  if (moved == 0 && removed == 0) {
+    return;
+  }
+  at = sb->at + pos;
+  if (moved == 0) {
+    memmove(at, at + removed, placed);
+  } else if (placed <= (int)sizeof(temp)) {
+    memcpy(temp, at + removed + moved, placed);
+    memmove(at + placed, at + removed, moved);
+    memcpy(at, temp, placed);
+  } else {
+    memmove(at, at + removed, moved + placed);
+    reverse_bytes(at, moved);
+    reverse_bytes(at + moved, placed);
+    reverse_bytes(at, moved + placed);
+  }
+  sb->length = old_length - removed + placed;
+  sb->at[sb->length] = '\0';
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: SOURCE                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+src_load(Source *src, const char *path)
+{
+  struct stat st;
+  void *map = NULL;
+  int fd = -1;
+  int is_ok = 1;
+  int saved_errno = 0;
+  /**/
+  assert(src != NULL);
+  assert(!src->is_inited);
+  assert(path != NULL);
+  /**/
+  if (strcmp(path, "-") == 0) {
+    fd = STDIN_FILENO;
+  } else {
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      return 0;
+    }
+  }
+  if (fstat(fd, &st) != 0) {
+    is_ok = 0;
+  } else if (S_ISDIR(st.st_mode)) {
+    errno = EISDIR;
+    is_ok = 0;
+  }
+  if (is_ok) {
+    src->map = NULL;
+    src->map_size = 0;
+    src->heap = NULL;
+    src->lines = NULL;
+    src->num_lines = 0;
+    src->text = sv_array("", 0);
+    if (S_ISREG(st.st_mode) && st.st_size > 0) {
+      map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (map != MAP_FAILED) {
+        src->map = map;
+        src->map_size = st.st_size;
+        src->text = sv_array(src->map, src->map_size);
+      }
+    }
+    /* Pipes, empty-looking files and failed mappings. */
+    if (src->map == NULL) {
+      is_ok = src_read(src, fd);
+    }
+  }
+  saved_errno = errno;
+  if (fd != STDIN_FILENO) {
+    close(fd);
+  }
+  errno = saved_errno;
+  if (!is_ok) {
+    return 0;
+  }
+  src->device = st.st_dev;
+  src->inode = st.st_ino;
+  src->mtime = st.st_mtime;
+  mem_clear(&src->path, sizeof(src->path));
+  sb_init(&src->path);
+  sb_append_bytes(&src->path, path, strlen(path));
+  src->is_inited = 1;
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+int64 *
+src_index_lines(Source *src)
+{
+  const char *at = NULL;
+  const char *end = NULL;
+  int64 *lines = NULL;
+  int64 *first = NULL;
+  int64 n = 0;
+  int64 i = 0;
+  /**/
+  assert(src != NULL);
+  /**/
+  n = sv_count_char(src->text, '\n') + 1;
+  lines = mem_alloc(mem_size_mul(n, sizeof(int64)));
+  lines[0] = 0;
+  i = 1;
+  at = src->text.at;
+  end = at + src->text.length;
+  while ((at = memchr(at, '\n', end - at)) != NULL) {
+    at++;
+    lines[i++] = at - src->text.at;
+  }
+  assert(i == n);
+  /* Threads may race to index a shared source, the first wins
+  and every one of them stores the same count. */
+  ATOMIC_STORE(&src->num_lines, n);
+  first = NULL;
+  if (!ATOMIC_CAS(&src->lines, &first, lines)) {
+    mem_free(lines);
+    return first;
+  }
+  return lines;
+}
+
+/*----------------------------------------------------------*/
+void
+src_locate(Source *src, int64 offset, int64 *line, int64 *column)
+{
+  const int64 *lines = NULL;
+  int64 low = 0;
+  int64 high = 0;
+  int64 mid = 0;
+  /**/
+  assert(src != NULL);
+  assert(src->is_inited);
+  assert(0 <= offset && offset <= src->text.length);
+  assert(line != NULL);
+  assert(column != NULL);
+  /**/
+  lines = ATOMIC_LOAD(&src->lines);
+  if (lines == NULL) {
+    lines = src_index_lines(src);
+  }
+  /* The last line that starts at or before `offset`. */
+  low = 0;
+  high = ATOMIC_LOAD(&src->num_lines) - 1;
+  while (low < high) {
+    mid = low + (high - low + 1) / 2;
+    if (lines[mid] <= offset) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  *line = low + 1;
+  *column = offset - lines[low] + 1;
+}
+
+/*----------------------------------------------------------*/
+int
+src_read(Source *src, int fd)
+{
+  char *heap = NULL;
+  long got = 0;
+  int64 length = 0;
+  int64 capacity = 0;
+  /**/
+  assert(src != NULL);
+  assert(fd >= 0);
+  /**/
+  capacity = 64 * 1024;
+  heap = mem_alloc(capacity);
+  for (;;) {
+    if (length == capacity) {
+      if (capacity > MEM_SIZE_MAX / 2) {
+        mem_free(heap);
+        errno = EFBIG;
+        return 0;
+      }
+      capacity *= 2;
+      heap = mem_realloc(heap, capacity);
+    }
+    got = read(fd, heap + length, capacity - length);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0) {
+      mem_free(heap);
+      return 0;
+    }
+    if (got == 0) {
+      break;
+    }
+    length += got;
+  }
+  src->heap = heap;
+  src->text = sv_array(src->heap, length);
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+void
+src_unload(Source *src)
+{
+  assert(src != NULL);
+  assert(src->is_inited);
+  /**/
+  if (src->map != NULL) {
+    munmap(src->map, src->map_size);
+  }
+  if (src->heap != NULL) {
+    mem_free(src->heap);
+  }
+  if (src->lines != NULL) {
+    mem_free(src->lines);
+  }
+  sb_deinit(&src->path);
+  mem_clear(src, sizeof(*src));
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: STRING VIEW                              */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+Strview
+sv_array(const char *chars, int64 length)
+{
+  Strview sv;
+  /**/
+  assert(chars != NULL);
+  assert(length >= 0);
+  /**/
+  mem_clear(&sv, sizeof(sv));
+  sv.length = length;
+  sv.at = chars;
+  return sv;
+}
+
+/*----------------------------------------------------------*/
+int
+sv_compare(Strview string, Strview another)
+{
+  if (string.length > another.length) {
+    return 1;
+  }
+  if (string.length < another.length) {
+    return -1;
+  }
+  return memcmp(string.at, another.at, string.length);
+}
+
+/*----------------------------------------------------------*/
+int
+sv_contains_char(Strview string, char ch)
+{
+  const char *ptr = NULL;
+  /**/
+  ptr = memchr(string.at, ch, string.length);
+  return ptr != NULL;
+}
+
+/*----------------------------------------------------------*/
+int
+sv_contains_sv(Strview string, Strview substr)
+{
+  return sv_find_sv(string, substr) >= 0;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_count_char(Strview string, char ch)
+{
+#ifdef UACC_SSE2
+  __m128i chars;
+  __m128i wanted;
+  __m128i sums;
+  __m128i zero;
+  uint64 lanes[2];
+  int64 j = 0;
+#else
+  unsigned long ones = ~0UL / UCHAR_MAX;
+  unsigned long word = 0;
+#endif
+  int64 count = 0;
+  int64 i = 0;
+  /**/
+#ifdef UACC_SSE2
+  /*
+  Matches subtract 1 from the byte counters in `chars`, which
+  are added up by `_mm_sad_epu8` before they can overflow.
+  */
+  wanted = _mm_set1_epi8(ch);
+  zero = _mm_setzero_si128();
+  sums = zero;
+  while (i + 16 <= string.length) {
+    chars = zero;
+    for (j = 0; j < 255 && i + 16 <= string.length; j++, i += 16) {
+      chars = _mm_sub_epi8(chars, _mm_cmpeq_epi8(wanted,
+        _mm_loadu_si128((const __m128i *)(string.at + i))
+      ));
+    }
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(chars, zero));
+  }
+  _mm_storeu_si128((__m128i *)lanes, sums);
+  count = (int64)(lanes[0] + lanes[1]);
+#else
+  /*
+  A zero byte of `word` is a match. The high bit of each byte
+  is set if the byte is not zero, and the product adds them up
+  in the highest byte.
+  */
+  for (; i + (int)sizeof(word) <= string.length; i += sizeof(word)) {
+    memcpy(&word, string.at + i, sizeof(word));
+    word ^= ones * (unsigned char)ch;
+    word = (((word & ~(ones << 7)) + ~(ones << 7)) | word) & ones << 7;
+    count += sizeof(word)
+      - ((word >> 7) * ones >> (sizeof(word) - 1) * CHAR_BIT);
+  }
+#endif
+  for (; i < string.length; i++) {
+    count += string.at[i] == ch;
+  }
+  return count;
+}
+
+/*----------------------------------------------------------*/
+Strview
+sv_cstr(const char *cstr)
+{
+  assert(cstr != NULL);
+  return sv_array(cstr, strlen(cstr));
+}
+
+/*----------------------------------------------------------*/
+Strview
+sv_cut(Strview string, int64 count)
+{
+  assert(count >= 0);
+  /**/
+  if (count > string.length) {
+    count = string.length;
+  }
+  return sv_array(string.at + count, string.length - count);
+}
+
+/*----------------------------------------------------------*/
+Strview
+sv_cut_end(Strview string, int64 count)
+{
+  assert(count >= 0);
+  /**/
+  if (count > string.length) {
+    count = string.length;
+  }
+  return sv_array(string.at, string.length - count);
+}
+
+/*----------------------------------------------------------*/
+int
+sv_equal(Strview string, Strview another)
+{
+  if (string.length != another.length) {
+    return 0;
+  }
+  return memcmp(string.at, another.at, string.length) == 0;
+}
+
+/*----------------------------------------------------------*/
+int
+sv_equal_no_case(Strview string, Strview another)
+{
+  unsigned long word1 = 0;
+  unsigned long word2 = 0;
+  int64 i = 0;
+  /**/
+  if (string.length != another.length) {
+    return 0;
+  }
+  /* A word at a time, most names differ or match exactly. */
+  for (; i + (int)sizeof(word1) <= string.length; i += sizeof(word1)) {
+    memcpy(&word1, string.at + i, sizeof(word1));
+    memcpy(&word2, another.at + i, sizeof(word2));
+    if (word1 != word2
+        && ascii_lower_word(word1) != ascii_lower_word(word2)) {
+      return 0;
+    }
+  }
+  for (; i < string.length; i++) {
+    if (ascii_lower((unsigned char)string.at[i])
+        != ascii_lower((unsigned char)another.at[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_filter(Strview string, int(*filter)(int))
+{
+  int64 i = 0;
+  /**/
+  for (i = 0; i < string.length; i++) {
+    if (!filter(string.at[i])) {
+      return i;
+    }
+  }
+  return string.length;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_filter_end(Strview string, int(*filter)(int))
+{
+  int64 i = 0;
+  int64 maxi = string.length - 1;
+  /**/
+  for (i = maxi; 0 <= i; i--) {
+    if (!filter(string.at[i])) {
+      return maxi - i;
+    }
+  }
+  return string.length;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_filter_not(Strview string, int(*filter)(int))
+{
+  int64 i = 0;
+  /**/
+  for (i = 0; i < string.length; i++) {
+    if (filter(string.at[i])) {
+      return i;
+    }
+  }
+  return string.length;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_filter_not_end(Strview string, int(*filter)(int))
+{
+  int64 i = 0;
+  int64 maxi = string.length - 1;
+  /**/
+  for (i = maxi; 0 <= i; i--) {
+    if (filter(string.at[i])) {
+      return maxi - i;
+    }
+  }
+  return string.length;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_char(Strview string, char ch)
+{
+  const char *ptr = NULL;
+  /**/
+  ptr = memchr(string.at, ch, string.length);
+  if (ptr == NULL) {
+    return -1;
+  }
+  return ptr - string.at;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_char_end(Strview string, char ch)
+{
+#ifdef UACC_SSE2
+  __m128i chars;
+  __m128i wanted;
+  unsigned mask = 0;
+#else
+  unsigned long ones = ~0UL / UCHAR_MAX;
+  unsigned long word = 0;
+#endif
+  int64 i = 0;
+  /**/
+  i = string.length;
+#ifdef UACC_SSE2
+  wanted = _mm_set1_epi8(ch);
+  for (; i >= 16; i -= 16) {
+    chars = _mm_loadu_si128((const __m128i *)(string.at + i - 16));
+    mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, wanted));
+    if (mask != 0) {
+      return i - 16 + highest_bit(mask);
+    }
+  }
+#else
+  /* Skip words without `ch`, a zero byte in `word` is a match. */
+  for (; i >= (int)sizeof(word); i -= sizeof(word)) {
+    memcpy(&word, string.at + i - sizeof(word), sizeof(word));
+    word ^= ones * (unsigned char)ch;
+    if (((word - ones) & ~word & ones << 7) != 0) {
+      break;
+    }
+  }
+#endif
+  for (i--; 0 <= i; i--) {
+    if (string.at[i] == ch) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_horspool(Strview string, Strview substr)
+{
+  const unsigned char *at = NULL;
+  const unsigned char *needle = NULL;
+  int64 shift[UCHAR_MAX + 1];
+  int64 i = 0;
+  int64 maxi = 0;
+  int64 m = 0;
+  unsigned char last = 0;
+  /**/
+  assert(substr.length > 0);
+  assert(substr.length <= string.length);
+  /**/
+  at = (const unsigned char *)string.at;
+  needle = (const unsigned char *)substr.at;
+  m = substr.length;
+  for (i = 0; i <= UCHAR_MAX; i++) {
+    shift[i] = m;
+  }
+  for (i = 0; i < m - 1; i++) {
+    shift[needle[i]] = m - 1 - i;
+  }
+  last = needle[m - 1];
+  maxi = string.length - m;
+  for (i = 0; i <= maxi; i += shift[at[i + m - 1]]) {
+    if (at[i + m - 1] == last && memcmp(at + i, needle, m - 1) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_horspool_end(Strview string, Strview substr)
+{
+  const unsigned char *at = NULL;
+  const unsigned char *needle = NULL;
+  int64 shift[UCHAR_MAX + 1];
+  int64 i = 0;
+  int64 m = 0;
+  unsigned char first = 0;
+  /**/
+  assert(substr.length > 0);
+  assert(substr.length <= string.length);
+  /**/
+  at = (const unsigned char *)string.at;
+  needle = (const unsigned char *)substr.at;
+  m = substr.length;
+  for (i = 0; i <= UCHAR_MAX; i++) {
+    shift[i] = m;
+  }
+  for (i = m - 1; i > 0; i--) {
+    shift[needle[i]] = i;
+  }
+  first = needle[0];
+  for (i = string.length - m; i >= 0; i -= shift[at[i]]) {
+    if (at[i] == first && memcmp(at + i + 1, needle + 1, m - 1) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_sv(Strview string, Strview substr)
+{
+  if (substr.length == 0) {
+    return 0;
+  }
+  if (substr.length > string.length) {
+    return -1;
+  }
+  if (substr.length == 1) {
+    return sv_find_char(string, substr.at[0]);
+  }
+  if (substr.length >= SV_HORSPOOL_MIN) {
+    return sv_find_horspool(string, substr);
+  }
+  return sv_find_wide(string, substr);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_sv_end(Strview string, Strview substr)
+{
+  if (substr.length == 0) {
+    return string.length;
+  }
+  if (substr.length > string.length) {
+    return -1;
+  }
+  if (substr.length == 1) {
+    return sv_find_char_end(string, substr.at[0]);
+  }
+  if (substr.length >= SV_HORSPOOL_MIN) {
+    return sv_find_horspool_end(string, substr);
+  }
+  return sv_find_wide_end(string, substr);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_wide(Strview string, Strview substr)
+{
+#ifdef UACC_SSE2
+  __m128i first;
+  __m128i last;
+  __m128i head;
+  __m128i tail;
+  unsigned mask = 0;
+  int bit = 0;
+#else
+  const char *ptr = NULL;
+#endif
+  const char *at = NULL;
+  int64 i = 0;
+  int64 maxi = 0;
+  int64 m = 0;
+  /**/
+  assert(substr.length >= 2);
+  assert(substr.length <= string.length);
+  /**/
+  at = string.at;
+  m = substr.length;
+  maxi = string.length - m;
+#ifdef UACC_SSE2
+  /* Bit k of `mask` is set if both ends match at `i + k`. */
+  first = _mm_set1_epi8(substr.at[0]);
+  last = _mm_set1_epi8(substr.at[m - 1]);
+  for (i = 0; i + 15 <= maxi; i += 16) {
+    head = _mm_loadu_si128((const __m128i *)(at + i));
+    tail = _mm_loadu_si128((const __m128i *)(at + i + m - 1));
+    mask = _mm_movemask_epi8(_mm_and_si128(
+      _mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)
+    ));
+    while (mask != 0) {
+      bit = lowest_bit(mask);
+      if (memcmp(at + i + bit + 1, substr.at + 1, m - 2) == 0) {
+        return i + bit;
+      }
+      mask &= mask - 1;
+    }
+  }
+  for (; i <= maxi; i++) {
+    if (at[i] == substr.at[0] && at[i + m - 1] == substr.at[m - 1]
+        && memcmp(at + i + 1, substr.at + 1, m - 2) == 0) {
+      return i;
+    }
+  }
+#else
+  /* memchr of the C library is vectorized already. */
+  while (i <= maxi) {
+    ptr = memchr(at + i, substr.at[0], maxi - i + 1);
+    if (ptr == NULL) {
+      break;
+    }
+    i = ptr - at;
+    if (memcmp(ptr + 1, substr.at + 1, m - 1) == 0) {
+      return i;
+    }
+    i++;
+  }
+#endif
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_find_wide_end(Strview string, Strview substr)
+{
+#ifdef UACC_SSE2
+  __m128i first;
+  __m128i last;
+  __m128i head;
+  __m128i tail;
+  unsigned mask = 0;
+  int bit = 0;
+#endif
+  const char *at = NULL;
+  int64 i = 0;
+  int64 m = 0;
+  /**/
+  assert(substr.length >= 2);
+  assert(substr.length <= string.length);
+  /**/
+  at = string.at;
+  m = substr.length;
+  i = string.length - m;
+#ifdef UACC_SSE2
+  /* Blocks of 16 positions `[i, i + 15]` from the end. */
+  first = _mm_set1_epi8(substr.at[0]);
+  last = _mm_set1_epi8(substr.at[m - 1]);
+  for (i -= 15; i >= 0; i -= 16) {
+    head = _mm_loadu_si128((const __m128i *)(at + i));
+    tail = _mm_loadu_si128((const __m128i *)(at + i + m - 1));
+    mask = _mm_movemask_epi8(_mm_and_si128(
+      _mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)
+    ));
+    while (mask != 0) {
+      bit = highest_bit(mask);
+      if (memcmp(at + i + bit + 1, substr.at + 1, m - 2) == 0) {
+        return i + bit;
+      }
+      mask &= ~(1u << bit);
+    }
+  }
+  i += 15;
+#endif
+  for (; i >= 0; i--) {
+    if (at[i] == substr.at[0] && at[i + m - 1] == substr.at[m - 1]
+        && memcmp(at + i + 1, substr.at + 1, m - 2) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+Strview
+sv_get(Strview string, int64 count)
+{
+  assert(count >= 0);
+  /**/
+  if (count > string.length) {
+    count = string.length;
+  }
+  return sv_array(string.at, count);
+}
+
+/*----------------------------------------------------------*/
+Strview
+sv_get_end(Strview string, int64 count)
+{
+  assert(count >= 0);
+  /**/
+  if (count > string.length) {
+    count = string.length;
+  }
+  return sv_array(string.at + string.length - count, count);
+}
+
+/*----------------------------------------------------------*/
+unsigned long
+sv_hash(Strview string)
+{
+  unsigned long hash = 0;
+  unsigned long word = 0;
+  int half = sizeof(hash) * CHAR_BIT / 2;
+  int64 i = 0;
+  /**/
+  hash = string.length * 0x9E3779B1UL;
+  for (; i + (int64)sizeof(word) <= string.length; i += sizeof(word)) {
+    memcpy(&word, string.at + i, sizeof(word));
+    hash = (hash ^ word) * 0x9E3779B1UL;
+    hash ^= hash >> half;
+  }
+  if (i < string.length) {
+    word = 0;
+    memcpy(&word, string.at + i, string.length - i);
+    hash = (hash ^ word) * 0x9E3779B1UL;
+    hash ^= hash >> half;
+  }
+  hash *= 0x85EBCA6BUL;
+  hash ^= hash >> half;
+  return hash;
+}
 
 /*----------------------------------------------------------*/
-/* STATIC FUNCTIONS: STRING BUFFER                          */
-/*----------------------------------------------------------*/
+int
+sv_prefix(Strview string, Strview prefix)
+{
+  if (string.length < prefix.length) {
+    return 0;
+  }
+  return memcmp(string.at, prefix.at, prefix.length) == 0;
+}
 
-/*
-Replace `n` characters in `sb` at `i` with a formated string.
-Negative values of `i` are used as a reverse index.
-If `i` equals `sb->length` then this function appends
-the fromated string.
-`args1` and `args2` are two equal va_lists.
-*/
-static void
-sb_vreplace(Strbuf *sb, int i, int n,
-            const char *fmt, va_list args1, va_list args2);
+/*----------------------------------------------------------*/
+int64
+sv_span(Strview string, Strview sample)
+{
+  return sv_span_sample(string, sample, 1);
+}
 
 /*----------------------------------------------------------*/
-/* IMPLEMENTATION: MEMORY                                   */
+int64
+sv_span_class(Strview string, int classes)
+{
+  return sv_span_class_in(string, classes, 1);
+}
+
 /*----------------------------------------------------------*/
+int64
+sv_span_class_end(Strview string, int classes)
+{
+  return sv_span_class_in_end(string, classes, 1);
+}
 
 /*----------------------------------------------------------*/
-void *
-mem_alloc(int size)
+int64
+sv_span_class_in(Strview string, int classes, int in)
 {
-  void *ptr = NULL;
+  const unsigned char *at = NULL;
+  int64 i = 0;
   /**/
-  assert(size > 0);
+  assert(in == 0 || in == 1);
   /**/
-  ptr = malloc(size);
-  if (ptr == NULL) {
-    fprintf(stderr, "%s",
-      "uacc: error: sorry, not enough memory\n"
-    );
-    exit(EXIT_FAILURE);
+  at = (const unsigned char *)string.at;
+  for (i = 0; i < string.length; i++) {
+    if (((char_classes[at[i]] & classes) != 0) != in) {
+      return i;
+    }
   }
-  return ptr;
+  return string.length;
 }
 
 /*----------------------------------------------------------*/
-void *
-mem_alloc_zeros(int size)
+int64
+sv_span_class_in_end(Strview string, int classes, int in)
 {
-  void *ptr = NULL;
+  const unsigned char *at = NULL;
+  int64 i = 0;
   /**/
-  assert(size > 0);
+  assert(in == 0 || in == 1);
   /**/
-  ptr = mem_alloc(size);
-  mem_clear(ptr, size);
-  return ptr;
+  at = (const unsigned char *)string.at;
+  for (i = string.length; i > 0; i--) {
+    if (((char_classes[at[i - 1]] & classes) != 0) != in) {
+      return string.length - i;
+    }
+  }
+  return string.length;
 }
 
 /*----------------------------------------------------------*/
-void
-mem_clear(void *ptr, int size)
+int64
+sv_span_end(Strview string, Strview sample)
 {
-  assert(size > 0);
+  return sv_span_sample_end(string, sample, 1);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_in(Strview string, const Charset *cs, int in)
+{
+  const char *at = NULL;
+  int64 i = 0;
+#ifdef UACC_SSE2
+  unsigned mask = 0;
+#endif
   /**/
-  memset(ptr, 0, size);
+  assert(cs != NULL);
+  assert(in == 0 || in == 1);
+  /**/
+  at = string.at;
+#ifdef UACC_SSE2
+  if (cs->count >= 1 && cs->count <= CHARSET_FEW) {
+    for (; i + 16 <= string.length; i += 16) {
+      mask = cs_match_wide(cs, at + i);
+      if (in) {
+        mask = ~mask & 0xFFFFu;
+      }
+      if (mask != 0) {
+        return i + lowest_bit(mask);
+      }
+    }
+  }
+#endif
+  for (; i < string.length; i++) {
+    if (cs->has[(unsigned char)at[i]] != in) {
+      return i;
+    }
+  }
+  return string.length;
 }
 
 /*----------------------------------------------------------*/
-void
-mem_free(void *ptr)
+int64
+sv_span_in_end(Strview string, const Charset *cs, int in)
 {
-  assert(ptr != NULL);
+  const char *at = NULL;
+  int64 i = 0;
+#ifdef UACC_SSE2
+  unsigned mask = 0;
+#endif
   /**/
-  free(ptr);
+  assert(cs != NULL);
+  assert(in == 0 || in == 1);
+  /**/
+  at = string.at;
+  i = string.length;
+#ifdef UACC_SSE2
+  if (cs->count >= 1 && cs->count <= CHARSET_FEW) {
+    for (; i >= 16; i -= 16) {
+      mask = cs_match_wide(cs, at + i - 16);
+      if (in) {
+        mask = ~mask & 0xFFFFu;
+      }
+      if (mask != 0) {
+        return string.length - (i - 16 + highest_bit(mask)) - 1;
+      }
+    }
+  }
+#endif
+  for (; i > 0; i--) {
+    if (cs->has[(unsigned char)at[i - 1]] != in) {
+      return string.length - i;
+    }
+  }
+  return string.length;
 }
 
 /*----------------------------------------------------------*/
-void *
-mem_realloc(void *ptr, int size)
+int64
+sv_span_not(Strview string, Strview sample)
 {
-  void *new_ptr = NULL;
+  return sv_span_sample(string, sample, 0);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_not_class(Strview string, int classes)
+{
+  return sv_span_class_in(string, classes, 0);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_not_class_end(Strview string, int classes)
+{
+  return sv_span_class_in_end(string, classes, 0);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_not_end(Strview string, Strview sample)
+{
+  return sv_span_sample_end(string, sample, 0);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_not_set(Strview string, const Charset *cs)
+{
+  return sv_span_in(string, cs, 0);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_not_set_end(Strview string, const Charset *cs)
+{
+  return sv_span_in_end(string, cs, 0);
+}
+
+/*----------------------------------------------------------*/
+int64
+sv_span_sample(Strview string, Strview sample, int in)
+{
+  Charset cs;
+  int64 i = 0;
+  int64 maxi = 0;
   /**/
-  assert(ptr != NULL);
-  assert(size > 0);
+  assert(in == 0 || in == 1);
   /**/
-  new_ptr = realloc(ptr, size);
-  if (new_ptr == NULL) {
-    fprintf(stderr, "%s",
-      "uacc: error: sorry, not enough memory\n"
-    );
-    exit(EXIT_FAILURE);
+  maxi = string.length;
+  if (maxi > SV_SPAN_SHORT) {
+    maxi = SV_SPAN_SHORT;
   }
-  return new_ptr;
+  for (i = 0; i < maxi; i++) {
+    if ((memchr(sample.at, string.at[i], sample.length) != NULL) != in) {
+      return i;
+    }
+  }
+  if (i == string.length) {
+    return i;
+  }
+  cs_init(&cs, sample);
+  return i + sv_span_in(sv_cut(string, i), &cs, in);
 }
 
 /*----------------------------------------------------------*/
-void *
-mem_realloc_zeros(void *ptr, int size, int old_size)
+int64
+sv_span_sample_end(Strview string, Strview sample, int in)
 {
-  void *new_ptr = NULL;
-  int num_new_bytes = 0;
+  Charset cs;
+  int64 i = 0;
+  int64 maxi = 0;
   /**/
-  assert(ptr != NULL);
-  assert(size > 0);
-  assert(old_size > 0);
+  assert(in == 0 || in == 1);
   /**/
-  if (size <= old_size) {
-    return ptr;
+  maxi = string.length;
+  if (maxi > SV_SPAN_SHORT) {
+    maxi = SV_SPAN_SHORT;
   }
-  num_new_bytes = size - old_size;
-  new_ptr = mem_realloc(ptr, size);
-  mem_clear((char *)new_ptr + old_size, num_new_bytes);
-  return new_ptr;
+  for (i = 0; i < maxi; i++) {
+    if ((memchr(sample.at, string.at[string.length - 1 - i],
+                sample.length) != NULL) != in) {
+      return i;
+    }
+  }
+  if (i == string.length) {
+    return i;
+  }
+  cs_init(&cs, sample);
+  return i + sv_span_in_end(sv_cut_end(string, i), &cs, in);
 }
 
 /*----------------------------------------------------------*/
-/* IMPLEMENTATION: STRING BUFFER                            */
+int64
+sv_span_set(Strview string, const Charset *cs)
+{
+  return sv_span_in(string, cs, 1);
+}
+
 /*----------------------------------------------------------*/
+int64
+sv_span_set_end(Strview string, const Charset *cs)
+{
+  return sv_span_in_end(string, cs, 1);
+}
 
 /*----------------------------------------------------------*/
-void
-sb_append(Strbuf *sb, const char *fmt, ...)
+Strview
+sv_substr(Strview string, int64 start, int64 length)
 {
-  va_list args1;
-  va_list args2;
-  /**/
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(start >= 0);
+  assert(start < string.length);
+  assert(length >= 0);
   /**/
-  va_start(args1, fmt);
-  va_start(args2, fmt);
-  sb_vreplace(sb, sb->length, 0, fmt, args1, args2);
-  va_end(args1);
-  va_end(args2);
+  return sv_array(string.at + start, length);
 }
 
 /*----------------------------------------------------------*/
-char *
-sb_at(Strbuf *sb, int i)
+int
+sv_suffix(Strview string, Strview suffix)
 {
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  const char *part = NULL;
   /**/
-  if (sb->length == 0) {
-    return sb->at;
+  if (string.length < suffix.length) {
+    return 0;
   }
-  i = normalize_index(i, sb->length);
-  return &sb->at[i];
+  part = string.at + string.length - suffix.length;
+  return memcmp(part, suffix.at, suffix.length) == 0;
 }
 
 /*----------------------------------------------------------*/
-void
-sb_clear(Strbuf *sb)
+/* IMPLEMENTATION: VECTOR                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void *
+vec_at(Vector *vec, int64 i)
 {
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(vec != NULL);
+  assert(vec->is_inited);
+  assert(vec->length > 0);
   /**/
-  sb->length = 0;
-  mem_clear(sb->at, sb->capacity);
+  i = normalize_index(i, vec->length);
+  return vec->at + i * vec->item_size;
 }
 
 /*----------------------------------------------------------*/
 void
-sb_copy(Strbuf *sb, const char *fmt, ...)
+vec_clear(Vector *vec)
 {
-  va_list args1;
-  va_list args2;
-  /**/
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(vec != NULL);
+  assert(vec->is_inited);
   /**/
-  va_start(args1, fmt);
-  va_start(args2, fmt);
-  sb_vreplace(sb, 0, sb->length, fmt, args1, args2);
-  va_end(args1);
-  va_end(args2);
+  vec->length = 0;
 }
 
 /*----------------------------------------------------------*/
 void
-sb_deinit(Strbuf *sb)
+vec_deinit(Vector *vec)
 {
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(vec != NULL);
+  assert(vec->is_inited);
   /**/
-  mem_free(sb->at);
-  mem_clear(sb, sizeof(*sb));
+  if (vec->at != NULL) {
+    mem_free(vec->at);
+  }
+  mem_clear(vec, sizeof(*vec));
 }
 
 /*----------------------------------------------------------*/
 void
-sb_init(Strbuf *sb)
+vec_init(Vector *vec, int64 item_size, int flags)
 {
-  assert(sb != NULL);
-  assert(!sb->is_inited);
+  assert(vec != NULL);
+  assert(!vec->is_inited);
+  assert(item_size > 0);
   /**/
-  sb->length = 0;
-  sb->capacity = 16;
-  sb->at = mem_alloc_zeros(sb->capacity);
-  sb->is_inited = 1;
+  vec->at = NULL;
+  vec->length = 0;
+  vec->capacity = 0;
+  vec->item_size = item_size;
+  vec->flags = flags;
+  vec->is_inited = 1;
 }
 
 /*----------------------------------------------------------*/
-void
-sb_insert(Strbuf *sb, int i, const char *fmt, ...)
+void *
+vec_insert(Vector *vec, int64 i, const void *items, int64 n)
 {
-  va_list args1;
-  va_list args2;
+  char *at = NULL;
+  int64 size = 0;
+  int64 need = 0;
   /**/
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(vec != NULL);
+  assert(vec->is_inited);
+  assert(n >= 0);
   /**/
-  va_start(args1, fmt);
-  va_start(args2, fmt);
-  sb_vreplace(sb, i, 0, fmt, args1, args2);
-  va_end(args1);
-  va_end(args2);
+  if (i != vec->length) {
+    i = normalize_index(i, vec->length);
+  }
+  need = mem_size_add(vec->length, n);
+  if (need > vec->capacity) {
+    if (vec->flags & VEC_EXACT) {
+      vec_reserve(vec, need);
+    } else {
+      /* Double like `Strbuf`, but start from a few items. */
+      vec_reserve(vec, mem_size_add(mem_size_mul(need, 2), 4));
+    }
+  }
+  at = vec->at + i * vec->item_size;
+  size = n * vec->item_size;
+  if (i < vec->length) {
+    memmove(at + size, at, (vec->length - i) * vec->item_size);
+  }
+  if (items != NULL) {
+    memcpy(at, items, size);
+  } else if ((vec->flags & VEC_ZEROS) && size > 0) {
+    mem_clear(at, size);
+  }
+  vec->length += n;
+  return at;
 }
 
 /*----------------------------------------------------------*/
-void
-sb_remove(Strbuf *sb, int i, int n)
+void *
+vec_pop(Vector *vec)
 {
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(vec != NULL);
+  assert(vec->is_inited);
+  assert(vec->length > 0);
   /**/
-  sb_replace(sb, i, n, "");
+  vec->length--;
+  return vec->at + vec->length * vec->item_size;
 }
 
 /*----------------------------------------------------------*/
-void
-sb_replace(Strbuf *sb, int i, int n, const char *fmt, ...)
+void *
+vec_push(Vector *vec, const void *item)
 {
-  va_list args1;
-  va_list args2;
+  char *at = NULL;
   /**/
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  assert(vec != NULL);
+  assert(vec->is_inited);
   /**/
-  va_start(args1, fmt);
-  va_start(args2, fmt);
-  sb_vreplace(sb, i, n, fmt, args1, args2);
-  va_end(args1);
-  va_end(args2);
+  if (vec->length == vec->capacity) {
+    return vec_insert(vec, vec->length, item, 1);
+  }
+  at = vec->at + vec->length * vec->item_size;
+  if (item != NULL) {
+    memcpy(at, item, vec->item_size);
+  } else if (vec->flags & VEC_ZEROS) {
+    mem_clear(at, vec->item_size);
+  }
+  vec->length++;
+  return at;
 }
 
 /*----------------------------------------------------------*/
 void
-sb_reserve(Strbuf *sb, int cap)
+vec_remove(Vector *vec, int64 i, int64 n)
 {
-  assert(sb != NULL);
-  assert(sb->is_inited);
+  char *at = NULL;
   /**/
-  if (cap <= sb->capacity) {
+  assert(vec != NULL);
+  assert(vec->is_inited);
+  assert(n >= 0);
+  /**/
+  if (vec->length == 0) {
     return;
   }
-  sb->at = mem_realloc_zeros(sb->at, cap, sb->capacity);
-  sb->capacity = cap;
+  i = normalize_index(i, vec->length);
+  if (n > vec->length - i) {
+    n = vec->length - i;
+  }
+  at = vec->at + i * vec->item_size;
+  memmove(at, at + n * vec->item_size,
+    (vec->length - i - n) * vec->item_size
+  );
+  vec->length -= n;
 }
 
 /*----------------------------------------------------------*/
 void
-sb_vreplace(Strbuf *sb, int i, int n,
-            const char *fmt, va_list args1, va_list args2)
+vec_reserve(Vector *vec, int64 cap)
 {
-  char *src = NULL;
-  char *dst = NULL;
-  int placed = 0;
-  int removed = 0;
-  int moved = 0;
-  int pos = 0;
-  int new_length = 0;
-  int new_size = 0;
-  char temp_char = 0;
+  int64 size = 0;
   /**/
-  assert(sb != NULL);
-  assert(sb->is_inited);
-  assert(n >= 0);
+  assert(vec != NULL);
+  assert(vec->is_inited);
   /**/
-  pos = i;
-  if (i != sb->length) {
-    pos = normalize_index(i, sb->length);
-  }
-  removed = n;
-  if (removed > sb->length) {
-    removed = sb->length;
+  if (cap <= vec->capacity) {
+    return;
   }
-  placed = vfprintf(G->fnull, fmt, args1);
-  new_length = sb->length - removed + placed;
-  new_size = new_length + 1;
-  if (new_size > sb->capacity) {
-    sb_reserve(sb, new_size * 2);
+  size = mem_size_mul(cap, vec->item_size);
+  if (vec->at == NULL) {
+    vec->at = mem_alloc_for(MEM_KIND_VECTOR, size);
+  } else {
+    vec->at = mem_realloc(vec->at, size);
   }
+  vec->capacity = cap;
+}
+
+/*----------------------------------------------------------*/
+void
+vec_shrink(Vector *vec)
+{
+  assert(vec != NULL);
+  assert(vec->is_inited);
   /**/
-  moved = sb->length - pos - removed;
-  if (moved > 0) {
-    src = sb->at + pos + removed;
-    dst = sb->at + pos + placed;
-    memmove(dst, src, moved);
+  if (vec->capacity == vec->length) {
+    return;
   }
-  if (placed != 0) {
-    temp_char = sb->at[pos + placed];
-    vsprintf(sb->at + pos, fmt, args2);
-    sb->at[pos + placed] = temp_char;
+  if (vec->length == 0) {
+    mem_free(vec->at);
+    vec->at = NULL;
+  } else {
+    vec->at = mem_realloc(vec->at, vec->length * vec->item_size);
   }
-  /**/
-  sb->length = new_length;
-  sb->at[sb->length] = '\0';
+  vec->capacity = vec->length;
 }
 
 /*----------------------------------------------------------*/
-/* IMPLEMENTATION: STRING VIEW                              */
+/* IMPLEMENTATION: LOCK                                     */
 /*----------------------------------------------------------*/
 
 /*----------------------------------------------------------*/
-Strview
-sv_array(const char *chars, int length)
+void
+lock_acquire(Lock *lock)
 {
-  Strview sv;
+  assert(lock != NULL);
+  assert(lock->is_inited);
   /**/
-  assert(chars != NULL);
-  assert(length >= 0);
+#ifndef UACC_NO_THREADS
+  pthread_mutex_lock(&lock->mutex);
+#endif
+}
+
+/*----------------------------------------------------------*/
+void
+lock_deinit(Lock *lock)
+{
+  assert(lock != NULL);
+  assert(lock->is_inited);
   /**/
-  mem_clear(&sv, sizeof(sv));
-  sv.length = length;
-  sv.at = chars;
-  return sv;
+#ifndef UACC_NO_THREADS
+  pthread_mutex_destroy(&lock->mutex);
+#endif
+  mem_clear(lock, sizeof(*lock));
+}
+
+/*----------------------------------------------------------*/
+void
+lock_init(Lock *lock)
+{
+  assert(lock != NULL);
+  assert(!lock->is_inited);
+  /**/
+#ifndef UACC_NO_THREADS
+  if (pthread_mutex_init(&lock->mutex, NULL) != 0) {
+    fprintf(stderr, "%s", "uacc: error: cannot make a lock\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+  lock->is_inited = 1;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_compare(Strview string, Strview another)
+void
+lock_release(Lock *lock)
 {
-  if (string.length > another.length) {
-    return 1;
-  }
-  if (string.length < another.length) {
-    return -1;
-  }
-  return memcmp(string.at, another.at, string.length);
+  assert(lock != NULL);
+  assert(lock->is_inited);
+  /**/
+#ifndef UACC_NO_THREADS
+  pthread_mutex_unlock(&lock->mutex);
+#endif
 }
 
 /*----------------------------------------------------------*/
-int
-sv_contains_char(Strview string, char ch)
+/* IMPLEMENTATION: TIME                                     */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+double
+time_now(void)
 {
-  const char *ptr = NULL;
+  struct timeval tv;
   /**/
-  ptr = memchr(string.at, ch, string.length);
-  return ptr != NULL;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_contains_sv(Strview string, Strview substr)
+void
+time_print_stats(FILE *file)
 {
-  const char *part = NULL;
+  static const char *names[PHASE_COUNT] = {
+    "load", "lex", "pp", "parse"
+  };
+  PhaseStats *stats = NULL;
+  double mb_per_s = 0;
   int i = 0;
-  int maxi = 0;
   /**/
-  maxi = string.length - substr.length;
-  for (i = 0; i <= maxi; i++) {
-    part = string.at + i;
-    if (memcmp(part, substr.at, substr.length) == 0) {
-      return 1;
+  assert(file != NULL);
+  /**/
+  fprintf(file, "%s", "      TIME\n");
+  fprintf(file, "%-8s %10s %12s %10s %12s\n",
+    "phase", "seconds", "bytes", "MB/s", "items"
+  );
+  for (i = 0; i < PHASE_COUNT; i++) {
+    stats = &G->phase_stats[i];
+    mb_per_s = 0;
+    if (stats->seconds > 0) {
+      mb_per_s = stats->bytes / stats->seconds / 1e6;
     }
+    fprintf(file, "%-8s %10.4f %12ld %10.1f %12ld\n",
+      names[i], stats->seconds, stats->bytes, mb_per_s, stats->items
+    );
   }
-  return 0;
 }
 
 /*----------------------------------------------------------*/
-Strview
-sv_cstr(const char *cstr)
-{
-  assert(cstr != NULL);
-  return sv_array(cstr, strlen(cstr));
-}
+/* IMPLEMENTATION: WRITER                                   */
+/*----------------------------------------------------------*/
 
 /*----------------------------------------------------------*/
-Strview
-sv_cut(Strview string, int count)
+void
+wr_char(Writer *w, char ch)
 {
-  assert(count >= 0);
+  assert(w != NULL);
+  assert(w->is_inited);
   /**/
-  if (count > string.length) {
-    count = string.length;
+  if (w->length == w->capacity) {
+    wr_make_room(w);
   }
-  return sv_array(string.at + count, string.length - count);
+  w->at[w->length++] = ch;
 }
 
 /*----------------------------------------------------------*/
-Strview
-sv_cut_end(Strview string, int count)
+void
+wr_deinit(Writer *w)
 {
-  assert(count >= 0);
+  assert(w != NULL);
+  assert(w->is_inited);
   /**/
-  if (count > string.length) {
-    count = string.length;
-  }
-  return sv_array(string.at, string.length - count);
+  mem_free(w->at);
+  mem_clear(w, sizeof(*w));
 }
 
 /*----------------------------------------------------------*/
 int
-sv_equal(Strview string, Strview another)
+wr_flush(Writer *w)
 {
-  if (string.length != another.length) {
-    return 0;
+  int64 done = 0;
+  long n = 0;
+  /**/
+  assert(w != NULL);
+  assert(w->is_inited);
+  /**/
+  if (w->fd < 0) {
+    return 1;
   }
-  return memcmp(string.at, another.at, string.length) == 0;
+  while (done < w->length && w->error == 0) {
+    n = write(w->fd, w->at + done, w->length - done);
+    if (n < 0 && errno != EINTR) {
+      w->error = errno;
+    } else if (n > 0) {
+      done += n;
+    }
+  }
+  w->length = 0;
+  return w->error == 0;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_equal_no_case(Strview string, Strview another)
+void
+wr_init(Writer *w, int fd)
 {
-  int i = 0;
+  assert(w != NULL);
+  assert(!w->is_inited);
+  assert(fd >= -1);
   /**/
-  if (string.length != another.length) {
-    return 0;
-  }
-  for (i = 0; i < string.length; i++) {
-    if (toupper(string.at[i]) != toupper(another.at[i])) {
-      return 0;
-    }
+  w->fd = fd;
+  w->capacity = WRITER_SIZE;
+  w->at = mem_alloc(w->capacity);
+  w->length = 0;
+  w->error = 0;
+  w->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+void
+wr_make_room(Writer *w)
+{
+  if (w->fd >= 0) {
+    wr_flush(w);
+    return;
   }
-  return 1;
+  w->capacity = mem_size_mul(w->capacity, 2);
+  w->at = mem_realloc(w->at, w->capacity);
 }
 
 /*----------------------------------------------------------*/
 int
-sv_filter(Strview string, int(*filter)(int))
+wr_save(const char *path, const char *at, int64 n)
 {
-  int i = 0;
+  Writer w;
+  Strbuf temp;
+  long number = 0;
+  int error = 0;
+  int fd = -1;
   /**/
-  for (i = 0; i < string.length; i++) {
-    if (!filter(string.at[i])) {
-      return i;
+  assert(path != NULL);
+  assert(at != NULL || n == 0);
+  assert(n >= 0);
+  /**/
+  mem_clear(&w, sizeof(w));
+  mem_clear(&temp, sizeof(temp));
+  sb_init(&temp);
+  /* A file of a crashed run may have the name, so take the next
+  one. Whoever renames last wins, both files are whole. */
+  do {
+    number = ATOMIC_LOAD(&save_number);
+    while (!ATOMIC_CAS(&save_number, &number, number + 1)) {
+    }
+    sb_clear(&temp);
+    sb_append(&temp, "%s.%ld.%ld.tmp", path, (long)getpid(), number);
+    fd = open(temp.at, O_WRONLY | O_CREAT | O_EXCL, 0666);
+  } while (fd < 0 && errno == EEXIST);
+  if (fd < 0) {
+    error = errno;
+  } else {
+    wr_init(&w, fd);
+    wr_write(&w, at, n);
+    if (!wr_flush(&w)) {
+      error = w.error;
+    }
+    wr_deinit(&w);
+    if (close(fd) != 0 && error == 0) {
+      error = errno;
+    }
+    if (error == 0 && rename(temp.at, path) != 0) {
+      error = errno;
+    }
+    if (error != 0) {
+      remove(temp.at);
     }
   }
-  return string.length;
+  sb_deinit(&temp);
+  errno = error;
+  return error == 0;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_filter_end(Strview string, int(*filter)(int))
+void
+wr_write(Writer *w, const char *at, int64 n)
 {
-  int i = 0;
-  int maxi = string.length - 1;
+  int64 count = 0;
   /**/
-  for (i = maxi; 0 <= i; i--) {
-    if (!filter(string.at[i])) {
-      return maxi - i;
+  assert(w != NULL);
+  assert(w->is_inited);
+  assert(n >= 0);
+  /**/
+  while (n > 0) {
+    if (w->length == w->capacity) {
+      wr_make_room(w);
+    }
+    count = w->capacity - w->length;
+    if (count > n) {
+      count = n;
     }
+    memcpy(w->at + w->length, at, count);
+    w->length += count;
+    at += count;
+    n -= count;
   }
-  return string.length;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_filter_not(Strview string, int(*filter)(int))
+/* IMPLEMENTATION: DIGEST                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+dg_add(Digest *dg, const void *at, int64 n)
 {
-  int i = 0;
+  const unsigned char *bytes = at;
+  uint64 a = 0;
+  uint64 b = 0;
+  int64 i = 0;
   /**/
-  for (i = 0; i < string.length; i++) {
-    if (filter(string.at[i])) {
-      return i;
-    }
+  assert(dg != NULL);
+  assert(at != NULL || n == 0);
+  assert(n >= 0);
+  /**/
+  /* FNV-1a in one half, a multiplicative mix in the other. */
+  a = dg->a;
+  b = dg->b;
+  for (i = 0; i < n; i++) {
+    a = (a ^ bytes[i]) * 0x100000001B3UL;
+    b = (b + bytes[i] + 1) * 0x9E3779B97F4A7C15UL;
+    b ^= b >> 32;
   }
-  return string.length;
+  dg->a = a;
+  dg->b = b;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_filter_not_end(Strview string, int(*filter)(int))
+void
+dg_add_int(Digest *dg, int64 value)
 {
+  unsigned char bytes[8];
+  uint64 bits = value;
   int i = 0;
-  int maxi = string.length - 1;
   /**/
-  for (i = maxi; 0 <= i; i--) {
-    if (filter(string.at[i])) {
-      return maxi - i;
-    }
+  assert(dg != NULL);
+  /**/
+  for (i = 0; i < 8; i++) {
+    bytes[i] = (unsigned char)(bits >> i * 8);
   }
-  return string.length;
+  dg_add(dg, bytes, sizeof(bytes));
 }
 
 /*----------------------------------------------------------*/
-int
-sv_find_char(Strview string, char ch)
+void
+dg_init(Digest *dg)
 {
-  const char *ptr = NULL;
+  assert(dg != NULL);
   /**/
-  ptr = memchr(string.at, ch, string.length);
-  if (ptr == NULL) {
-    return -1;
-  }
-  return ptr - string.at;
+  dg->a = 0xCBF29CE484222325UL;
+  dg->b = 0x2545F4914F6CDD1DUL;
 }
 
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: DISK CACHE                               */
+/*----------------------------------------------------------*/
+
 /*----------------------------------------------------------*/
 int
-sv_find_char_end(Strview string, char ch)
+dc_compare(const void *a, const void *b)
 {
-  int i = 0;
+  const DiskEntry *x = a;
+  const DiskEntry *y = b;
   /**/
-  for (i = string.length - 1; 0 <= i; i--) {
-    if (string.at[i] == ch) {
-      return i;
-    }
+  if (x->mtime != y->mtime) {
+    return x->mtime < y->mtime ? -1 : 1;
   }
-  return -1;
+  return 0;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_find_sv(Strview string, Strview substr)
+void
+dc_deinit(DiskCache *dc)
 {
-  const char *part = NULL;
-  int i = 0;
-  int maxi = 0;
+  assert(dc != NULL);
+  assert(dc->is_inited);
   /**/
-  maxi = string.length - substr.length;
-  for (i = 0; i <= maxi; i++) {
-    part = string.at + i;
-    if (memcmp(part, substr.at, substr.length) == 0) {
-      return i;
-    }
-  }
-  return -1;
+  sb_deinit(&dc->dir);
+  mem_clear(dc, sizeof(*dc));
 }
 
 /*----------------------------------------------------------*/
 int
-sv_find_sv_end(Strview string, Strview substr)
+dc_get(DiskCache *dc, const Digest *key, Strbuf *value)
 {
-  const char *part = NULL;
-  int i = 0;
-  int maxi = 0;
+  Source src;
+  Strbuf path;
+  int is_hit = 0;
   /**/
-  maxi = string.length - substr.length;
-  for (i = maxi; 0 <= i; i--) {
-    part = string.at + i;
-    if (memcmp(part, substr.at, substr.length) == 0) {
-      return i;
+  assert(dc != NULL);
+  assert(dc->is_inited);
+  assert(key != NULL);
+  assert(value != NULL);
+  /**/
+  mem_clear(&src, sizeof(src));
+  mem_clear(&path, sizeof(path));
+  sb_init(&path);
+  dc_path(dc, key, &path);
+  if (src_load(&src, path.at)) {
+    if (src.text.length >= DC_MAGIC_LENGTH
+        && memcmp(src.text.at, DC_MAGIC, DC_MAGIC_LENGTH) == 0) {
+      sb_append_bytes(value, src.text.at + DC_MAGIC_LENGTH,
+        src.text.length - DC_MAGIC_LENGTH
+      );
+      /* The time of an entry is its last use. */
+      utime(path.at, NULL);
+      is_hit = 1;
     }
+    src_unload(&src);
   }
-  return -1;
+  if (is_hit) {
+    G->cache_stats.num_hits++;
+  } else {
+    G->cache_stats.num_misses++;
+  }
+  sb_deinit(&path);
+  return is_hit;
 }
 
 /*----------------------------------------------------------*/
-Strview
-sv_get(Strview string, int count)
+int
+dc_init(DiskCache *dc, const char *dir, int64 max_size)
 {
-  assert(count >= 0);
+  struct stat st;
+  int64 i = 0;
+  int error = 0;
   /**/
-  if (count > string.length) {
-    count = string.length;
+  assert(dc != NULL);
+  assert(!dc->is_inited);
+  assert(dir != NULL);
+  assert(max_size >= 0);
+  /**/
+  sb_init(&dc->dir);
+  sb_append(&dc->dir, "%s", dir);
+  while (dc->dir.length > 1 && dc->dir.at[dc->dir.length - 1] == '/') {
+    sb_remove(&dc->dir, dc->dir.length - 1, 1);
   }
-  return sv_array(string.at, count);
+  /* Make the missing parents first, like `mkdir -p`. */
+  for (i = 1; i < dc->dir.length; i++) {
+    if (dc->dir.at[i] == '/') {
+      dc->dir.at[i] = '\0';
+      mkdir(dc->dir.at, 0777);
+      dc->dir.at[i] = '/';
+    }
+  }
+  if (mkdir(dc->dir.at, 0777) != 0 && errno != EEXIST) {
+    error = errno;
+  } else if (stat(dc->dir.at, &st) != 0) {
+    error = errno;
+  } else if (!S_ISDIR(st.st_mode)) {
+    error = ENOTDIR;
+  }
+  if (error != 0) {
+    sb_deinit(&dc->dir);
+    errno = error;
+    return 0;
+  }
+  dc->max_size = max_size;
+  dc->is_inited = 1;
+  return 1;
 }
 
 /*----------------------------------------------------------*/
-Strview
-sv_get_end(Strview string, int count)
+void
+dc_path(DiskCache *dc, const Digest *key, Strbuf *path)
 {
-  assert(count >= 0);
-  /**/
-  if (count > string.length) {
-    count = string.length;
-  }
-  return sv_array(string.at + string.length - count, count);
+  sb_append(path, "%s/%02lx/%014lx%016lx", dc->dir.at,
+    key->a >> 56, key->a & 0xFFFFFFFFFFFFFFUL, key->b
+  );
 }
 
 /*----------------------------------------------------------*/
-int
-sv_prefix(Strview string, Strview prefix)
+void
+dc_print_stats(FILE *file)
 {
-  if (string.length < prefix.length) {
-    return 0;
+  CacheStats *stats = NULL;
+  /**/
+  assert(file != NULL);
+  /**/
+  stats = &G->cache_stats;
+  fprintf(file, "%s", "      DISK CACHE\n");
+  fprintf(file, "%-20s %12ld\n", "hits", stats->num_hits);
+  fprintf(file, "%-20s %12ld\n", "misses", stats->num_misses);
+  fprintf(file, "%-20s %12ld\n", "stores", stats->num_stores);
+  fprintf(file, "%-20s %12ld\n", "evictions", stats->num_evictions);
+  fprintf(file, "%-20s %12ld\n", "  bytes", stats->evicted_bytes);
+  if (stats->is_trimmed) {
+    fprintf(file, "%-20s %12ld\n", "entries", stats->num_entries);
+    fprintf(file, "%-20s %12ld\n", "  bytes", stats->size);
   }
-  return memcmp(string.at, prefix.at, prefix.length) == 0;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_span(Strview string, Strview sample)
+void
+dc_put(DiskCache *dc, const Digest *key, Strview value)
 {
-  const char *cp = NULL;
-  int i = 0;
+  Strbuf path;
+  Strbuf data;
+  int64 slash = 0;
   /**/
-  for (i = 0; i < string.length; i++) {
-    cp = memchr(sample.at, string.at[i], sample.length);
-    if (cp != NULL) {
-      return i;
-    }
+  assert(dc != NULL);
+  assert(dc->is_inited);
+  assert(key != NULL);
+  /**/
+  mem_clear(&path, sizeof(path));
+  mem_clear(&data, sizeof(data));
+  sb_init(&path);
+  sb_init(&data);
+  dc_path(dc, key, &path);
+  slash = dc->dir.length + 3;
+  path.at[slash] = '\0';
+  mkdir(path.at, 0777);
+  path.at[slash] = '/';
+  sb_append_bytes(&data, DC_MAGIC, DC_MAGIC_LENGTH);
+  sb_append_sv(&data, value);
+  if (wr_save(path.at, data.at, data.length)) {
+    G->cache_stats.num_stores++;
   }
-  return string.length;
+  sb_deinit(&data);
+  sb_deinit(&path);
 }
 
 /*----------------------------------------------------------*/
-int
-sv_span_end(Strview string, Strview sample)
+void
+dc_trim(DiskCache *dc)
 {
-  const char *cp = NULL;
-  int i = 0;
-  int maxi = string.length - 1;
+  CacheStats *stats = NULL;
+  DiskEntry *entries = NULL;
+  DiskEntry entry;
+  Vector list;
+  Strbuf paths;
+  Strbuf sub;
+  struct stat st;
+  struct dirent *ent = NULL;
+  DIR *dir = NULL;
+  int64 total = 0;
+  int64 limit = 0;
+  int64 i = 0;
+  int num_removed = 0;
+  int n = 0;
   /**/
-  for (i = maxi; 0 <= i; i--) {
-    cp = memchr(sample.at, string.at[i], sample.length);
-    if (cp != NULL) {
-      return maxi - i;
+  assert(dc != NULL);
+  assert(dc->is_inited);
+  /**/
+  mem_clear(&list, sizeof(list));
+  mem_clear(&paths, sizeof(paths));
+  mem_clear(&sub, sizeof(sub));
+  vec_init(&list, sizeof(DiskEntry), 0);
+  sb_init(&paths);
+  sb_init(&sub);
+  for (n = 0; n < 256; n++) {
+    sb_clear(&sub);
+    sb_append(&sub, "%s/%02x", dc->dir.at, n);
+    dir = opendir(sub.at);
+    if (dir == NULL) {
+      continue;
+    }
+    while ((ent = readdir(dir)) != NULL) {
+      if (ent->d_name[0] == '.') {
+        continue;
+      }
+      entry.path = paths.length;
+      sb_append(&paths, "%s/%s", sub.at, ent->d_name);
+      if (stat(paths.at + entry.path, &st) != 0
+          || !S_ISREG(st.st_mode)) {
+        sb_remove(&paths, entry.path, paths.length - entry.path);
+        continue;
+      }
+      /* Paths are kept apart by their terminators. */
+      sb_append_char(&paths, '\0');
+      entry.size = st.st_size;
+      entry.mtime = st.st_mtime;
+      total += entry.size;
+      vec_push(&list, &entry);
     }
+    closedir(dir);
   }
-  return string.length;
+  stats = &G->cache_stats;
+  entries = (DiskEntry *)list.at;
+  if (dc->max_size > 0 && total > dc->max_size) {
+    limit = dc->max_size / 100 * DC_TRIM_PERCENT;
+    qsort(entries, list.length, sizeof(DiskEntry), dc_compare);
+    for (i = 0; i < list.length && total > limit; i++) {
+      if (remove(paths.at + entries[i].path) == 0) {
+        total -= entries[i].size;
+        stats->num_evictions++;
+        stats->evicted_bytes += entries[i].size;
+        num_removed++;
+      }
+    }
+  }
+  stats->num_entries = list.length - num_removed;
+  stats->size = total;
+  stats->is_trimmed = 1;
+  sb_deinit(&sub);
+  sb_deinit(&paths);
+  vec_deinit(&list);
 }
 
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION:                                          */
+/*----------------------------------------------------------*/
+
 /*----------------------------------------------------------*/
 int
-sv_span_not(Strview string, Strview sample)
+ascii_lower(int ch)
 {
-  const char *cp = NULL;
-  int i = 0;
-  /**/
-  for (i = 0; i < string.length; i++) {
-    cp = memchr(sample.at, string.at[i], sample.length);
-    if (cp == NULL) {
-      return i;
-    }
+  if (ch >= 'A' && ch <= 'Z') {
+    return ch - 'A' + 'a';
   }
-  return string.length;
+  return ch;
 }
 
 /*----------------------------------------------------------*/
-int
-sv_span_not_end(Strview string, Strview sample)
+unsigned long
+ascii_lower_word(unsigned long word)
 {
-  const char *cp = NULL;
-  int i = 0;
-  int maxi = string.length - 1;
+  unsigned long ones = ~0UL / UCHAR_MAX;
+  unsigned long highs = ones << 7;
+  unsigned long low7 = 0;
+  unsigned long from_a = 0;
+  unsigned long past_z = 0;
+  unsigned long upper = 0;
   /**/
-  for (i = maxi; 0 <= i; i--) {
-    cp = memchr(sample.at, string.at[i], sample.length);
-    if (cp == NULL) {
-      return maxi - i;
-    }
-  }
-  return string.length;
+  /* Bit 7 of a byte tells if its low 7 bits are >= 'A' or > 'Z'. */
+  low7 = word & ~highs;
+  from_a = low7 + ones * (0x80 - 'A');
+  past_z = low7 + ones * (0x80 - 'Z' - 1);
+  upper = (from_a ^ past_z) & ~word & highs;
+  return word | upper >> 2;
 }
 
 /*----------------------------------------------------------*/
-Strview
-sv_substr(Strview string, int start, int length)
+char *
+format_digits(char *buf, unsigned long value, int base, int upper)
 {
-  assert(start >= 0);
-  assert(start < string.length);
-  assert(length >= 0);
+  const char *digits = NULL;
+  char *ptr = NULL;
   /**/
-  return sv_array(string.at + start, length);
+  assert(buf != NULL);
+  assert(base == 8 || base == 10 || base == 16);
+  /**/
+  digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  ptr = buf + 32;
+  do {
+    *--ptr = digits[value % base];
+    value /= base;
+  } while (value != 0);
+  return ptr;
 }
 
+#ifdef UACC_SSE2
 /*----------------------------------------------------------*/
 int
-sv_suffix(Strview string, Strview suffix)
+highest_bit(unsigned mask)
 {
-  const char *part = NULL;
+  int bit = 0;
   /**/
-  if (string.length < suffix.length) {
-    return 0;
+  assert(mask != 0);
+  /**/
+#ifdef __GNUC__
+  bit = sizeof(mask) * CHAR_BIT - 1 - __builtin_clz(mask);
+#else
+  bit = sizeof(mask) * CHAR_BIT - 1;
+  while (!(mask & (1u << bit))) {
+    bit--;
   }
-  part = string.at + string.length - suffix.length;
-  return memcmp(part, suffix.at, suffix.length) == 0;
+#endif
+  return bit;
 }
 
 /*----------------------------------------------------------*/
-/* IMPLEMENTATION:                                          */
-/*----------------------------------------------------------*/
+int
+lowest_bit(unsigned mask)
+{
+  int bit = 0;
+  /**/
+  assert(mask != 0);
+  /**/
+#ifdef __GNUC__
+  bit = __builtin_ctz(mask);
+#else
+  while (!(mask & (1u << bit))) {
+    bit++;
+  }
+#endif
+  return bit;
+}
+#endif
 
 /*----------------------------------------------------------*/
-int
-normalize_index(int i, int n)
+int64
+normalize_index(int64 i, int64 n)
 {
   while (i < 0) {
     i += n;
@@ -701,3 +4159,22 @@ normalize_index(int i, int n)
   return i;
 }
 
+/*----------------------------------------------------------*/
+void
+reverse_bytes(char *at, int64 n)
+{
+  char *end = NULL;
+  char temp = 0;
+  /**/
+  assert(n >= 0);
+  /**/
+  if (n == 0) {
+    return;
+  }
+  end = at + n - 1;
+  while (at < end) {
+    temp = *at;
+    *at++ = *end;
+    *end-- = temp;
+  }
+}
@@ -0,0 +1,2031 @@
+/* Unique ANSI C Compiler */
+/* uacc_parse.c - Parser */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+Kinds of declarators for `parse_declarator`.
+*/
+#define PARSE_NAMED    1 /* with a name */
+#define PARSE_ABSTRACT 2 /* without a name, in type names */
+#define PARSE_EITHER   3 /* with a name or not, in parameters */
+
+/*
+Nesting of expressions, statements, declarators and
+initializers that is an error. Parsing recurses that deep.
+*/
+#define PARSE_MAX_DEPTH 256
+
+/*----------------------------------------------------------*/
+/* TYPES                                                    */
+/*----------------------------------------------------------*/
+
+/*
+State of parsing one translation unit.
+*/
+typedef struct Parser {
+  Ast *ast;
+  Preprocessor *pp;
+  Tokens *tokens;
+  /* Index of the next token. */
+  int pos;
+  /* `typedef_mark` or `object_mark` by the ID of a name in
+  the scopes being parsed. */
+  Map names;
+  /* Children of the lists being parsed, and the operands of
+  the chains of `=`, `?:` and `else if`. */
+  Vector stack;
+  /* IDs of the names the headers of the host use, or 0. */
+  int va_list_id;
+  int va_arg_id;
+  int offsetof_id;
+  /* Where the messages of errors go. */
+  Strbuf *errors;
+  int depth;
+  int num_errors;
+  /* An error was found and tokens are being skipped. */
+  int is_panic;
+} Parser;
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: SYNTAX TREE                            */
+/*----------------------------------------------------------*/
+
+/*
+Append the `n` indices at `items` to the lists of `ast`.
+Returns where they start.
+*/
+static int
+ast_add_list(Ast *ast, const int *items, int n);
+
+/*
+Append a node to `ast`. Returns its index.
+*/
+static int
+ast_add_node(Ast *ast, int kind, int op, int64 offset);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: PARSER                                 */
+/*----------------------------------------------------------*/
+
+/*
+Skip the next token if it has `kind`. Returns 0 if it has not.
+*/
+static int
+parse_accept(Parser *ps, int kind);
+
+/*
+Skip the next token if it is the keyword `word`. Returns 0 if
+it is not.
+*/
+static int
+parse_accept_word(Parser *ps, int word);
+
+/*
+Parse an assignment expression.
+*/
+static int
+parse_assign(Parser *ps);
+
+/*
+Parse binary operators binding at least as tight as
+`min_prec`.
+*/
+static int
+parse_binary(Parser *ps, int min_prec);
+
+/*
+Parse a cast expression.
+*/
+static int
+parse_cast(Parser *ps);
+
+/*
+Parse a compound statement. The parameters of a function are
+already in the scope of its body, so `is_body` starts none.
+*/
+static int
+parse_compound(Parser *ps, int is_body);
+
+/*
+Parse a conditional expression, also a constant expression.
+*/
+static int
+parse_cond(Parser *ps);
+
+/*
+Parse a declaration in a block.
+*/
+static int
+parse_decl(Parser *ps);
+
+/*
+Parse the rest of a declaration after the first declarator
+`first`, which is at token `start`.
+*/
+static int
+parse_decl_rest(Parser *ps, int start, int specs, int first);
+
+/*
+Put the name of `declarator` in the current scope as a name
+of a type if `is_typedef` or of anything else.
+*/
+static void
+parse_declare(Parser *ps, int declarator, int is_typedef);
+
+/*
+Parse a declarator of `mode`, `PARSE_*`.
+*/
+static int
+parse_declarator(Parser *ps, int mode);
+
+/*
+Parse the member of `__builtin_offsetof`: a name followed by
+`.` and `[]`.
+*/
+static int
+parse_designator(Parser *ps);
+
+/*
+Count a level of nesting. Returns 0, prints an error and skips
+the statement if there are too many. `parse_leave` must follow
+either way.
+*/
+static int
+parse_enter(Parser *ps);
+
+/*
+Parse `enum` with its tag or list of enumerators.
+*/
+static int
+parse_enum(Parser *ps);
+
+/*
+Print the error `message` at token `i`, unless tokens are
+being skipped after another error.
+*/
+static void
+parse_error(Parser *ps, int i, const char *message);
+
+/*
+Skip the next token if it has `kind`, else print that
+`spelling` was expected. Returns 0 if it was not there.
+*/
+static int
+parse_expect(Parser *ps, int kind, const char *spelling);
+
+/*
+Parse an expression with the comma operator.
+*/
+static int
+parse_expr(Parser *ps);
+
+/*
+Parse a declaration or a function definition at file scope.
+*/
+static int
+parse_external(Parser *ps);
+
+/*
+Find the AST_D_FUNC applied right to the name of `declarator`.
+Returns 0 if it does not declare a function.
+*/
+static int
+parse_func_of(Parser *ps, int declarator);
+
+/*
+Parse the definition of a function after its declarator
+`declarator` at token `start`, with `func` from
+`parse_func_of`.
+*/
+static int
+parse_function(Parser *ps, int start, int specs, int declarator,
+  int func);
+
+/*
+Parse an initializer.
+*/
+static int
+parse_initializer(Parser *ps);
+
+/*
+Tell if the next tokens start a declaration in a block.
+*/
+static int
+parse_is_decl(Parser *ps);
+
+/*
+Tell if token `i` is a keyword.
+*/
+static int
+parse_is_keyword(Parser *ps, int i);
+
+/*
+Tell if token `i` starts declaration specifiers. Storage
+classes count only if `is_type`, in type names, is 0.
+*/
+static int
+parse_is_specs(Parser *ps, int i, int is_type);
+
+/*
+Tell if token `i` is a name of a type made by `typedef`.
+*/
+static int
+parse_is_typedef(Parser *ps, int i);
+
+/*
+End a level of nesting counted by `parse_enter`.
+*/
+static void
+parse_leave(Parser *ps);
+
+/*
+Move the children pushed to `ps->stack` since `mark` to the
+lists of the tree. Returns where they start and sets `*count`.
+*/
+static int
+parse_list(Parser *ps, int64 mark, int *count);
+
+/*
+Parse a member declaration of a struct or a union.
+*/
+static int
+parse_member(Parser *ps);
+
+/*
+Find the ID of the name of `declarator`, 0 if it is abstract.
+*/
+static int
+parse_name_of(Parser *ps, int declarator);
+
+/*
+Make a node of `kind` that starts at token `start`.
+*/
+static int
+parse_node(Parser *ps, int kind, int start, int a, int b, int c);
+
+/*
+Get the offset of token `i`, or of the nearest token with
+a place in a header if `i` has `TF_SCRATCH`.
+*/
+static int64
+parse_offset(Parser *ps, int i);
+
+/*
+Parse a parameter declaration of a prototype.
+*/
+static int
+parse_param(Parser *ps);
+
+/*
+Parse the parameters after `(` of a function declarator that
+applies to `inner` at token `start`.
+*/
+static int
+parse_params(Parser *ps, int start, int inner);
+
+/*
+Get the kind of the token `ahead` tokens after the next.
+*/
+static int
+parse_peek(Parser *ps, int ahead);
+
+/*
+Parse the postfix operators after `node`, which starts at
+token `start`.
+*/
+static int
+parse_postfix(Parser *ps, int start, int node);
+
+/*
+Get the precedence of the binary operator of `kind`, 0 if it
+is not one.
+*/
+static int
+parse_prec(int kind);
+
+/*
+Parse a primary expression.
+*/
+static int
+parse_primary(Parser *ps);
+
+/*
+Push the index `node` to `ps->stack`, if it is not 0.
+*/
+static void
+parse_push(Parser *ps, int node);
+
+/*
+Parse `struct` or `union` with its tag or list of members.
+*/
+static int
+parse_record(Parser *ps, int kind);
+
+/*
+Parse declaration specifiers. Storage classes are not taken
+if `is_type`. Returns 0 if there are none.
+*/
+static int
+parse_specs(Parser *ps, int is_type);
+
+/*
+Parse a statement.
+*/
+static int
+parse_stmt(Parser *ps);
+
+/*
+Skip the tokens after an error to the end of the declaration
+or statement that started at token `start`, unless it got to
+its end anyway, and stop skipping. At file scope `is_file`
+skips `}` as well.
+*/
+static void
+parse_sync(Parser *ps, int start, int is_file);
+
+/*
+Parse a type name of a cast, `sizeof` and the like.
+*/
+static int
+parse_type_name(Parser *ps);
+
+/*
+Parse a unary expression.
+*/
+static int
+parse_unary(Parser *ps);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+/*
+Values of `Parser.names`: a name of a type or of anything else,
+such as a variable that hides a type of an outer scope.
+*/
+static char typedef_mark;
+static char object_mark;
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: SYNTAX TREE                              */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+ast_add_list(Ast *ast, const int *items, int n)
+{
+  int *lists = NULL;
+  int start = 0;
+  /**/
+  assert(ast != NULL);
+  assert(ast->is_inited);
+  assert(n >= 0);
+  /**/
+  if (ast->num_lists + n > ast->cap_lists) {
+    /* The old array stays in the arena until the end. */
+    while (ast->num_lists + n > ast->cap_lists) {
+      ast->cap_lists *= 2;
+    }
+    lists = arena_alloc(&ast->arena,
+      mem_size_mul(ast->cap_lists, sizeof(int))
+    );
+    memcpy(lists, ast->lists, ast->num_lists * sizeof(int));
+    ast->lists = lists;
+  }
+  start = ast->num_lists;
+  if (n > 0) {
+    memcpy(ast->lists + start, items, n * sizeof(int));
+    ast->num_lists += n;
+  }
+  return start;
+}
+
+/*----------------------------------------------------------*/
+int
+ast_add_node(Ast *ast, int kind, int op, int64 offset)
+{
+  AstNode *nodes = NULL;
+  AstNode *node = NULL;
+  /**/
+  assert(ast != NULL);
+  assert(ast->is_inited);
+  /**/
+  if (ast->num_nodes == ast->cap_nodes) {
+    ast->cap_nodes *= 2;
+    nodes = arena_alloc(&ast->arena,
+      mem_size_mul(ast->cap_nodes, sizeof(AstNode))
+    );
+    memcpy(nodes, ast->nodes, ast->num_nodes * sizeof(AstNode));
+    ast->nodes = nodes;
+  }
+  node = &ast->nodes[ast->num_nodes];
+  node->kind = kind;
+  node->op = op;
+  node->a = 0;
+  node->b = 0;
+  node->c = 0;
+  node->offset = offset;
+  return ast->num_nodes++;
+}
+
+/*----------------------------------------------------------*/
+void
+ast_deinit(Ast *ast)
+{
+  assert(ast != NULL);
+  assert(ast->is_inited);
+  /**/
+  arena_deinit(&ast->arena);
+  mem_clear(ast, sizeof(*ast));
+}
+
+/*----------------------------------------------------------*/
+void
+ast_init(Ast *ast, int num_nodes)
+{
+  assert(ast != NULL);
+  assert(!ast->is_inited);
+  assert(num_nodes >= 0);
+  /**/
+  arena_init(&ast->arena, 0);
+  ast->cap_nodes = num_nodes < 64 ? 64 : num_nodes;
+  ast->cap_lists = ast->cap_nodes / 2;
+  ast->nodes = arena_alloc(&ast->arena,
+    mem_size_mul(ast->cap_nodes, sizeof(AstNode))
+  );
+  ast->lists = arena_alloc(&ast->arena,
+    mem_size_mul(ast->cap_lists, sizeof(int))
+  );
+  mem_clear(&ast->nodes[0], sizeof(AstNode));
+  ast->num_nodes = 1;
+  ast->num_lists = 0;
+  ast->root = 0;
+  ast->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: PARSER                                   */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+parse_accept(Parser *ps, int kind)
+{
+  if (ps->tokens->kinds[ps->pos] != kind) {
+    return 0;
+  }
+  ps->pos++;
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_accept_word(Parser *ps, int word)
+{
+  if (ps->tokens->kinds[ps->pos] != TK_IDENT
+      || ps->tokens->ids[ps->pos] != word) {
+    return 0;
+  }
+  ps->pos++;
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_assign(Parser *ps)
+{
+  int64 mark = 0;
+  int64 i = 0;
+  int *at = NULL;
+  int start = 0;
+  int node = 0;
+  int kind = 0;
+  /**/
+  /* Right to left: `a = b = c` is `a = (b = c)`. The chain is
+  collected first, so that its length does not add nesting. */
+  mark = ps->stack.length;
+  for (;;) {
+    start = ps->pos;
+    node = parse_cond(ps);
+    kind = parse_peek(ps, 0);
+    switch (kind) {
+    case TK_ASSIGN:
+    case TK_MUL_ASSIGN:
+    case TK_DIV_ASSIGN:
+    case TK_MOD_ASSIGN:
+    case TK_ADD_ASSIGN:
+    case TK_SUB_ASSIGN:
+    case TK_SHL_ASSIGN:
+    case TK_SHR_ASSIGN:
+    case TK_AND_ASSIGN:
+    case TK_XOR_ASSIGN:
+    case TK_OR_ASSIGN:
+      ps->pos++;
+      vec_push(&ps->stack, &start);
+      vec_push(&ps->stack, &node);
+      vec_push(&ps->stack, &kind);
+      continue;
+    default:
+      break;
+    }
+    break;
+  }
+  for (i = ps->stack.length - 3; i >= mark; i -= 3) {
+    at = (int *)ps->stack.at + i;
+    node = parse_node(ps, AST_ASSIGN, at[0], at[1], node, 0);
+    ps->ast->nodes[node].op = at[2];
+  }
+  ps->stack.length = mark;
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_binary(Parser *ps, int min_prec)
+{
+  int start = 0;
+  int node = 0;
+  int right = 0;
+  int kind = 0;
+  int prec = 0;
+  /**/
+  start = ps->pos;
+  node = parse_cast(ps);
+  for (;;) {
+    kind = parse_peek(ps, 0);
+    prec = parse_prec(kind);
+    if (prec == 0 || prec < min_prec) {
+      break;
+    }
+    ps->pos++;
+    right = parse_binary(ps, prec + 1);
+    node = parse_node(ps, AST_BINARY, start, node, right, 0);
+    ps->ast->nodes[node].op = kind;
+  }
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_cast(Parser *ps)
+{
+  int start = 0;
+  int node = 0;
+  int type = 0;
+  /**/
+  start = ps->pos;
+  if (parse_enter(ps)) {
+    if (parse_peek(ps, 0) == TK_LPAREN
+        && parse_is_specs(ps, ps->pos + 1, 1)) {
+      ps->pos++;
+      type = parse_type_name(ps);
+      parse_expect(ps, TK_RPAREN, ")");
+      node = parse_node(ps, AST_CAST, start, type, parse_cast(ps), 0);
+    } else {
+      node = parse_unary(ps);
+    }
+  }
+  parse_leave(ps);
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_compound(Parser *ps, int is_body)
+{
+  int64 mark = 0;
+  int start = 0;
+  int begin = 0;
+  int first = 0;
+  int count = 0;
+  /**/
+  start = ps->pos;
+  parse_expect(ps, TK_LBRACE, "{");
+  if (!is_body) {
+    map_push_scope(&ps->names);
+  }
+  mark = ps->stack.length;
+  /* Declarations come first in C89. */
+  while (parse_is_decl(ps)) {
+    begin = ps->pos;
+    parse_push(ps, parse_decl(ps));
+    if (ps->is_panic) {
+      parse_sync(ps, begin, 0);
+    }
+  }
+  while (parse_peek(ps, 0) != TK_RBRACE
+      && parse_peek(ps, 0) != TK_EOF) {
+    begin = ps->pos;
+    if (parse_is_decl(ps)) {
+      parse_push(ps, parse_decl(ps));
+      if (!ps->is_panic) {
+        parse_error(ps, begin, "declaration after a statement");
+      }
+    } else {
+      parse_push(ps, parse_stmt(ps));
+    }
+    if (ps->is_panic) {
+      parse_sync(ps, begin, 0);
+    }
+  }
+  parse_expect(ps, TK_RBRACE, "}");
+  if (!is_body) {
+    map_pop_scope(&ps->names);
+  }
+  first = parse_list(ps, mark, &count);
+  return parse_node(ps, AST_COMPOUND, start, first, count, 0);
+}
+
+/*----------------------------------------------------------*/
+int
+parse_cond(Parser *ps)
+{
+  int64 mark = 0;
+  int64 i = 0;
+  int *at = NULL;
+  int start = 0;
+  int node = 0;
+  int then = 0;
+  /**/
+  /* Right to left like `parse_assign`: `a ? b : c ? d : e`
+  is `a ? b : (c ? d : e)`. */
+  mark = ps->stack.length;
+  for (;;) {
+    start = ps->pos;
+    node = parse_binary(ps, 1);
+    if (!parse_accept(ps, TK_QUESTION)) {
+      break;
+    }
+    then = parse_expr(ps);
+    parse_expect(ps, TK_COLON, ":");
+    vec_push(&ps->stack, &start);
+    vec_push(&ps->stack, &node);
+    vec_push(&ps->stack, &then);
+  }
+  for (i = ps->stack.length - 3; i >= mark; i -= 3) {
+    at = (int *)ps->stack.at + i;
+    node = parse_node(ps, AST_COND, at[0], at[1], at[2], node);
+  }
+  ps->stack.length = mark;
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_decl(Parser *ps)
+{
+  int start = 0;
+  int specs = 0;
+  /**/
+  start = ps->pos;
+  specs = parse_specs(ps, 0);
+  if (parse_accept(ps, TK_SEMI)) {
+    return parse_node(ps, AST_DECL, start, specs, 0, 0);
+  }
+  return parse_decl_rest(ps, start, specs,
+    parse_declarator(ps, PARSE_NAMED)
+  );
+}
+
+/*----------------------------------------------------------*/
+int
+parse_decl_rest(Parser *ps, int start, int specs, int first)
+{
+  int64 mark = 0;
+  int declarator = 0;
+  int init = 0;
+  int begin = 0;
+  int count = 0;
+  int is_typedef = 0;
+  /**/
+  mark = ps->stack.length;
+  is_typedef = specs != 0
+    && (ps->ast->nodes[specs].a & SPEC_TYPEDEF) != 0;
+  declarator = first;
+  for (;;) {
+    begin = ps->pos;
+    /* The name is known from here, its initializer sees it. */
+    parse_declare(ps, declarator, is_typedef);
+    init = 0;
+    if (parse_accept(ps, TK_ASSIGN)) {
+      init = parse_initializer(ps);
+    }
+    parse_push(ps, parse_node(ps, AST_INIT_DECL, begin, declarator,
+      init, 0
+    ));
+    if (!parse_accept(ps, TK_COMMA)) {
+      break;
+    }
+    declarator = parse_declarator(ps, PARSE_NAMED);
+  }
+  parse_expect(ps, TK_SEMI, ";");
+  begin = parse_list(ps, mark, &count);
+  return parse_node(ps, AST_DECL, start, specs, begin, count);
+}
+
+/*----------------------------------------------------------*/
+void
+parse_declare(Parser *ps, int declarator, int is_typedef)
+{
+  int id = 0;
+  /**/
+  id = parse_name_of(ps, declarator);
+  if (id != 0) {
+    map_set(&ps->names, id, is_typedef ? &typedef_mark : &object_mark);
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+parse_declarator(Parser *ps, int mode)
+{
+  int start = 0;
+  int node = 0;
+  int size = 0;
+  int kind = 0;
+  int next = 0;
+  int quals = 0;
+  int is_nested = 0;
+  /**/
+  start = ps->pos;
+  if (!parse_enter(ps)) {
+    parse_leave(ps);
+    return 0;
+  }
+  if (parse_accept(ps, TK_STAR)) {
+    for (;;) {
+      if (parse_accept_word(ps, KW_CONST)) {
+        quals |= SPEC_CONST;
+      } else if (parse_accept_word(ps, KW_VOLATILE)) {
+        quals |= SPEC_VOLATILE;
+      } else {
+        break;
+      }
+    }
+    node = parse_node(ps, AST_D_POINTER, start,
+      parse_declarator(ps, mode), 0, 0
+    );
+    ps->ast->nodes[node].op = quals;
+    parse_leave(ps);
+    return node;
+  }
+  kind = parse_peek(ps, 0);
+  if (kind == TK_LPAREN) {
+    /* Else the parentheses hold parameters of an abstract
+    declarator. */
+    next = parse_peek(ps, 1);
+    is_nested = mode == PARSE_NAMED || next == TK_STAR
+      || next == TK_LPAREN || next == TK_LBRACK
+      || (mode == PARSE_EITHER && next == TK_IDENT
+        && !parse_is_keyword(ps, ps->pos + 1)
+        && !parse_is_typedef(ps, ps->pos + 1));
+  }
+  if (is_nested) {
+    ps->pos++;
+    node = parse_declarator(ps, mode);
+    parse_expect(ps, TK_RPAREN, ")");
+  } else if (mode != PARSE_ABSTRACT && kind == TK_IDENT
+      && !parse_is_keyword(ps, ps->pos)) {
+    node = parse_node(ps, AST_D_NAME, start,
+      ps->tokens->ids[ps->pos], 0, 0
+    );
+    ps->pos++;
+  } else {
+    if (mode == PARSE_NAMED) {
+      parse_error(ps, ps->pos, "expected an identifier");
+    }
+    node = parse_node(ps, AST_D_NAME, start, 0, 0, 0);
+  }
+  /* Each suffix applies before the ones to its left. */
+  for (;;) {
+    if (parse_accept(ps, TK_LBRACK)) {
+      size = 0;
+      if (parse_peek(ps, 0) != TK_RBRACK) {
+        size = parse_cond(ps);
+      }
+      parse_expect(ps, TK_RBRACK, "]");
+      node = parse_node(ps, AST_D_ARRAY, start, node, size, 0);
+    } else if (parse_accept(ps, TK_LPAREN)) {
+      node = parse_params(ps, start, node);
+    } else {
+      break;
+    }
+  }
+  parse_leave(ps);
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_designator(Parser *ps)
+{
+  int start = 0;
+  int node = 0;
+  int kind = 0;
+  /**/
+  start = ps->pos;
+  kind = TK_DOT;
+  do {
+    if (kind == TK_LBRACK) {
+      node = parse_node(ps, AST_INDEX, start, node, parse_expr(ps), 0);
+      parse_expect(ps, TK_RBRACK, "]");
+    } else if (parse_peek(ps, 0) == TK_IDENT
+        && !parse_is_keyword(ps, ps->pos)) {
+      node = parse_node(ps, AST_MEMBER, start, node,
+        ps->tokens->ids[ps->pos++], 0
+      );
+      ps->ast->nodes[node].op = TK_DOT;
+    } else {
+      parse_error(ps, ps->pos, "expected a member name");
+      break;
+    }
+    kind = parse_peek(ps, 0);
+  } while (parse_accept(ps, TK_DOT) || parse_accept(ps, TK_LBRACK));
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_enter(Parser *ps)
+{
+  ps->depth++;
+  if (ps->depth > PARSE_MAX_DEPTH) {
+    parse_error(ps, ps->pos, "nested too deeply");
+    /* The tokens of the deep part would make an error each, so
+    skip them to the end of the statement with its arms of
+    `else`, and stay quiet until the enclosing list syncs. */
+    do {
+      parse_sync(ps, ps->pos, 0);
+    } while (parse_accept_word(ps, KW_ELSE));
+    ps->is_panic = 1;
+    return 0;
+  }
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_enum(Parser *ps)
+{
+  int64 mark = 0;
+  int start = 0;
+  int begin = 0;
+  int tag = 0;
+  int id = 0;
+  int value = 0;
+  int first = 0;
+  int count = -1;
+  /**/
+  start = ps->pos;
+  ps->pos++;
+  if (parse_peek(ps, 0) == TK_IDENT && !parse_is_keyword(ps, ps->pos)) {
+    tag = ps->tokens->ids[ps->pos++];
+  }
+  if (parse_accept(ps, TK_LBRACE)) {
+    mark = ps->stack.length;
+    do {
+      /* Not C89, but the headers of the host do it. */
+      if (parse_peek(ps, 0) == TK_RBRACE && mark != ps->stack.length) {
+        break;
+      }
+      begin = ps->pos;
+      id = 0;
+      if (parse_peek(ps, 0) == TK_IDENT
+          && !parse_is_keyword(ps, ps->pos)) {
+        id = ps->tokens->ids[ps->pos++];
+        map_set(&ps->names, id, &object_mark);
+      } else {
+        parse_error(ps, ps->pos, "expected an enumerator");
+        break;
+      }
+      value = 0;
+      if (parse_accept(ps, TK_ASSIGN)) {
+        value = parse_cond(ps);
+      }
+      parse_push(ps, parse_node(ps, AST_ENUMERATOR, begin, id, value,
+        0
+      ));
+    } while (parse_accept(ps, TK_COMMA));
+    parse_expect(ps, TK_RBRACE, "}");
+    first = parse_list(ps, mark, &count);
+  } else if (tag == 0) {
+    parse_error(ps, ps->pos, "expected a tag or '{'");
+  }
+  return parse_node(ps, AST_ENUM, start, tag, first, count);
+}
+
+/*----------------------------------------------------------*/
+void
+parse_error(Parser *ps, int i, const char *message)
+{
+  Header *header = NULL;
+  int64 offset = 0;
+  int64 line = 0;
+  int64 column = 0;
+  /**/
+  if (ps->is_panic) {
+    return;
+  }
+  ps->is_panic = 1;
+  ps->num_errors++;
+  offset = parse_offset(ps, i);
+  header = hc_locate(ps->pp->cache, offset);
+  src_locate(&header->src, offset - header->base, &line, &column);
+  sb_append(ps->errors, "%s:%ld:%ld: error: %s\n",
+    header->src.path.at, (long)line, (long)column, message
+  );
+}
+
+/*----------------------------------------------------------*/
+int
+parse_expect(Parser *ps, int kind, const char *spelling)
+{
+  Strbuf message;
+  /**/
+  if (parse_accept(ps, kind)) {
+    return 1;
+  }
+  if (!ps->is_panic) {
+    mem_clear(&message, sizeof(message));
+    sb_init(&message);
+    sb_append(&message, "%s%s%s", "expected '", spelling, "'");
+    parse_error(ps, ps->pos, message.at);
+    sb_deinit(&message);
+  }
+  return 0;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_expr(Parser *ps)
+{
+  int start = 0;
+  int node = 0;
+  /**/
+  start = ps->pos;
+  node = parse_assign(ps);
+  while (parse_accept(ps, TK_COMMA)) {
+    node = parse_node(ps, AST_BINARY, start, node, parse_assign(ps),
+      0
+    );
+    ps->ast->nodes[node].op = TK_COMMA;
+  }
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_external(Parser *ps)
+{
+  int start = 0;
+  int specs = 0;
+  int declarator = 0;
+  int func = 0;
+  int kind = 0;
+  int node_index = 0;
+  AstNode *node = NULL;
+  /**/
+  start = ps->pos;
+  specs = parse_specs(ps, 0);
+  if (specs != 0 && parse_accept(ps, TK_SEMI)) {
+    return parse_node(ps, AST_DECL, start, specs, 0, 0);
+  }
+  kind = parse_peek(ps, 0);
+  if (specs == 0 && kind != TK_STAR && kind != TK_LPAREN
+      && (kind != TK_IDENT || parse_is_keyword(ps, ps->pos))) {
+    parse_error(ps, ps->pos, "expected a declaration");
+    return 0;
+  }
+  declarator = parse_declarator(ps, PARSE_NAMED);
+  func = parse_func_of(ps, declarator);
+  if (func != 0) {
+    node = &ps->ast->nodes[func];
+    kind = parse_peek(ps, 0);
+    if (kind == TK_LBRACE || ((node->op & AST_OLD_STYLE)
+        && node->c > 0 && parse_is_specs(ps, ps->pos, 0))) {
+      return parse_function(ps, start, specs, declarator, func);
+    }
+  }
+  node_index = parse_decl_rest(ps, start, specs, declarator);
+  if (specs == 0 && !ps->is_panic) {
+    parse_error(ps, start, "declaration without a type");
+  }
+  return node_index;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_func_of(Parser *ps, int declarator)
+{
+  AstNode *nodes = NULL;
+  int inner = 0;
+  /**/
+  nodes = ps->ast->nodes;
+  while (declarator != 0 && nodes[declarator].kind != AST_D_NAME) {
+    inner = nodes[declarator].a;
+    if (inner != 0 && nodes[inner].kind == AST_D_NAME) {
+      break;
+    }
+    declarator = inner;
+  }
+  if (declarator == 0 || nodes[declarator].kind != AST_D_FUNC) {
+    return 0;
+  }
+  return declarator;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_function(Parser *ps, int start, int specs, int declarator,
+  int func)
+{
+  Strbuf message;
+  AstNode *param = NULL;
+  int first = 0;
+  int count = 0;
+  int param_specs = 0;
+  int other = 0;
+  int id = 0;
+  int i = 0;
+  /**/
+  parse_declare(ps, declarator, 0);
+  first = ps->ast->nodes[func].b;
+  count = ps->ast->nodes[func].c;
+  /* Old style: the parameters are declared between `)` and `{`
+  in any order. */
+  while ((ps->ast->nodes[func].op & AST_OLD_STYLE)
+      && parse_is_specs(ps, ps->pos, 0)) {
+    param_specs = parse_specs(ps, 0);
+    do {
+      other = parse_declarator(ps, PARSE_NAMED);
+      id = parse_name_of(ps, other);
+      if (id == 0) {
+        continue;
+      }
+      for (i = 0; i < count; i++) {
+        param = &ps->ast->nodes[ps->ast->lists[first + i]];
+        if (parse_name_of(ps, param->b) == id) {
+          break;
+        }
+      }
+      if (i == count || param->a != 0) {
+        mem_clear(&message, sizeof(message));
+        sb_init(&message);
+        sb_append(&message, "%s%s%s", "'",
+          intern_view(ps->pp->cache->interns, id).at,
+          i == count ? "' is not a parameter" : "' is declared twice"
+        );
+        parse_error(ps, ps->pos - 1, message.at);
+        sb_deinit(&message);
+      } else {
+        param->a = param_specs;
+        param->b = other;
+      }
+    } while (parse_accept(ps, TK_COMMA));
+    if (!parse_expect(ps, TK_SEMI, ";")) {
+      break;
+    }
+  }
+  map_push_scope(&ps->names);
+  for (i = 0; i < count; i++) {
+    param = &ps->ast->nodes[ps->ast->lists[first + i]];
+    parse_declare(ps, param->b, 0);
+  }
+  if (parse_peek(ps, 0) == TK_LBRACE) {
+    other = parse_compound(ps, 1);
+  } else {
+    parse_expect(ps, TK_LBRACE, "{");
+    other = 0;
+  }
+  map_pop_scope(&ps->names);
+  return parse_node(ps, AST_FUNC, start, specs, declarator, other);
+}
+
+/*----------------------------------------------------------*/
+int
+parse_initializer(Parser *ps)
+{
+  int64 mark = 0;
+  int start = 0;
+  int first = 0;
+  int count = 0;
+  int node = 0;
+  /**/
+  start = ps->pos;
+  if (!parse_enter(ps)) {
+    parse_leave(ps);
+    return 0;
+  }
+  if (parse_accept(ps, TK_LBRACE)) {
+    mark = ps->stack.length;
+    do {
+      /* A comma may end the list. */
+      if (parse_peek(ps, 0) == TK_RBRACE && mark != ps->stack.length) {
+        break;
+      }
+      parse_push(ps, parse_initializer(ps));
+    } while (parse_accept(ps, TK_COMMA) && !ps->is_panic);
+    parse_expect(ps, TK_RBRACE, "}");
+    first = parse_list(ps, mark, &count);
+    node = parse_node(ps, AST_INIT_LIST, start, first, count, 0);
+  } else {
+    node = parse_assign(ps);
+  }
+  parse_leave(ps);
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_is_decl(Parser *ps)
+{
+  /* `name:` is a label even if `name` is a type. */
+  return parse_is_specs(ps, ps->pos, 0)
+    && !(parse_is_typedef(ps, ps->pos)
+      && parse_peek(ps, 1) == TK_COLON);
+}
+
+/*----------------------------------------------------------*/
+int
+parse_is_keyword(Parser *ps, int i)
+{
+  int id = 0;
+  /**/
+  id = ps->tokens->ids[i];
+  return ps->tokens->kinds[i] == TK_IDENT && id > 0 && id < KW_COUNT;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_is_specs(Parser *ps, int i, int is_type)
+{
+  if (ps->tokens->kinds[i] != TK_IDENT) {
+    return 0;
+  }
+  switch (ps->tokens->ids[i]) {
+  case KW_TYPEDEF:
+  case KW_EXTERN:
+  case KW_STATIC:
+  case KW_AUTO:
+  case KW_REGISTER:
+    return !is_type;
+  case KW_CONST:
+  case KW_VOLATILE:
+  case KW_VOID:
+  case KW_CHAR:
+  case KW_SHORT:
+  case KW_INT:
+  case KW_LONG:
+  case KW_FLOAT:
+  case KW_DOUBLE:
+  case KW_SIGNED:
+  case KW_UNSIGNED:
+  case KW_STRUCT:
+  case KW_UNION:
+  case KW_ENUM:
+    return 1;
+  default:
+    return parse_is_typedef(ps, i);
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+parse_is_typedef(Parser *ps, int i)
+{
+  int id = 0;
+  /**/
+  id = ps->tokens->ids[i];
+  return ps->tokens->kinds[i] == TK_IDENT && id >= KW_COUNT
+    && map_get(&ps->names, id) == &typedef_mark;
+}
+
+/*----------------------------------------------------------*/
+void
+parse_leave(Parser *ps)
+{
+  ps->depth--;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_list(Parser *ps, int64 mark, int *count)
+{
+  int start = 0;
+  /**/
+  assert(mark <= ps->stack.length);
+  /**/
+  *count = ps->stack.length - mark;
+  start = ast_add_list(ps->ast, (int *)ps->stack.at + mark, *count);
+  ps->stack.length = mark;
+  return start;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_member(Parser *ps)
+{
+  int64 mark = 0;
+  int start = 0;
+  int begin = 0;
+  int specs = 0;
+  int declarator = 0;
+  int width = 0;
+  int type = 0;
+  int first = 0;
+  int count = 0;
+  /**/
+  start = ps->pos;
+  specs = parse_specs(ps, 1);
+  if (specs == 0) {
+    parse_error(ps, ps->pos, "expected a member");
+    return 0;
+  }
+  mark = ps->stack.length;
+  type = ps->ast->nodes[specs].b;
+  if (parse_peek(ps, 0) == TK_SEMI && type != 0
+      && ps->ast->nodes[type].a == 0
+      && (ps->ast->nodes[type].kind == AST_STRUCT
+        || ps->ast->nodes[type].kind == AST_UNION)) {
+    /* An unnamed struct or union of the host headers. */
+    ps->pos++;
+    return parse_node(ps, AST_DECL, start, specs, 0, 0);
+  }
+  do {
+    begin = ps->pos;
+    declarator = 0;
+    if (parse_peek(ps, 0) != TK_COLON) {
+      declarator = parse_declarator(ps, PARSE_NAMED);
+    }
+    width = 0;
+    if (parse_accept(ps, TK_COLON)) {
+      width = parse_cond(ps);
+    }
+    parse_push(ps, parse_node(ps, AST_FIELD, begin, declarator, width,
+      0
+    ));
+  } while (parse_accept(ps, TK_COMMA));
+  parse_expect(ps, TK_SEMI, ";");
+  first = parse_list(ps, mark, &count);
+  return parse_node(ps, AST_DECL, start, specs, first, count);
+}
+
+/*----------------------------------------------------------*/
+int
+parse_name_of(Parser *ps, int declarator)
+{
+  AstNode *nodes = NULL;
+  /**/
+  nodes = ps->ast->nodes;
+  while (declarator != 0 && nodes[declarator].kind != AST_D_NAME) {
+    declarator = nodes[declarator].a;
+  }
+  return declarator != 0 ? nodes[declarator].a : 0;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_node(Parser *ps, int kind, int start, int a, int b, int c)
+{
+  AstNode *node = NULL;
+  int i = 0;
+  /**/
+  i = ast_add_node(ps->ast, kind, 0, parse_offset(ps, start));
+  node = &ps->ast->nodes[i];
+  node->a = a;
+  node->b = b;
+  node->c = c;
+  return i;
+}
+
+/*----------------------------------------------------------*/
+int64
+parse_offset(Parser *ps, int i)
+{
+  const Tokens *tokens = NULL;
+  int j = 0;
+  /**/
+  tokens = ps->tokens;
+  for (j = i; j >= 0; j--) {
+    if (!(tokens->flags[j] & TF_SCRATCH)) {
+      return tokens->offsets[j];
+    }
+  }
+  /* `TK_EOF` has a place, the end of the file. */
+  for (j = i; tokens->flags[j] & TF_SCRATCH; j++) {
+  }
+  return tokens->offsets[j];
+}
+
+/*----------------------------------------------------------*/
+int
+parse_param(Parser *ps)
+{
+  int start = 0;
+  int specs = 0;
+  int declarator = 0;
+  /**/
+  start = ps->pos;
+  specs = parse_specs(ps, 0);
+  if (specs == 0) {
+    parse_error(ps, ps->pos, "expected a parameter");
+    return 0;
+  }
+  declarator = parse_declarator(ps, PARSE_EITHER);
+  parse_declare(ps, declarator, 0);
+  return parse_node(ps, AST_PARAM, start, specs, declarator, 0);
+}
+
+/*----------------------------------------------------------*/
+int
+parse_params(Parser *ps, int start, int inner)
+{
+  int64 mark = 0;
+  int begin = 0;
+  int name = 0;
+  int first = 0;
+  int count = 0;
+  int flags = 0;
+  int node = 0;
+  /**/
+  mark = ps->stack.length;
+  if (parse_peek(ps, 0) == TK_RPAREN) {
+    flags = AST_OLD_STYLE;
+  } else if (parse_peek(ps, 0) == TK_IDENT
+      && !parse_is_keyword(ps, ps->pos)
+      && !parse_is_typedef(ps, ps->pos)) {
+    /* Names of an old style definition. */
+    flags = AST_OLD_STYLE;
+    do {
+      begin = ps->pos;
+      if (parse_peek(ps, 0) != TK_IDENT
+          || parse_is_keyword(ps, ps->pos)) {
+        parse_error(ps, ps->pos, "expected an identifier");
+        break;
+      }
+      name = parse_node(ps, AST_D_NAME, begin, ps->tokens->ids[begin],
+        0, 0
+      );
+      ps->pos++;
+      parse_push(ps, parse_node(ps, AST_PARAM, begin, 0, name, 0));
+    } while (parse_accept(ps, TK_COMMA));
+  } else {
+    /* The names of a prototype end with it. */
+    map_push_scope(&ps->names);
+    do {
+      if (parse_accept(ps, TK_ELLIPSIS)) {
+        flags |= AST_VARIADIC;
+        break;
+      }
+      parse_push(ps, parse_param(ps));
+    } while (parse_accept(ps, TK_COMMA) && !ps->is_panic);
+    map_pop_scope(&ps->names);
+  }
+  parse_expect(ps, TK_RPAREN, ")");
+  first = parse_list(ps, mark, &count);
+  node = parse_node(ps, AST_D_FUNC, start, inner, first, count);
+  ps->ast->nodes[node].op = flags;
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_peek(Parser *ps, int ahead)
+{
+  int i = 0;
+  /**/
+  for (i = ps->pos; ahead > 0; ahead--) {
+    if (ps->tokens->kinds[i] == TK_EOF) {
+      break;
+    }
+    i++;
+  }
+  return ps->tokens->kinds[i];
+}
+
+/*----------------------------------------------------------*/
+int
+parse_postfix(Parser *ps, int start, int node)
+{
+  int64 mark = 0;
+  int first = 0;
+  int count = 0;
+  int kind = 0;
+  int id = 0;
+  /**/
+  for (;;) {
+    kind = parse_peek(ps, 0);
+    switch (kind) {
+    case TK_LBRACK:
+      ps->pos++;
+      node = parse_node(ps, AST_INDEX, start, node, parse_expr(ps), 0);
+      parse_expect(ps, TK_RBRACK, "]");
+      break;
+    case TK_LPAREN:
+      ps->pos++;
+      mark = ps->stack.length;
+      if (parse_peek(ps, 0) != TK_RPAREN) {
+        do {
+          parse_push(ps, parse_assign(ps));
+        } while (parse_accept(ps, TK_COMMA) && !ps->is_panic);
+      }
+      parse_expect(ps, TK_RPAREN, ")");
+      first = parse_list(ps, mark, &count);
+      node = parse_node(ps, AST_CALL, start, node, first, count);
+      break;
+    case TK_DOT:
+    case TK_ARROW:
+      ps->pos++;
+      id = 0;
+      if (parse_peek(ps, 0) == TK_IDENT
+          && !parse_is_keyword(ps, ps->pos)) {
+        id = ps->tokens->ids[ps->pos++];
+      } else {
+        parse_error(ps, ps->pos, "expected a member name");
+      }
+      node = parse_node(ps, AST_MEMBER, start, node, id, 0);
+      ps->ast->nodes[node].op = kind;
+      break;
+    case TK_INC:
+    case TK_DEC:
+      ps->pos++;
+      node = parse_node(ps, AST_POSTFIX, start, node, 0, 0);
+      ps->ast->nodes[node].op = kind;
+      break;
+    default:
+      return node;
+    }
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+parse_prec(int kind)
+{
+  switch (kind) {
+  case TK_OR:
+    return 1;
+  case TK_AND:
+    return 2;
+  case TK_PIPE:
+    return 3;
+  case TK_CARET:
+    return 4;
+  case TK_AMP:
+    return 5;
+  case TK_EQ:
+  case TK_NE:
+    return 6;
+  case TK_LT:
+  case TK_GT:
+  case TK_LE:
+  case TK_GE:
+    return 7;
+  case TK_SHL:
+  case TK_SHR:
+    return 8;
+  case TK_PLUS:
+  case TK_MINUS:
+    return 9;
+  case TK_STAR:
+  case TK_SLASH:
+  case TK_PERCENT:
+    return 10;
+  default:
+    return 0;
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+parse_primary(Parser *ps)
+{
+  int start = 0;
+  int node = 0;
+  int type = 0;
+  int kind = 0;
+  int id = 0;
+  /**/
+  start = ps->pos;
+  kind = parse_peek(ps, 0);
+  switch (kind) {
+  case TK_IDENT:
+    if (parse_is_keyword(ps, start)) {
+      break;
+    }
+    id = ps->tokens->ids[start];
+    ps->pos++;
+    if (id == ps->va_arg_id && parse_accept(ps, TK_LPAREN)) {
+      node = parse_assign(ps);
+      parse_expect(ps, TK_COMMA, ",");
+      type = parse_type_name(ps);
+      parse_expect(ps, TK_RPAREN, ")");
+      return parse_node(ps, AST_VA_ARG, start, node, type, 0);
+    }
+    if (id == ps->offsetof_id && parse_accept(ps, TK_LPAREN)) {
+      type = parse_type_name(ps);
+      parse_expect(ps, TK_COMMA, ",");
+      node = parse_designator(ps);
+      parse_expect(ps, TK_RPAREN, ")");
+      return parse_node(ps, AST_OFFSETOF, start, type, node, 0);
+    }
+    return parse_node(ps, AST_NAME, start, id, 0, 0);
+  case TK_NUMBER:
+  case TK_CHAR:
+    ps->pos++;
+    node = parse_node(ps, AST_CONSTANT, start, start, 0, 0);
+    ps->ast->nodes[node].op = kind;
+    return node;
+  case TK_STRING:
+    /* Adjacent literals make one. */
+    while (parse_accept(ps, TK_STRING)) {
+    }
+    return parse_node(ps, AST_STRING, start, start, ps->pos - start, 0);
+  case TK_LPAREN:
+    ps->pos++;
+    node = parse_expr(ps);
+    parse_expect(ps, TK_RPAREN, ")");
+    return node;
+  default:
+    break;
+  }
+  parse_error(ps, start, "expected an expression");
+  return 0;
+}
+
+/*----------------------------------------------------------*/
+void
+parse_push(Parser *ps, int node)
+{
+  /* Nothing is left of a child with errors. */
+  if (node != 0) {
+    vec_push(&ps->stack, &node);
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+parse_record(Parser *ps, int kind)
+{
+  int64 mark = 0;
+  int start = 0;
+  int begin = 0;
+  int tag = 0;
+  int first = 0;
+  int count = -1;
+  /**/
+  start = ps->pos;
+  ps->pos++;
+  if (parse_peek(ps, 0) == TK_IDENT && !parse_is_keyword(ps, ps->pos)) {
+    tag = ps->tokens->ids[ps->pos++];
+  }
+  if (parse_accept(ps, TK_LBRACE)) {
+    mark = ps->stack.length;
+    if (parse_enter(ps)) {
+      while (parse_peek(ps, 0) != TK_RBRACE
+          && parse_peek(ps, 0) != TK_EOF) {
+        begin = ps->pos;
+        parse_push(ps, parse_member(ps));
+        if (ps->is_panic) {
+          parse_sync(ps, begin, 0);
+        }
+      }
+    }
+    parse_leave(ps);
+    parse_expect(ps, TK_RBRACE, "}");
+    first = parse_list(ps, mark, &count);
+  } else if (tag == 0) {
+    parse_error(ps, ps->pos, "expected a tag or '{'");
+  }
+  return parse_node(ps, kind == KW_STRUCT ? AST_STRUCT : AST_UNION,
+    start, tag, first, count
+  );
+}
+
+/*----------------------------------------------------------*/
+int
+parse_specs(Parser *ps, int is_type)
+{
+  int start = 0;
+  int flags = 0;
+  int flag = 0;
+  int type = 0;
+  int id = 0;
+  /**/
+  start = ps->pos;
+  while (parse_peek(ps, 0) == TK_IDENT) {
+    id = ps->tokens->ids[ps->pos];
+    flag = 0;
+    switch (id) {
+    case KW_TYPEDEF:
+      flag = SPEC_TYPEDEF;
+      break;
+    case KW_EXTERN:
+      flag = SPEC_EXTERN;
+      break;
+    case KW_STATIC:
+      flag = SPEC_STATIC;
+      break;
+    case KW_AUTO:
+      flag = SPEC_AUTO;
+      break;
+    case KW_REGISTER:
+      flag = SPEC_REGISTER;
+      break;
+    case KW_CONST:
+      flag = SPEC_CONST;
+      break;
+    case KW_VOLATILE:
+      flag = SPEC_VOLATILE;
+      break;
+    case KW_VOID:
+      flag = SPEC_VOID;
+      break;
+    case KW_CHAR:
+      flag = SPEC_CHAR;
+      break;
+    case KW_SHORT:
+      flag = SPEC_SHORT;
+      break;
+    case KW_INT:
+      flag = SPEC_INT;
+      break;
+    case KW_LONG:
+      flag = (flags & SPEC_LONG) ? SPEC_LONG_LONG : SPEC_LONG;
+      break;
+    case KW_FLOAT:
+      flag = SPEC_FLOAT;
+      break;
+    case KW_DOUBLE:
+      flag = SPEC_DOUBLE;
+      break;
+    case KW_SIGNED:
+      flag = SPEC_SIGNED;
+      break;
+    case KW_UNSIGNED:
+      flag = SPEC_UNSIGNED;
+      break;
+    case KW_STRUCT:
+    case KW_UNION:
+      type = parse_record(ps, id);
+      continue;
+    case KW_ENUM:
+      type = parse_enum(ps);
+      continue;
+    default:
+      /* A name after a type is declared, not a type. */
+      if (flags & ~(SPEC_TYPEDEF | SPEC_EXTERN | SPEC_STATIC
+          | SPEC_AUTO | SPEC_REGISTER | SPEC_CONST | SPEC_VOLATILE)
+          || type != 0 || !parse_is_typedef(ps, ps->pos)) {
+        break;
+      }
+      type = parse_node(ps, AST_TYPEDEF_NAME, ps->pos, id, 0, 0);
+      ps->pos++;
+      continue;
+    }
+    if (flag == 0 || (is_type && flag <= SPEC_REGISTER)) {
+      break;
+    }
+    if (flag == SPEC_LONG_LONG && (flags & SPEC_LONG_LONG)) {
+      parse_error(ps, ps->pos, "too many 'long'");
+    }
+    flags |= flag;
+    ps->pos++;
+  }
+  if (ps->pos == start) {
+    return 0;
+  }
+  return parse_node(ps, AST_SPECS, start, flags, type, 0);
+}
+
+/*----------------------------------------------------------*/
+int
+parse_stmt(Parser *ps)
+{
+  int start = 0;
+  int node = 0;
+  int a = 0;
+  int b = 0;
+  int c = 0;
+  int exprs[3];
+  int64 mark = 0;
+  int64 i = 0;
+  int *at = NULL;
+  int begin = 0;
+  /**/
+  start = ps->pos;
+  if (!parse_enter(ps)) {
+    parse_leave(ps);
+    return 0;
+  }
+  switch (parse_peek(ps, 0)) {
+  case TK_LBRACE:
+    node = parse_compound(ps, 0);
+    break;
+  case TK_SEMI:
+    ps->pos++;
+    node = parse_node(ps, AST_EXPR_STMT, start, 0, 0, 0);
+    break;
+  case TK_IDENT:
+    switch (ps->tokens->ids[start]) {
+    case KW_IF:
+      /* Arms of `else if` are collected in a loop, so that a
+      long chain does not add nesting. */
+      mark = ps->stack.length;
+      begin = start;
+      for (;;) {
+        ps->pos++;
+        parse_expect(ps, TK_LPAREN, "(");
+        a = parse_expr(ps);
+        parse_expect(ps, TK_RPAREN, ")");
+        b = parse_stmt(ps);
+        vec_push(&ps->stack, &begin);
+        vec_push(&ps->stack, &a);
+        vec_push(&ps->stack, &b);
+        c = 0;
+        if (!parse_accept_word(ps, KW_ELSE)) {
+          break;
+        }
+        begin = ps->pos;
+        if (parse_peek(ps, 0) != TK_IDENT
+            || ps->tokens->ids[begin] != KW_IF) {
+          c = parse_stmt(ps);
+          break;
+        }
+      }
+      for (i = ps->stack.length - 3; i >= mark; i -= 3) {
+        at = (int *)ps->stack.at + i;
+        c = parse_node(ps, AST_IF, at[0], at[1], at[2], c);
+      }
+      ps->stack.length = mark;
+      node = c;
+      break;
+    case KW_SWITCH:
+    case KW_WHILE:
+      ps->pos++;
+      parse_expect(ps, TK_LPAREN, "(");
+      a = parse_expr(ps);
+      parse_expect(ps, TK_RPAREN, ")");
+      b = parse_stmt(ps);
+      node = parse_node(ps,
+        ps->tokens->ids[start] == KW_WHILE ? AST_WHILE : AST_SWITCH,
+        start, a, b, 0
+      );
+      break;
+    case KW_DO:
+      ps->pos++;
+      a = parse_stmt(ps);
+      if (!parse_accept_word(ps, KW_WHILE)) {
+        parse_error(ps, ps->pos, "expected 'while'");
+      }
+      parse_expect(ps, TK_LPAREN, "(");
+      b = parse_expr(ps);
+      parse_expect(ps, TK_RPAREN, ")");
+      parse_expect(ps, TK_SEMI, ";");
+      node = parse_node(ps, AST_DO, start, a, b, 0);
+      break;
+    case KW_FOR:
+      ps->pos++;
+      parse_expect(ps, TK_LPAREN, "(");
+      exprs[0] = parse_peek(ps, 0) != TK_SEMI ? parse_expr(ps) : 0;
+      parse_expect(ps, TK_SEMI, ";");
+      exprs[1] = parse_peek(ps, 0) != TK_SEMI ? parse_expr(ps) : 0;
+      parse_expect(ps, TK_SEMI, ";");
+      exprs[2] = parse_peek(ps, 0) != TK_RPAREN ? parse_expr(ps) : 0;
+      parse_expect(ps, TK_RPAREN, ")");
+      a = ast_add_list(ps->ast, exprs, 3);
+      b = parse_stmt(ps);
+      node = parse_node(ps, AST_FOR, start, a, b, 0);
+      break;
+    case KW_GOTO:
+      ps->pos++;
+      if (parse_peek(ps, 0) == TK_IDENT
+          && !parse_is_keyword(ps, ps->pos)) {
+        a = ps->tokens->ids[ps->pos++];
+      } else {
+        parse_error(ps, ps->pos, "expected a label");
+      }
+      parse_expect(ps, TK_SEMI, ";");
+      node = parse_node(ps, AST_GOTO, start, a, 0, 0);
+      break;
+    case KW_CONTINUE:
+    case KW_BREAK:
+      ps->pos++;
+      parse_expect(ps, TK_SEMI, ";");
+      node = parse_node(ps,
+        ps->tokens->ids[start] == KW_BREAK ? AST_BREAK : AST_CONTINUE,
+        start, 0, 0, 0
+      );
+      break;
+    case KW_RETURN:
+      ps->pos++;
+      a = parse_peek(ps, 0) != TK_SEMI ? parse_expr(ps) : 0;
+      parse_expect(ps, TK_SEMI, ";");
+      node = parse_node(ps, AST_RETURN, start, a, 0, 0);
+      break;
+    case KW_CASE:
+      ps->pos++;
+      a = parse_cond(ps);
+      parse_expect(ps, TK_COLON, ":");
+      node = parse_node(ps, AST_CASE, start, a, parse_stmt(ps), 0);
+      break;
+    case KW_DEFAULT:
+      ps->pos++;
+      parse_expect(ps, TK_COLON, ":");
+      node = parse_node(ps, AST_DEFAULT, start, parse_stmt(ps), 0, 0);
+      break;
+    default:
+      if (!parse_is_keyword(ps, start) && parse_peek(ps, 1) == TK_COLON) {
+        a = ps->tokens->ids[start];
+        ps->pos += 2;
+        node = parse_node(ps, AST_LABEL, start, a, parse_stmt(ps), 0);
+      }
+      break;
+    }
+    break;
+  default:
+    break;
+  }
+  if (node == 0 && ps->pos == start) {
+    node = parse_node(ps, AST_EXPR_STMT, start, parse_expr(ps), 0, 0);
+    parse_expect(ps, TK_SEMI, ";");
+  }
+  parse_leave(ps);
+  return node;
+}
+
+/*----------------------------------------------------------*/
+void
+parse_sync(Parser *ps, int start, int is_file)
+{
+  int depth = 0;
+  int kind = 0;
+  /**/
+  kind = ps->pos > start ? ps->tokens->kinds[ps->pos - 1] : TK_EOF;
+  if (kind == TK_SEMI || kind == TK_RBRACE) {
+    ps->is_panic = 0;
+    return;
+  }
+  for (;;) {
+    kind = parse_peek(ps, 0);
+    if (kind == TK_EOF) {
+      break;
+    } else if (kind == TK_LBRACE) {
+      depth++;
+    } else if (kind == TK_RBRACE && depth > 0) {
+      depth--;
+      if (depth == 0) {
+        /* A whole block was skipped, such as a body. */
+        ps->pos++;
+        break;
+      }
+    } else if (kind == TK_RBRACE && !is_file) {
+      break;
+    } else if (kind == TK_SEMI && depth == 0) {
+      ps->pos++;
+      break;
+    }
+    ps->pos++;
+  }
+  ps->is_panic = 0;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_type_name(Parser *ps)
+{
+  int start = 0;
+  int specs = 0;
+  /**/
+  start = ps->pos;
+  specs = parse_specs(ps, 1);
+  if (specs == 0) {
+    parse_error(ps, ps->pos, "expected a type");
+  }
+  return parse_node(ps, AST_TYPE_NAME, start, specs,
+    parse_declarator(ps, PARSE_ABSTRACT), 0
+  );
+}
+
+/*----------------------------------------------------------*/
+int
+parse_unary(Parser *ps)
+{
+  int start = 0;
+  int node = 0;
+  int kind = 0;
+  /**/
+  start = ps->pos;
+  if (!parse_enter(ps)) {
+    parse_leave(ps);
+    return 0;
+  }
+  kind = parse_peek(ps, 0);
+  switch (kind) {
+  case TK_INC:
+  case TK_DEC:
+    ps->pos++;
+    node = parse_node(ps, AST_UNARY, start, parse_unary(ps), 0, 0);
+    ps->ast->nodes[node].op = kind;
+    break;
+  case TK_AMP:
+  case TK_STAR:
+  case TK_PLUS:
+  case TK_MINUS:
+  case TK_TILDE:
+  case TK_NOT:
+    ps->pos++;
+    node = parse_node(ps, AST_UNARY, start, parse_cast(ps), 0, 0);
+    ps->ast->nodes[node].op = kind;
+    break;
+  default:
+    if (parse_accept_word(ps, KW_SIZEOF)) {
+      if (parse_peek(ps, 0) == TK_LPAREN
+          && parse_is_specs(ps, ps->pos + 1, 1)) {
+        ps->pos++;
+        node = parse_type_name(ps);
+        parse_expect(ps, TK_RPAREN, ")");
+        node = parse_node(ps, AST_SIZEOF_TYPE, start, node, 0, 0);
+      } else {
+        node = parse_node(ps, AST_SIZEOF_EXPR, start, parse_unary(ps),
+          0, 0
+        );
+      }
+    } else {
+      node = parse_postfix(ps, start, parse_primary(ps));
+    }
+    break;
+  }
+  parse_leave(ps);
+  return node;
+}
+
+/*----------------------------------------------------------*/
+int
+parse_unit(Ast *ast, Preprocessor *pp, Strbuf *errors)
+{
+  Parser ps;
+  PhaseStats *stats = NULL;
+  double start = 0;
+  int64 mark = 0;
+  int first = 0;
+  int count = 0;
+  int pos = 0;
+  /**/
+  assert(ast != NULL);
+  assert(ast->is_inited);
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  assert(pp->out->count > 0);
+  assert(pp->out->kinds[pp->out->count - 1] == TK_EOF);
+  assert(errors != NULL);
+  /**/
+  start = time_now();
+  mem_clear(&ps, sizeof(ps));
+  ps.ast = ast;
+  ps.pp = pp;
+  ps.tokens = pp->out;
+  ps.errors = errors;
+  map_init(&ps.names);
+  vec_init(&ps.stack, sizeof(int), 0);
+  ps.va_list_id = intern_find(pp->cache->interns,
+    sv_cstr("__builtin_va_list")
+  );
+  ps.va_arg_id = intern_find(pp->cache->interns,
+    sv_cstr("__builtin_va_arg")
+  );
+  ps.offsetof_id = intern_find(pp->cache->interns,
+    sv_cstr("__builtin_offsetof")
+  );
+  if (ps.va_list_id != 0) {
+    map_set(&ps.names, ps.va_list_id, &typedef_mark);
+  }
+  mark = ps.stack.length;
+  while (parse_peek(&ps, 0) != TK_EOF) {
+    pos = ps.pos;
+    parse_push(&ps, parse_external(&ps));
+    if (ps.is_panic) {
+      parse_sync(&ps, pos, 1);
+    }
+    if (ps.pos == pos) {
+      ps.pos++;
+    }
+  }
+  first = parse_list(&ps, mark, &count);
+  ast->root = parse_node(&ps, AST_UNIT, 0, first, count, 0);
+  vec_deinit(&ps.stack);
+  map_deinit(&ps.names);
+  stats = &G->phase_stats[PHASE_PARSE];
+  stats->seconds += time_now() - start;
+  stats->items += ast->num_nodes;
+  return ps.num_errors == 0;
+}
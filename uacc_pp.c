@@ -0,0 +1,3793 @@
+/* Unique ANSI C Compiler */
+/* uacc_pp.c - Preprocessor */
+
+/*----------------------------------------------------------*/
+/* INCLUDES                                                 */
+/*----------------------------------------------------------*/
+
+#include "uacc.h"
+
+/*----------------------------------------------------------*/
+/* DEFINES                                                  */
+/*----------------------------------------------------------*/
+
+/*
+First bytes of a precompiled header, with the version of the
+format.
+*/
+#define PCH_MAGIC "uaccpch2"
+
+/*
+Nesting of `#include` that is an error.
+*/
+#define PP_MAX_DEPTH 200
+
+/*
+Flag of a `PPToken` that is never expanded, as it named a
+macro being rescanned.
+*/
+#define PP_PAINTED 0x100
+
+/*
+Greatest line number `#line` takes.
+*/
+#define PP_MAX_LINE 2147483647L
+
+/*
+Blank lines printed by `pp_stream` instead of a `#line`.
+*/
+#define PP_PRINT_GAP 8
+
+/*
+Output tokens collected before `pp_stream` prints them.
+*/
+#define PP_PRINT_TOKENS 4096
+
+/*----------------------------------------------------------*/
+/* TYPES                                                    */
+/*----------------------------------------------------------*/
+
+/*
+Conditional directive open in a file.
+*/
+typedef struct PPCond {
+  /* Index of the `#` token of the directive. */
+  int token;
+  /* The text around the conditional is active. */
+  int was_active;
+  /* Some group of the conditional was taken. */
+  int is_taken;
+  int has_else;
+} PPCond;
+
+/*
+State of preprocessing one file.
+*/
+typedef struct PPFile {
+  Header *header;
+  const Tokens *tokens;
+  /* Open conditionals, `PPCond` each. */
+  Vector conds;
+  /* Tokens are output, not skipped. */
+  int is_active;
+  /* Added to the lines of the text by `#line`. */
+  int64 line_delta;
+  /* Path given by `#line`, NULL `at` if there was none. */
+  Strview line_path;
+} PPFile;
+
+/*
+Expansion of the macro `id` whose tokens are being rescanned,
+linked to the expansion it was started in. Inside it the macro
+is not expanded again.
+*/
+typedef struct PPContext {
+  const struct PPContext *next;
+  int id;
+} PPContext;
+
+/*
+Token being expanded, a node of a list in `expand_arena`.
+*/
+typedef struct PPToken {
+  struct PPToken *next;
+  /* Header of the text, NULL if the text is in `scratch`. */
+  Header *header;
+  /* Expansion the token came from, NULL for the text. */
+  const PPContext *context;
+  /* Offset in the text of `header` or in `scratch`. */
+  int64 offset;
+  /* Offset after `base` of the token whose line is the line
+  of this one if it has `TF_BOL`, -1 if not known. */
+  int64 site;
+  int length;
+  int id;
+  int kind;
+  int flags;
+} PPToken;
+
+/*
+Line of an output token that starts a line of expansion:
+`offset` after `base` of the macro name it took the place of.
+*/
+typedef struct PPSite {
+  int token;
+  int64 offset;
+} PPSite;
+
+/*
+Argument of a function-like macro. The expanded copy is made
+only if the body uses it.
+*/
+typedef struct PPArg {
+  PPToken *raw;
+  PPToken *expanded;
+  int is_expanded;
+} PPArg;
+
+/*
+Tokens of a file the arguments of a macro are taken from.
+*/
+typedef struct PPInput {
+  Header *header;
+  /* Index of the next token. */
+  int pos;
+} PPInput;
+
+/*
+Value of an expression of `#if`.
+*/
+typedef struct PPValue {
+  unsigned long bits;
+  int is_unsigned;
+} PPValue;
+
+/*
+State of evaluating an expression of `#if`: expanded tokens
+from `pos` to `end` - 1.
+*/
+typedef struct PPExpr {
+  Preprocessor *pp;
+  PPToken *tokens;
+  int pos;
+  int end;
+  int is_error;
+} PPExpr;
+
+/*
+Tokens in a precompiled header, arrays like in `Tokens` at
+offsets from the start of the file.
+*/
+typedef struct PCHTokens {
+  int64 kinds;
+  int64 flags;
+  int64 offsets;
+  int64 lengths;
+  int64 ids;
+  int64 count;
+} PCHTokens;
+
+/*
+Interned string in a precompiled header.
+*/
+typedef struct PCHString {
+  int64 at;
+  int64 length;
+} PCHString;
+
+/*
+Header in a precompiled header.
+*/
+typedef struct PCHFile {
+  /* Interned path the file was first found by. */
+  int64 path_id;
+  /* `Header.base` when the file was saved. */
+  int64 base;
+  int64 text;
+  int64 text_length;
+  /* Hash of the text the file must still have to be used. */
+  uint64 hash;
+  PCHTokens tokens;
+  int64 guard_id;
+  /* `PP_MARK_*` flags at the end of the unit. */
+  int64 marks;
+} PCHFile;
+
+/*
+Macro in a precompiled header. Fields are those of `Macro`.
+*/
+typedef struct PCHMacro {
+  /* ID of the name. */
+  int64 id;
+  /* Position in `PCHHead.files`, -1 for the definitions of
+  the host. */
+  int64 file;
+  int64 name;
+  int64 first;
+  int64 num_body;
+  /* `num_params` + 1 IDs, the last one 0. */
+  int64 params;
+  int64 num_params;
+} PCHMacro;
+
+/*
+Start of a precompiled header. The rest of the file is found
+by offsets from its start.
+*/
+typedef struct PCHHead {
+  char magic[8];
+  /* Hash of the rest of the file from `size` on, so that no
+  offset, ID or kind read from it is damaged. */
+  uint64 checksum;
+  /* Size of the whole file. */
+  int64 size;
+  /* Hash of the definitions of the host and the include
+  directories. */
+  uint64 options_hash;
+  /* `PCHString` by ID from 1, interned in this order. */
+  int64 strings;
+  int64 num_strings;
+  /* `PCHFile` by `Header.index` from 1. */
+  int64 files;
+  int64 num_files;
+  /* `PCHMacro` each. */
+  int64 macros;
+  int64 num_macros;
+  /* Output tokens without the final `TK_EOF`. */
+  PCHTokens out;
+  int64 scratch;
+  int64 scratch_length;
+  /* `Header.base` of the first file. */
+  int64 first_base;
+} PCHHead;
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: HEADER CACHE                           */
+/*----------------------------------------------------------*/
+
+/*
+Find a published header of the file `inode` on `device`.
+Needs no lock.
+*/
+static Header *
+hc_find_file(HeaderCache *hc, unsigned long device,
+  unsigned long inode);
+
+/*
+Find the macro of the include guard around the whole text of
+`header`: `#ifndef X`, `#if !defined X` or `#if !defined(X)`
+first and the matching `#endif` last. Returns 0 if there is
+no such guard.
+*/
+static int
+hc_find_guard(const Header *header);
+
+/*
+Free `header` and the memory it owns.
+*/
+static void
+hc_free(Header *header);
+
+/*
+Get the header published for `path_id`, `&missing_header` or
+NULL if the path was not looked up yet. Needs no lock.
+*/
+static Header *
+hc_get(HeaderCache *hc, int path_id);
+
+/*
+Lex the text of `header` found by `path_id`. Needs no lock.
+*/
+static void
+hc_lex(HeaderCache *hc, Header *header, int path_id);
+
+/*
+Load and lex the file by `path`, interned as `path_id`.
+Returns NULL and sets `errno` if it cannot be loaded.
+*/
+static Header *
+hc_load(HeaderCache *hc, int path_id, const char *path);
+
+/*
+Publish `header`, new or `&missing_header`, as found by
+`path_id`. If the path or the same file was published first,
+`header` is freed. Returns the header published.
+*/
+static Header *
+hc_publish(HeaderCache *hc, Header *header, int path_id);
+
+/*
+Make `path_id` find `header` unless it finds one already.
+Needs the lock.
+*/
+static void
+hc_set_path(HeaderCache *hc, int path_id, Header *header);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: PREPROCESSOR                           */
+/*----------------------------------------------------------*/
+
+/*
+Value of the hexadecimal digit `ch` or 16 if it is not one.
+*/
+static int
+hex_digit(int ch);
+
+/*
+Append `text` to `sb` as a string literal.
+*/
+static void
+pp_append_quoted(Strbuf *sb, Strview text);
+
+/*
+Start the unit with the macros, marks and output tokens of
+`pp->pch`.
+*/
+static void
+pp_apply_pch(Preprocessor *pp);
+
+/*
+Replace `name`, a macro of the preprocessor itself, by its
+value followed by `rest`.
+*/
+static PPToken *
+pp_builtin(Preprocessor *pp, const PPToken *name, PPToken *rest);
+
+/*
+Print an error if token `i` of `header` is a literal without
+the closing quote.
+*/
+static void
+pp_check_token(Preprocessor *pp, Header *header, int i);
+
+/*
+Collect the arguments of `macro` invoked by `name`. `*rparen`
+is the `(` and becomes the matching `)`, or NULL if there is
+none. Tokens after the end of the list are taken from `input`
+if it is not NULL and linked to it. Returns NULL on errors.
+*/
+static PPArg *
+pp_collect_args(Preprocessor *pp, const Macro *macro,
+  const PPToken *name, PPToken **rparen, PPInput *input);
+
+/*
+Do the conditional directive at token `i` of `file`, the line
+ends before token `end`.
+*/
+static void
+pp_conditional(Preprocessor *pp, PPFile *file, int i, int end);
+
+/*
+Check if the macro `id` is being rescanned in `context`.
+*/
+static int
+pp_context_has(const PPContext *context, int id);
+
+/*
+Start the expansion of the macro `id` inside `context`.
+*/
+static const PPContext *
+pp_context_push(Preprocessor *pp, const PPContext *context, int id);
+
+/*
+Copy the token `tok` without the link to the next one.
+*/
+static PPToken *
+pp_copy(Preprocessor *pp, const PPToken *tok);
+
+/*
+Copy the list of tokens `list`.
+*/
+static PPToken *
+pp_copy_list(Preprocessor *pp, const PPToken *list);
+
+/*
+Do `#define` with the name at token `i` of `file`.
+*/
+static void
+pp_define(Preprocessor *pp, PPFile *file, int i, int end);
+
+/*
+Do the directive at token `i` of `file`.
+Returns the index of the first token after the line.
+*/
+static int
+pp_directive(Preprocessor *pp, PPFile *file, int i);
+
+/*
+Print the error `message` at token `i` of `header`.
+*/
+static void
+pp_error(Preprocessor *pp, Header *header, int i, const char *message);
+
+/*
+Print the error `message` at `offset` in the text of `header`.
+*/
+static void
+pp_error_at(Preprocessor *pp, Header *header, int64 offset,
+  const char *message);
+
+/*
+Print the error `message` at `tok`, or where the expansion
+started if `tok` was made by it.
+*/
+static void
+pp_error_token(Preprocessor *pp, const PPToken *tok,
+  const char *message);
+
+/*
+Evaluate the expression of `#if` from token `i` of `file`.
+Returns 0 if it is false or wrong.
+*/
+static int
+pp_eval(Preprocessor *pp, PPFile *file, int i, int end);
+
+/*
+Apply the binary operator of `kind` at token `op`.
+*/
+static PPValue
+pp_eval_apply(PPExpr *e, int kind, int op, PPValue a, PPValue b,
+  int is_live);
+
+/*
+Evaluate binary operators binding at least as tight as
+`min_prec`. Division by zero is an error only if `is_live`.
+*/
+static PPValue
+pp_eval_binary(PPExpr *e, int min_prec, int is_live);
+
+/*
+Evaluate the character constant at `e->pos`.
+*/
+static PPValue
+pp_eval_char(PPExpr *e);
+
+/*
+Evaluate a conditional expression.
+*/
+static PPValue
+pp_eval_cond(PPExpr *e, int is_live);
+
+/*
+Print the error `message` at `e->pos` once.
+*/
+static void
+pp_eval_error(PPExpr *e, const char *message);
+
+/*
+Evaluate the integer constant at `e->pos`.
+*/
+static PPValue
+pp_eval_number(PPExpr *e);
+
+/*
+Evaluate a unary expression.
+*/
+static PPValue
+pp_eval_unary(PPExpr *e, int is_live);
+
+/*
+Expand the macros of `list` and rescan the results until no
+macro is left. The tokens are output if `to_out`, otherwise
+the expanded list is returned. Function-like macros at the
+end of `list` take their arguments from `input` if it is not
+NULL.
+*/
+static PPToken *
+pp_expand(Preprocessor *pp, PPToken *list, PPInput *input,
+  int to_out);
+
+/*
+Replace the invocation of `macro` by `name` with its body.
+`rest` follows the name. Returns the list to rescan.
+*/
+static PPToken *
+pp_expand_macro(Preprocessor *pp, const Macro *macro,
+  const PPToken *name, PPToken *rest, PPInput *input);
+
+/*
+Preprocess `header` as a part of the translation unit.
+*/
+static void
+pp_file(Preprocessor *pp, Header *header);
+
+/*
+Make an expanded token of token `i` of `header`.
+*/
+static PPToken *
+pp_file_token(Preprocessor *pp, Header *header, int i);
+
+/*
+Do `#include` with the file name at token `i` of `file`.
+*/
+static void
+pp_include(Preprocessor *pp, PPFile *file, int i, int end);
+
+/*
+Do `#line` with the tokens from `i` to `end` - 1 of `file`.
+*/
+static void
+pp_line(Preprocessor *pp, PPFile *file, int i, int end);
+
+/*
+Index of the first token after the line of token `i`.
+*/
+static int
+pp_line_end(const Tokens *tokens, int i);
+
+/*
+Get the path of `header` and add to `*line` as `#line` set
+them if it is the file being read.
+*/
+static Strview
+pp_line_path(Preprocessor *pp, const Header *header, int64 *line);
+
+/*
+Make the list of tokens from `i` to `end` - 1 of `header`.
+*/
+static PPToken *
+pp_line_tokens(Preprocessor *pp, Header *header, int i, int end);
+
+/*
+Check if `a` and `b` are the same definition.
+*/
+static int
+pp_macro_equal(const Macro *a, const Macro *b);
+
+/*
+Get the `PP_MARK_*` flags of `header` in this unit.
+*/
+static unsigned char *
+pp_mark(Preprocessor *pp, const Header *header);
+
+/*
+Index of the parameter of `macro` that is the token `i` of its
+header, or -1 if it is not one.
+*/
+static int
+pp_param(const Macro *macro, int i);
+
+/*
+Paste `left` and the first token of `right` into `left`.
+Returns the tokens to follow `left`: `right` without its first
+token, or all of `right` if the paste is not a valid token.
+*/
+static PPToken *
+pp_paste(Preprocessor *pp, PPToken *left, PPToken *right);
+
+/*
+Precedence of the binary operator of `kind`, higher binds
+tighter. Returns 0 if it is not a binary operator.
+*/
+static int
+pp_precedence(int kind);
+
+/*
+End the text line being printed unless it is empty.
+*/
+static void
+pp_print_end_line(Preprocessor *pp);
+
+/*
+Move the printing to `line` of `header` with blank lines or a
+`#line`.
+*/
+static void
+pp_print_line(Preprocessor *pp, Header *header, int64 line);
+
+/*
+Check whether two tokens printed side by side would lex
+differently. `last` is the last character of the first token,
+`first` the first character of the second.
+*/
+static int
+pp_print_needs_space(int last_kind, int last, int kind, int first);
+
+/*
+Print the output tokens collected and clear them.
+*/
+static void
+pp_print_out(Preprocessor *pp);
+
+/*
+Take the next token of `input`. Returns NULL at the end of
+the file or of the text before a directive.
+*/
+static PPToken *
+pp_pull(Preprocessor *pp, PPInput *input);
+
+/*
+Make a token of `length` characters at `offset` in `scratch`.
+*/
+static PPToken *
+pp_scratch_token(Preprocessor *pp, int kind, int64 offset,
+  int64 length, int flags);
+
+/*
+Text of token `i` of `header` with splices and trigraphs
+undone. Valid until the next call.
+*/
+static Strview
+pp_spell(Preprocessor *pp, const Header *header, int i);
+
+/*
+Make the string literal spelling the tokens of `list`.
+*/
+static PPToken *
+pp_stringize(Preprocessor *pp, const PPToken *list, int flags);
+
+/*
+Make the body of `macro` invoked by `name` with `args` and
+followed by `rest`. All its tokens come from `context`, the
+arguments are expanded in the one it was started in.
+*/
+static PPToken *
+pp_subst(Preprocessor *pp, const Macro *macro, PPArg *args,
+  const PPContext *context, const PPToken *name, PPToken *rest);
+
+/*
+Text of `tok` with splices and trigraphs undone. Valid until
+the next call.
+*/
+static Strview
+pp_tok_spell(Preprocessor *pp, const PPToken *tok);
+
+/*----------------------------------------------------------*/
+/* STATIC FUNCTIONS: PRECOMPILED HEADER                     */
+/*----------------------------------------------------------*/
+
+/*
+Pad the output of `w` to a multiple of 8 bytes.
+*/
+static void
+pch_align(Writer *w);
+
+/*
+Reference `count` items of `size` bytes at `offset` in the
+file of `pch`. Returns NULL if they are not all in the file.
+*/
+static const char *
+pch_at(const PCH *pch, int64 offset, int64 count, int64 size);
+
+/*
+Check that `pch` fits `hc` and the files it was made of have
+not changed, and make its headers. Returns 0 with the reason
+in `message` if it cannot be used.
+*/
+static int
+pch_check(PCH *pch, HeaderCache *hc, Strbuf *message);
+
+/*
+Check that the file of `file` has not changed and make its
+header. Returns NULL with the reason in `message` if it has.
+*/
+static Header *
+pch_check_file(PCH *pch, HeaderCache *hc, const PCHFile *file,
+  Strbuf *message);
+
+/*
+Hash of what makes the same file preprocess differently: the
+definitions of the host and the include directories.
+*/
+static uint64
+pch_hash_options(HeaderCache *hc);
+
+/*
+Write the first `count` of `tokens` to `w` and their offsets
+to `to`.
+*/
+static void
+pch_put_tokens(Writer *w, const Tokens *tokens, int count,
+  PCHTokens *to);
+
+/*
+Make `tokens` view the tokens `from` in the file of `pch`.
+Returns 0 if they are not all in the file.
+*/
+static int
+pch_tokens(const PCH *pch, const PCHTokens *from, Tokens *tokens);
+
+/*----------------------------------------------------------*/
+/* VARIABLES                                                */
+/*----------------------------------------------------------*/
+
+/*
+Definitions made before every translation unit, of the host
+uacc runs on.
+*/
+static const char builtin_text[] =
+  "#define __STDC__ 1\n"
+#ifdef __linux__
+  "#define __linux__ 1\n"
+#endif
+#ifdef __unix__
+  "#define __unix__ 1\n"
+#endif
+#ifdef __x86_64__
+  "#define __x86_64__ 1\n"
+#endif
+#ifdef __LP64__
+  "#define __LP64__ 1\n"
+#endif
+  "";
+
+/*
+Marks a missing path in `HeaderCache.paths`.
+*/
+static Header missing_header;
+
+/*
+Names of months in `__DATE__`.
+*/
+static const char *month_names[12] = {
+  "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+  "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+#ifndef UACC_NO_THREADS
+/*
+Held around `localtime`, whose result is shared by threads.
+*/
+static pthread_mutex_t time_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: HEADER CACHE                             */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+hc_add_dir(HeaderCache *hc, const char *dir)
+{
+  assert(hc != NULL);
+  assert(hc->is_inited);
+  assert(dir != NULL);
+  /**/
+  vec_push(&hc->dirs, &dir);
+}
+
+/*----------------------------------------------------------*/
+void
+hc_deinit(HeaderCache *hc)
+{
+  int64 i = 0;
+  /**/
+  assert(hc != NULL);
+  assert(hc->is_inited);
+  /**/
+  for (i = 0; i < hc->num_headers; i++) {
+    hc_free(hc->headers[i]);
+  }
+  for (i = 0; i < hc->retired.length; i++) {
+    mem_free(((void **)hc->retired.at)[i]);
+  }
+  if (hc->paths != NULL) {
+    mem_free(hc->paths);
+  }
+  if (hc->headers != NULL) {
+    mem_free(hc->headers);
+  }
+  vec_deinit(&hc->retired);
+  vec_deinit(&hc->dirs);
+  lock_deinit(&hc->lock);
+  mem_clear(hc, sizeof(*hc));
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_find(HeaderCache *hc, Strview name, const Header *from,
+  Strbuf *path)
+{
+  Header *header = NULL;
+  Strview dir;
+  int64 i = 0;
+  /**/
+  assert(hc != NULL);
+  assert(hc->is_inited);
+  assert(path != NULL);
+  /**/
+  if (name.length > 0 && name.at[0] == '/') {
+    return hc_open(hc, name);
+  }
+  if (from != NULL) {
+    dir = intern_view(hc->interns, from->path_id);
+    dir = sv_get(dir, sv_find_char_end(dir, '/') + 1);
+    sb_clear(path);
+    sb_append_sv(path, dir);
+    sb_append_sv(path, name);
+    header = hc_open(hc, sb_view(path));
+    if (header != NULL) {
+      return header;
+    }
+  }
+  for (i = 0; i < hc->dirs.length; i++) {
+    sb_clear(path);
+    sb_append(path, "%s/", ((char **)hc->dirs.at)[i]);
+    sb_append_sv(path, name);
+    header = hc_open(hc, sb_view(path));
+    if (header != NULL) {
+      return header;
+    }
+  }
+  return NULL;
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_find_file(HeaderCache *hc, unsigned long device,
+  unsigned long inode)
+{
+  Header **headers = NULL;
+  int num_headers = 0;
+  int i = 0;
+  /**/
+  num_headers = ATOMIC_LOAD(&hc->num_headers);
+  headers = ATOMIC_LOAD(&hc->headers);
+  for (i = 0; i < num_headers; i++) {
+    if (headers[i]->src.device == device
+        && headers[i]->src.inode == inode) {
+      return headers[i];
+    }
+  }
+  return NULL;
+}
+
+/*----------------------------------------------------------*/
+int
+hc_find_guard(const Header *header)
+{
+  const Tokens *tokens = NULL;
+  int guard_id = 0;
+  int depth = 0;
+  int id = 0;
+  int i = 0;
+  /**/
+  tokens = &header->tokens;
+  if (tokens->kinds[0] != TK_HASH || tokens->kinds[1] != TK_IDENT) {
+    return 0;
+  }
+  if (tokens->ids[1] == PW_IFNDEF && tokens->kinds[2] == TK_IDENT) {
+    guard_id = tokens->ids[2];
+    i = 3;
+  } else if (tokens->ids[1] == KW_IF && tokens->kinds[2] == TK_NOT
+      && tokens->kinds[3] == TK_IDENT && tokens->ids[3] == PW_DEFINED) {
+    if (tokens->kinds[4] == TK_IDENT) {
+      guard_id = tokens->ids[4];
+      i = 5;
+    } else if (tokens->kinds[4] == TK_LPAREN
+        && tokens->kinds[5] == TK_IDENT
+        && tokens->kinds[6] == TK_RPAREN) {
+      guard_id = tokens->ids[5];
+      i = 7;
+    }
+  }
+  if (guard_id == 0 || guard_id == PW_DEFINED
+      || pp_line_end(tokens, 0) != i) {
+    return 0;
+  }
+  /* The matching `#endif` with no `#elif` or `#else`. */
+  depth = 1;
+  for (; tokens->kinds[i] != TK_EOF; i++) {
+    if (tokens->kinds[i] != TK_HASH || !(tokens->flags[i] & TF_BOL)
+        || tokens->kinds[i + 1] != TK_IDENT
+        || (tokens->flags[i + 1] & TF_BOL)) {
+      continue;
+    }
+    id = tokens->ids[i + 1];
+    if (id == KW_IF || id == PW_IFDEF || id == PW_IFNDEF) {
+      depth++;
+    } else if ((id == PW_ELIF || id == KW_ELSE) && depth == 1) {
+      return 0;
+    } else if (id == PW_ENDIF && --depth == 0) {
+      break;
+    }
+  }
+  if (depth != 0 || tokens->kinds[pp_line_end(tokens, i)] != TK_EOF) {
+    return 0;
+  }
+  return guard_id;
+}
+
+/*----------------------------------------------------------*/
+void
+hc_free(Header *header)
+{
+  if (!header->is_pch) {
+    tok_deinit(&header->tokens);
+  }
+  sb_deinit(&header->errors);
+  src_unload(&header->src);
+  mem_free(header);
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_get(HeaderCache *hc, int path_id)
+{
+  Header **paths = NULL;
+  /**/
+  /* The count first: the array loaded after it is as long. */
+  if (path_id >= ATOMIC_LOAD(&hc->num_paths)) {
+    return NULL;
+  }
+  paths = ATOMIC_LOAD(&hc->paths);
+  return ATOMIC_LOAD(&paths[path_id]);
+}
+
+/*----------------------------------------------------------*/
+void
+hc_init(HeaderCache *hc, Interns *interns)
+{
+  Header *header = NULL;
+  /**/
+  assert(hc != NULL);
+  assert(!hc->is_inited);
+  assert(interns != NULL);
+  assert(interns->is_inited);
+  /**/
+  hc->interns = interns;
+  hc->paths = NULL;
+  hc->num_paths = 0;
+  hc->headers = NULL;
+  hc->num_headers = 0;
+  hc->cap_headers = 0;
+  vec_init(&hc->dirs, sizeof(char *), 0);
+  vec_init(&hc->retired, sizeof(void *), 0);
+  lock_init(&hc->lock);
+  hc->next_base = 0;
+  hc->is_inited = 1;
+  /* Lexed like a file, but never found by `#include`. */
+  header = mem_alloc_zeros(sizeof(*header));
+  header->src.text = sv_array(builtin_text, sizeof(builtin_text) - 1);
+  sb_init(&header->src.path);
+  sb_append(&header->src.path, "%s", "<built-in>");
+  header->src.is_inited = 1;
+  hc_lex(hc, header, intern_sv(interns, sv_cstr("<built-in>")));
+  hc->builtin = hc_publish(hc, header, header->path_id);
+}
+
+/*----------------------------------------------------------*/
+void
+hc_lex(HeaderCache *hc, Header *header, int path_id)
+{
+  PhaseStats *stats = NULL;
+  double start = 0;
+  /**/
+  tok_init(&header->tokens);
+  sb_init(&header->errors);
+  start = time_now();
+  header->is_lex_ok = lex_source(&header->tokens, hc->interns,
+    &header->src, &header->errors
+  );
+  stats = &G->phase_stats[PHASE_LEX];
+  stats->seconds += time_now() - start;
+  stats->bytes += header->src.text.length;
+  stats->items += header->tokens.count;
+  /**/
+  header->path_id = path_id;
+  header->guard_id = hc_find_guard(header);
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_load(HeaderCache *hc, int path_id, const char *path)
+{
+  Header *header = NULL;
+  PhaseStats *stats = NULL;
+  double start = 0;
+  int error = 0;
+  /**/
+  header = mem_alloc_zeros(sizeof(*header));
+  start = time_now();
+  if (!src_load(&header->src, path)) {
+    error = errno;
+    mem_free(header);
+    errno = error;
+    return NULL;
+  }
+  stats = &G->phase_stats[PHASE_LOAD];
+  stats->seconds += time_now() - start;
+  stats->bytes += header->src.text.length;
+  stats->items++;
+  hc_lex(hc, header, path_id);
+  G->pp_stats.num_loads++;
+  return header;
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_locate(HeaderCache *hc, int64 offset)
+{
+  Header **headers = NULL;
+  int64 low = 0;
+  int64 high = 0;
+  int64 mid = 0;
+  /**/
+  assert(hc != NULL);
+  assert(hc->is_inited);
+  assert(0 <= offset);
+  /**/
+  /* Headers of this thread's offsets are all published. */
+  high = ATOMIC_LOAD(&hc->num_headers) - 1;
+  headers = ATOMIC_LOAD(&hc->headers);
+  low = 0;
+  while (low < high) {
+    mid = low + (high - low + 1) / 2;
+    if (headers[mid]->base <= offset) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  assert(offset <= headers[low]->base
+    + headers[low]->src.text.length
+  );
+  return headers[low];
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_open(HeaderCache *hc, Strview path)
+{
+  struct stat st;
+  Header *header = NULL;
+  const char *cpath = NULL;
+  int path_id = 0;
+  int error = 0;
+  /**/
+  assert(hc != NULL);
+  assert(hc->is_inited);
+  /**/
+  path_id = intern_sv(hc->interns, path);
+  header = hc_get(hc, path_id);
+  if (header == &missing_header) {
+    G->pp_stats.num_missing_hits++;
+    errno = ENOENT;
+    return NULL;
+  }
+  if (header != NULL) {
+    return header;
+  }
+  cpath = intern_view(hc->interns, path_id).at;
+  if (strcmp(cpath, "-") != 0) {
+    G->pp_stats.num_stats++;
+    if (stat(cpath, &st) != 0) {
+      error = errno;
+    } else if (S_ISDIR(st.st_mode)) {
+      error = EISDIR;
+    }
+    if (error != 0) {
+      hc_publish(hc, &missing_header, path_id);
+      errno = error;
+      return NULL;
+    }
+    /* The same file by another path. */
+    header = hc_find_file(hc, (unsigned long)st.st_dev,
+      (unsigned long)st.st_ino
+    );
+    if (header != NULL) {
+      lock_acquire(&hc->lock);
+      hc_set_path(hc, path_id, header);
+      lock_release(&hc->lock);
+      return header;
+    }
+  }
+  header = hc_load(hc, path_id, cpath);
+  if (header == NULL) {
+    return NULL;
+  }
+  return hc_publish(hc, header, path_id);
+}
+
+/*----------------------------------------------------------*/
+Header *
+hc_publish(HeaderCache *hc, Header *header, int path_id)
+{
+  Header *winner = NULL;
+  Header **headers = NULL;
+  int count = 0;
+  /**/
+  lock_acquire(&hc->lock);
+  winner = hc_get(hc, path_id);
+  if (winner == NULL && header != &missing_header) {
+    winner = hc_find_file(hc, header->src.device,
+      header->src.inode
+    );
+  }
+  if (winner == NULL && header != &missing_header) {
+    if (hc->num_headers == hc->cap_headers) {
+      count = hc->cap_headers > 0 ? hc->cap_headers * 2 : 64;
+      headers = mem_alloc(mem_size_mul(count, sizeof(Header *)));
+      if (hc->headers != NULL) {
+        memcpy(headers, hc->headers,
+          hc->num_headers * sizeof(Header *)
+        );
+        vec_push(&hc->retired, &hc->headers);
+      }
+      ATOMIC_STORE(&hc->headers, headers);
+      hc->cap_headers = count;
+    }
+    /* One more offset for `TK_EOF`. */
+    header->base = hc->next_base;
+    hc->next_base += header->src.text.length + 1;
+    header->index = hc->num_headers;
+    hc->headers[header->index] = header;
+    ATOMIC_STORE(&hc->num_headers, header->index + 1);
+  }
+  if (winner == NULL) {
+    winner = header;
+  }
+  hc_set_path(hc, path_id, winner);
+  lock_release(&hc->lock);
+  if (winner != header && header != &missing_header) {
+    hc_free(header);
+  }
+  return winner;
+}
+
+/*----------------------------------------------------------*/
+void
+hc_set_path(HeaderCache *hc, int path_id, Header *header)
+{
+  Header **paths = NULL;
+  int count = 0;
+  /**/
+  if (path_id >= hc->num_paths) {
+    count = hc->num_paths > 0 ? hc->num_paths : 256;
+    while (count <= path_id) {
+      count *= 2;
+    }
+    paths = mem_alloc_zeros(mem_size_mul(count, sizeof(Header *)));
+    if (hc->paths != NULL) {
+      memcpy(paths, hc->paths, hc->num_paths * sizeof(Header *));
+      vec_push(&hc->retired, &hc->paths);
+    }
+    ATOMIC_STORE(&hc->paths, paths);
+    ATOMIC_STORE(&hc->num_paths, count);
+  }
+  if (hc->paths[path_id] == NULL) {
+    ATOMIC_STORE(&hc->paths[path_id], header);
+  }
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: PREPROCESSOR                             */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+int
+hex_digit(int ch)
+{
+  if (ch >= '0' && ch <= '9') {
+    return ch - '0';
+  }
+  if (ch >= 'a' && ch <= 'f') {
+    return ch - 'a' + 10;
+  }
+  if (ch >= 'A' && ch <= 'F') {
+    return ch - 'A' + 10;
+  }
+  return 16;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_append_quoted(Strbuf *sb, Strview text)
+{
+  int64 i = 0;
+  /**/
+  sb_append_char(sb, '"');
+  for (i = 0; i < text.length; i++) {
+    if (text.at[i] == '"' || text.at[i] == '\\') {
+      sb_append_char(sb, '\\');
+    }
+    sb_append_char(sb, text.at[i]);
+  }
+  sb_append_char(sb, '"');
+}
+
+/*----------------------------------------------------------*/
+void
+pp_apply_pch(Preprocessor *pp)
+{
+  const PCH *pch = NULL;
+  Tokens *out = NULL;
+  int64 scratch = 0;
+  int64 offset = 0;
+  int count = 0;
+  int i = 0;
+  /**/
+  pch = pp->pch;
+  out = pp->out;
+  for (i = 0; i < pch->num_macros; i++) {
+    map_set(&pp->macros, pch->macro_ids[i], &pch->macros[i]);
+  }
+  for (i = 0; i < pch->num_headers; i++) {
+    *pp_mark(pp, pch->headers[i]) |= pch->marks[i];
+  }
+  scratch = pp->scratch.length;
+  sb_append_sv(&pp->scratch, pch->scratch);
+  count = pch->out.count;
+  if (count == 0) {
+    return;
+  }
+  tok_reserve(out, out->count + count);
+  memcpy(out->kinds + out->count, pch->out.kinds, count);
+  memcpy(out->flags + out->count, pch->out.flags, count);
+  memcpy(out->lengths + out->count, pch->out.lengths,
+    count * sizeof(int)
+  );
+  memcpy(out->ids + out->count, pch->out.ids, count * sizeof(int));
+  for (i = 0; i < count; i++) {
+    offset = pch->out.offsets[i];
+    if (pch->out.flags[i] & TF_SCRATCH) {
+      offset += scratch;
+    } else if (offset >= pch->first_base) {
+      offset += pch->delta;
+    }
+    out->offsets[out->count + i] = offset;
+  }
+  out->count += count;
+  G->pp_stats.num_pch_tokens += count;
+  if (pp->writer != NULL && out->count >= PP_PRINT_TOKENS) {
+    pp_print_out(pp);
+  }
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_builtin(Preprocessor *pp, const PPToken *name, PPToken *rest)
+{
+  PPToken *tok = NULL;
+  Strview path;
+  int64 start = 0;
+  int64 line = 0;
+  int64 column = 0;
+  int flags = 0;
+  /**/
+  flags = name->flags & (TF_SPACE | TF_BOL);
+  start = pp->scratch.length;
+  switch (name->id) {
+  case PW_MACRO_DATE:
+    tok = pp_scratch_token(pp, TK_STRING, pp->date_offset,
+      pp->time_offset - pp->date_offset, flags
+    );
+    break;
+  case PW_MACRO_FILE:
+    path = pp_line_path(pp, pp->site, &line);
+    pp_append_quoted(&pp->scratch, path);
+    tok = pp_scratch_token(pp, TK_STRING, start,
+      pp->scratch.length - start, flags
+    );
+    break;
+  case PW_MACRO_LINE:
+    src_locate(&pp->site->src,
+      pp->site->tokens.offsets[pp->site_token], &line, &column
+    );
+    pp_line_path(pp, pp->site, &line);
+    sb_append_int(&pp->scratch, (long)line);
+    tok = pp_scratch_token(pp, TK_NUMBER, start,
+      pp->scratch.length - start, flags
+    );
+    break;
+  default:
+    assert(name->id == PW_MACRO_TIME);
+    tok = pp_scratch_token(pp, TK_STRING, pp->time_offset,
+      (int64)sizeof("\"hh:mm:ss\"") - 1, flags
+    );
+    break;
+  }
+  tok->context = name->context;
+  tok->site = name->site;
+  tok->next = rest;
+  return tok;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_check_token(Preprocessor *pp, Header *header, int i)
+{
+  if (!(header->tokens.flags[i] & TF_UNCLOSED)) {
+    return;
+  }
+  pp_error(pp, header, i, header->tokens.kinds[i] == TK_STRING
+    ? "missing terminating '\"' character"
+    : "missing terminating ' character"
+  );
+}
+
+/*----------------------------------------------------------*/
+PPArg *
+pp_collect_args(Preprocessor *pp, const Macro *macro,
+  const PPToken *name, PPToken **rparen, PPInput *input)
+{
+  PPArg *args = NULL;
+  PPToken **tail = NULL;
+  PPToken *prev = NULL;
+  PPToken *tok = NULL;
+  PPToken *copy = NULL;
+  Strview text;
+  int num_args = 0;
+  int is_ok = 0;
+  int depth = 0;
+  int n = 0;
+  /**/
+  num_args = macro->num_params > 0 ? macro->num_params : 1;
+  args = arena_alloc_zeros(&pp->expand_arena,
+    mem_size_mul(num_args, sizeof(*args))
+  );
+  tail = &args[0].raw;
+  prev = *rparen;
+  *rparen = NULL;
+  for (;;) {
+    tok = prev->next;
+    if (tok == NULL && input != NULL) {
+      tok = pp_pull(pp, input);
+      prev->next = tok;
+    }
+    if (tok == NULL) {
+      text = pp_tok_spell(pp, name);
+      sb_clear(&pp->message);
+      sb_append(&pp->message,
+        "unterminated argument list invoking macro '%.*s'",
+        (int)text.length, text.at
+      );
+      pp_error_token(pp, name, pp->message.at);
+      return NULL;
+    }
+    prev = tok;
+    if (tok->kind == TK_RPAREN && depth == 0) {
+      break;
+    }
+    if (tok->kind == TK_COMMA && depth == 0) {
+      n++;
+      tail = n < num_args ? &args[n].raw : NULL;
+      continue;
+    }
+    if (tok->kind == TK_LPAREN) {
+      depth++;
+    } else if (tok->kind == TK_RPAREN) {
+      depth--;
+    }
+    if (tail != NULL) {
+      /* New lines in arguments are spaces. */
+      copy = pp_copy(pp, tok);
+      if (copy->flags & TF_BOL) {
+        copy->flags = (copy->flags & ~TF_BOL) | TF_SPACE;
+      }
+      *tail = copy;
+      tail = &copy->next;
+    }
+  }
+  *rparen = tok;
+  if (macro->num_params == 0) {
+    is_ok = n == 0 && args[0].raw == NULL;
+  } else {
+    is_ok = n + 1 == macro->num_params;
+  }
+  if (!is_ok) {
+    text = pp_tok_spell(pp, name);
+    sb_clear(&pp->message);
+    sb_append(&pp->message, "macro '%.*s' expects %d argument%s",
+      (int)text.length, text.at, macro->num_params,
+      macro->num_params == 1 ? "" : "s"
+    );
+    pp_error_token(pp, name, pp->message.at);
+    return NULL;
+  }
+  return args;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_conditional(Preprocessor *pp, PPFile *file, int i, int end)
+{
+  const Tokens *tokens = NULL;
+  PPCond *cond = NULL;
+  PPCond new_cond;
+  int name = 0;
+  int id = 0;
+  /**/
+  tokens = file->tokens;
+  id = tokens->ids[i + 1];
+  name = i + 2;
+  if (id == KW_IF || id == PW_IFDEF || id == PW_IFNDEF) {
+    new_cond.token = i;
+    new_cond.was_active = file->is_active;
+    new_cond.is_taken = !file->is_active;
+    new_cond.has_else = 0;
+    if (!file->is_active) {
+      vec_push(&file->conds, &new_cond);
+      return;
+    }
+    if (id == KW_IF) {
+      new_cond.is_taken = pp_eval(pp, file, name, end);
+    } else if (name >= end || tokens->kinds[name] != TK_IDENT) {
+      pp_error(pp, file->header, i + 1,
+        "macro name must be an identifier"
+      );
+    } else {
+      new_cond.is_taken = map_get(&pp->macros, tokens->ids[name])
+        != NULL;
+      if (id == PW_IFNDEF) {
+        new_cond.is_taken = !new_cond.is_taken;
+      }
+    }
+    vec_push(&file->conds, &new_cond);
+    file->is_active = new_cond.is_taken;
+    return;
+  }
+  if (file->conds.length == 0) {
+    pp_error(pp, file->header, i + 1, id == PW_ENDIF
+      ? "#endif without #if"
+      : id == KW_ELSE ? "#else without #if" : "#elif without #if"
+    );
+    return;
+  }
+  cond = vec_at(&file->conds, -1);
+  if (id == PW_ENDIF) {
+    file->is_active = cond->was_active;
+    vec_pop(&file->conds);
+    return;
+  }
+  if (cond->has_else) {
+    pp_error(pp, file->header, i + 1, id == KW_ELSE
+      ? "#else after #else"
+      : "#elif after #else"
+    );
+  }
+  if (id == KW_ELSE) {
+    cond->has_else = 1;
+    file->is_active = !cond->is_taken;
+    cond->is_taken = 1;
+  } else if (cond->is_taken) {
+    file->is_active = 0;
+  } else {
+    cond->is_taken = pp_eval(pp, file, name, end);
+    file->is_active = cond->is_taken;
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+pp_context_has(const PPContext *context, int id)
+{
+  for (; context != NULL; context = context->next) {
+    if (context->id == id) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*----------------------------------------------------------*/
+const PPContext *
+pp_context_push(Preprocessor *pp, const PPContext *context, int id)
+{
+  PPContext *node = NULL;
+  /**/
+  node = arena_alloc(&pp->expand_arena, sizeof(*node));
+  node->next = context;
+  node->id = id;
+  return node;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_copy(Preprocessor *pp, const PPToken *tok)
+{
+  PPToken *copy = NULL;
+  /**/
+  copy = arena_alloc(&pp->expand_arena, sizeof(*copy));
+  *copy = *tok;
+  copy->next = NULL;
+  return copy;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_copy_list(Preprocessor *pp, const PPToken *list)
+{
+  PPToken *head = NULL;
+  PPToken **tail = NULL;
+  /**/
+  tail = &head;
+  for (; list != NULL; list = list->next) {
+    *tail = pp_copy(pp, list);
+    tail = &(*tail)->next;
+  }
+  return head;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_define(Preprocessor *pp, PPFile *file, int i, int end)
+{
+  const Tokens *tokens = NULL;
+  Macro *macro = NULL;
+  Macro *old = NULL;
+  Strview name;
+  int num_params = 0;
+  int j = 0;
+  int k = 0;
+  int m = 0;
+  /**/
+  tokens = file->tokens;
+  if (i >= end || tokens->kinds[i] != TK_IDENT) {
+    pp_error(pp, file->header, i - 1, "macro name must be an identifier");
+    return;
+  }
+  if (tokens->ids[i] == PW_DEFINED) {
+    pp_error(pp, file->header, i, "'defined' cannot be a macro name");
+    return;
+  }
+  macro = arena_alloc(&pp->arena, sizeof(*macro));
+  macro->header = file->header;
+  macro->name = i;
+  macro->params = NULL;
+  macro->num_params = -1;
+  j = i + 1;
+  /* Parameters follow the name without a space. */
+  if (j < end && tokens->kinds[j] == TK_LPAREN
+      && !(tokens->flags[j] & TF_SPACE)) {
+    for (j++; j < end && tokens->kinds[j] != TK_RPAREN; j++) {
+      if (tokens->kinds[j] != TK_IDENT) {
+        pp_error(pp, file->header, j, "expected a parameter name");
+        return;
+      }
+      num_params++;
+      if (j + 2 < end && tokens->kinds[j + 1] == TK_COMMA
+          && tokens->kinds[j + 2] == TK_IDENT) {
+        j++;
+      } else if (j + 1 < end && tokens->kinds[j + 1] == TK_COMMA) {
+        pp_error(pp, file->header, j + 1, "expected a parameter name");
+        return;
+      } else if (j + 1 < end && tokens->kinds[j + 1] != TK_RPAREN) {
+        pp_error(pp, file->header, j + 1, "expected ',' or ')'");
+        return;
+      }
+    }
+    if (j >= end) {
+      pp_error(pp, file->header, end - 1, "missing ')' after parameters");
+      return;
+    }
+    macro->params = arena_alloc(&pp->arena,
+      mem_size_mul(num_params + 1, sizeof(int))
+    );
+    macro->num_params = 0;
+    for (k = i + 2; k < j; k += 2) {
+      macro->params[macro->num_params++] = tokens->ids[k];
+    }
+    j++;
+  }
+  for (k = 1; k < macro->num_params; k++) {
+    for (m = 0; m < k; m++) {
+      if (macro->params[m] == macro->params[k]) {
+        pp_error(pp, file->header, i + 2 + k * 2,
+          "duplicate macro parameter"
+        );
+        return;
+      }
+    }
+  }
+  macro->first = j;
+  macro->num_body = end - j;
+  for (k = j; k < end; k++) {
+    pp_check_token(pp, file->header, k);
+    if (tokens->kinds[k] == TK_HASH && macro->num_params >= 0
+        && (k + 1 >= end || pp_param(macro, k + 1) < 0)) {
+      pp_error(pp, file->header, k,
+        "'#' is not followed by a macro parameter"
+      );
+      return;
+    }
+  }
+  if (j < end && (tokens->kinds[j] == TK_HASH_HASH
+      || tokens->kinds[end - 1] == TK_HASH_HASH)) {
+    pp_error(pp, file->header, tokens->kinds[j] == TK_HASH_HASH
+      ? j : end - 1, "'##' cannot appear at either end of a macro"
+    );
+    return;
+  }
+  old = map_get(&pp->macros, tokens->ids[i]);
+  if (old != NULL && !pp_macro_equal(old, macro)) {
+    name = tok_text(tokens, i, file->header->src.text);
+    sb_clear(&pp->message);
+    sb_append(&pp->message, "'%.*s' redefined differently",
+      (int)name.length, name.at
+    );
+    pp_error(pp, file->header, i, pp->message.at);
+  }
+  map_set(&pp->macros, tokens->ids[i], macro);
+}
+
+/*----------------------------------------------------------*/
+void
+pp_deinit(Preprocessor *pp)
+{
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  /**/
+  map_deinit(&pp->macros);
+  arena_deinit(&pp->arena);
+  arena_deinit(&pp->expand_arena);
+  sb_deinit(&pp->scratch);
+  sb_deinit(&pp->message);
+  sb_deinit(&pp->errors);
+  sb_deinit(&pp->spelling);
+  sb_deinit(&pp->path);
+  vec_deinit(&pp->marks);
+  vec_deinit(&pp->sites);
+  mem_clear(pp, sizeof(*pp));
+}
+
+/*----------------------------------------------------------*/
+int
+pp_directive(Preprocessor *pp, PPFile *file, int i)
+{
+  const Tokens *tokens = NULL;
+  Strview text;
+  int64 first = 0;
+  int end = 0;
+  int id = 0;
+  /**/
+  tokens = file->tokens;
+  end = pp_line_end(tokens, i);
+  if (i + 1 == end) {
+    /* The null directive. */
+    return end;
+  }
+  if (tokens->kinds[i + 1] == TK_IDENT) {
+    id = tokens->ids[i + 1];
+  }
+  switch (id) {
+  case KW_IF:
+  case KW_ELSE:
+  case PW_ELIF:
+  case PW_ENDIF:
+  case PW_IFDEF:
+  case PW_IFNDEF:
+    pp_conditional(pp, file, i, end);
+    return end;
+  }
+  if (!file->is_active) {
+    return end;
+  }
+  switch (id) {
+  case PW_DEFINE:
+    pp_define(pp, file, i + 2, end);
+    break;
+  case PW_ERROR:
+    sb_clear(&pp->message);
+    sb_append(&pp->message, "%s", "#error");
+    if (i + 2 < end) {
+      first = tokens->offsets[i + 2];
+      text = sv_array(file->header->src.text.at + first,
+        tokens->offsets[end - 1] + tokens->lengths[end - 1] - first
+      );
+      sb_append_char(&pp->message, ' ');
+      sb_append_sv(&pp->message, text);
+    }
+    pp_error(pp, file->header, i + 1, pp->message.at);
+    break;
+  case PW_INCLUDE:
+    pp_include(pp, file, i + 2, end);
+    break;
+  case PW_LINE:
+    pp_line(pp, file, i + 2, end);
+    break;
+  case PW_PRAGMA:
+    if (i + 2 < end && tokens->kinds[i + 2] == TK_IDENT
+        && tokens->ids[i + 2] == PW_ONCE) {
+      *pp_mark(pp, file->header) |= PP_MARK_ONCE;
+      break;
+    }
+    if (pp->writer == NULL) {
+      break;
+    }
+    /* Printed text keeps the pragmas for the next compiler. */
+    for (; i < end; i++) {
+      tok_push(pp->out, tokens->kinds[i], tokens->flags[i],
+        file->header->base + tokens->offsets[i], tokens->lengths[i],
+        tokens->ids[i]
+      );
+    }
+    break;
+  case PW_UNDEF:
+    if (i + 2 >= end || tokens->kinds[i + 2] != TK_IDENT) {
+      pp_error(pp, file->header, i + 1,
+        "macro name must be an identifier"
+      );
+      break;
+    }
+    map_remove(&pp->macros, tokens->ids[i + 2]);
+    break;
+  default:
+    pp_error(pp, file->header, i + 1, "invalid preprocessing directive");
+    break;
+  }
+  return end;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_error(Preprocessor *pp, Header *header, int i, const char *message)
+{
+  pp_error_at(pp, header, header->tokens.offsets[i], message);
+}
+
+/*----------------------------------------------------------*/
+void
+pp_error_at(Preprocessor *pp, Header *header, int64 offset,
+  const char *message)
+{
+  Strview path;
+  int64 line = 0;
+  int64 column = 0;
+  /**/
+  src_locate(&header->src, offset, &line, &column);
+  path = pp_line_path(pp, header, &line);
+  sb_append(&pp->errors, "%.*s:%ld:%ld: error: %s\n",
+    (int)path.length, path.at, (long)line, (long)column, message
+  );
+  pp->num_errors++;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_error_token(Preprocessor *pp, const PPToken *tok,
+  const char *message)
+{
+  if (tok->header != NULL) {
+    pp_error_at(pp, tok->header, tok->offset, message);
+  } else {
+    pp_error(pp, pp->site, pp->site_token, message);
+  }
+}
+
+/*----------------------------------------------------------*/
+int
+pp_eval(Preprocessor *pp, PPFile *file, int i, int end)
+{
+  ArenaMark mark;
+  PPExpr e;
+  PPValue value;
+  PPToken *list = NULL;
+  PPToken *tok = NULL;
+  PPToken *name = NULL;
+  int count = 0;
+  /**/
+  mark = arena_mark(&pp->expand_arena);
+  pp->site = file->header;
+  pp->site_token = i - 1;
+  list = pp_line_tokens(pp, file->header, i, end);
+  /* The operand of `defined` is not expanded. */
+  for (tok = list; tok != NULL; tok = tok->next) {
+    if (tok->kind != TK_IDENT || tok->id != PW_DEFINED) {
+      continue;
+    }
+    name = tok->next;
+    if (name != NULL && name->kind == TK_LPAREN) {
+      name = name->next;
+    }
+    if (name != NULL && name->kind == TK_IDENT) {
+      name->flags |= PP_PAINTED;
+    }
+  }
+  list = pp_expand(pp, list, NULL, 0);
+  for (tok = list; tok != NULL; tok = tok->next) {
+    count++;
+  }
+  if (count == 0) {
+    pp_error(pp, file->header, i - 1, "#if with no expression");
+    arena_rewind(&pp->expand_arena, mark);
+    return 0;
+  }
+  e.pp = pp;
+  e.tokens = arena_alloc(&pp->expand_arena,
+    mem_size_mul(count, sizeof(PPToken))
+  );
+  e.pos = 0;
+  e.end = count;
+  e.is_error = 0;
+  count = 0;
+  for (tok = list; tok != NULL; tok = tok->next) {
+    e.tokens[count++] = *tok;
+  }
+  value = pp_eval_cond(&e, 1);
+  if (!e.is_error && e.pos < e.end) {
+    pp_eval_error(&e, "missing binary operator in #if");
+  }
+  arena_rewind(&pp->expand_arena, mark);
+  return !e.is_error && value.bits != 0;
+}
+
+/*----------------------------------------------------------*/
+PPValue
+pp_eval_apply(PPExpr *e, int kind, int op, PPValue a, PPValue b,
+  int is_live)
+{
+  PPValue value;
+  unsigned long x = 0;
+  unsigned long y = 0;
+  int width = 0;
+  /**/
+  x = a.bits;
+  y = b.bits;
+  width = sizeof(x) * CHAR_BIT;
+  value.is_unsigned = a.is_unsigned || b.is_unsigned;
+  switch (kind) {
+  case TK_STAR:
+    value.bits = x * y;
+    break;
+  case TK_SLASH:
+  case TK_PERCENT:
+    if (y == 0) {
+      if (is_live) {
+        e->pos = op;
+        pp_eval_error(e, "division by zero in #if");
+      }
+      value.bits = 0;
+    } else if (value.is_unsigned) {
+      value.bits = kind == TK_SLASH ? x / y : x % y;
+    } else if ((long)y == -1) {
+      /* LONG_MIN / -1 wraps around. */
+      value.bits = kind == TK_SLASH ? 0 - x : 0;
+    } else {
+      value.bits = (unsigned long)(kind == TK_SLASH
+        ? (long)x / (long)y
+        : (long)x % (long)y
+      );
+    }
+    break;
+  case TK_PLUS:
+    value.bits = x + y;
+    break;
+  case TK_MINUS:
+    value.bits = x - y;
+    break;
+  case TK_SHL:
+  case TK_SHR:
+    /* The type is of the left operand. */
+    value.is_unsigned = a.is_unsigned;
+    if (!b.is_unsigned && (long)y < 0) {
+      kind = kind == TK_SHL ? TK_SHR : TK_SHL;
+      y = 0 - y;
+    }
+    if (kind == TK_SHL) {
+      value.bits = y >= (unsigned long)width ? 0 : x << y;
+    } else if (!a.is_unsigned && (long)x < 0) {
+      value.bits = y >= (unsigned long)width ? ~0UL : ~(~x >> y);
+    } else {
+      value.bits = y >= (unsigned long)width ? 0 : x >> y;
+    }
+    break;
+  case TK_LT:
+  case TK_GT:
+  case TK_LE:
+  case TK_GE:
+    if (kind == TK_GT || kind == TK_LE) {
+      x = b.bits;
+      y = a.bits;
+    }
+    if (value.is_unsigned) {
+      value.bits = x < y;
+    } else {
+      value.bits = (long)x < (long)y;
+    }
+    if (kind == TK_LE || kind == TK_GE) {
+      value.bits = !value.bits;
+    }
+    value.is_unsigned = 0;
+    break;
+  case TK_EQ:
+    value.bits = x == y;
+    value.is_unsigned = 0;
+    break;
+  case TK_NE:
+    value.bits = x != y;
+    value.is_unsigned = 0;
+    break;
+  case TK_AMP:
+    value.bits = x & y;
+    break;
+  case TK_CARET:
+    value.bits = x ^ y;
+    break;
+  case TK_PIPE:
+    value.bits = x | y;
+    break;
+  default:
+    assert(0);
+    value.bits = 0;
+    break;
+  }
+  return value;
+}
+
+/*----------------------------------------------------------*/
+PPValue
+pp_eval_binary(PPExpr *e, int min_prec, int is_live)
+{
+  PPValue left;
+  PPValue right;
+  int prec = 0;
+  int kind = 0;
+  int op = 0;
+  /**/
+  left = pp_eval_unary(e, is_live);
+  while (!e->is_error && e->pos < e->end) {
+    kind = e->tokens[e->pos].kind;
+    prec = pp_precedence(kind);
+    if (prec == 0 || prec < min_prec) {
+      break;
+    }
+    op = e->pos;
+    e->pos++;
+    if (kind == TK_AND || kind == TK_OR) {
+      right = pp_eval_binary(e, prec + 1, is_live
+        && (kind == TK_AND) == (left.bits != 0)
+      );
+      if (kind == TK_AND) {
+        left.bits = left.bits != 0 && right.bits != 0;
+      } else {
+        left.bits = left.bits != 0 || right.bits != 0;
+      }
+      left.is_unsigned = 0;
+    } else {
+      right = pp_eval_binary(e, prec + 1, is_live);
+      left = pp_eval_apply(e, kind, op, left, right, is_live);
+    }
+  }
+  return left;
+}
+
+/*----------------------------------------------------------*/
+PPValue
+pp_eval_char(PPExpr *e)
+{
+  PPValue value;
+  Strview text;
+  unsigned long ch = 0;
+  int num_chars = 0;
+  int is_wide = 0;
+  int digits = 0;
+  int i = 0;
+  /**/
+  value.bits = 0;
+  value.is_unsigned = 0;
+  if (e->tokens[e->pos].flags & TF_UNCLOSED) {
+    pp_eval_error(e, "missing terminating ' character");
+    return value;
+  }
+  text = pp_tok_spell(e->pp, &e->tokens[e->pos]);
+  is_wide = text.at[0] == 'L';
+  text = sv_cut(sv_cut_end(text, 1), is_wide + 1);
+  for (i = 0; i < text.length; num_chars++) {
+    ch = (unsigned char)text.at[i++];
+    if (ch == '\\' && i < text.length) {
+      ch = (unsigned char)text.at[i++];
+      switch (ch) {
+      case 'a': ch = '\a'; break;
+      case 'b': ch = '\b'; break;
+      case 'f': ch = '\f'; break;
+      case 'n': ch = '\n'; break;
+      case 'r': ch = '\r'; break;
+      case 't': ch = '\t'; break;
+      case 'v': ch = '\v'; break;
+      case 'x':
+        ch = 0;
+        while (i < text.length && hex_digit(text.at[i]) < 16) {
+          ch = ch * 16 + hex_digit(text.at[i++]);
+        }
+        break;
+      default:
+        if (ch >= '0' && ch <= '7') {
+          ch -= '0';
+          for (digits = 1; digits < 3 && i < text.length
+              && text.at[i] >= '0' && text.at[i] <= '7'; digits++) {
+            ch = ch * 8 + (text.at[i++] - '0');
+          }
+        }
+        break;
+      }
+    }
+    if (is_wide) {
+      value.bits = ch;
+    } else {
+      value.bits = value.bits << CHAR_BIT | (ch & UCHAR_MAX);
+    }
+  }
+  if (num_chars == 0) {
+    pp_eval_error(e, "empty character constant in #if");
+  } else if (num_chars == 1 && !is_wide) {
+    /* Plain `char` may be signed. */
+    value.bits = (unsigned long)(long)(char)value.bits;
+  }
+  e->pos++;
+  return value;
+}
+
+/*----------------------------------------------------------*/
+PPValue
+pp_eval_cond(PPExpr *e, int is_live)
+{
+  PPValue value;
+  PPValue a;
+  PPValue b;
+  /**/
+  value = pp_eval_binary(e, 1, is_live);
+  if (e->is_error || e->pos >= e->end
+      || e->tokens[e->pos].kind != TK_QUESTION) {
+    return value;
+  }
+  e->pos++;
+  a = pp_eval_cond(e, is_live && value.bits != 0);
+  if (!e->is_error && (e->pos >= e->end
+      || e->tokens[e->pos].kind != TK_COLON)) {
+    pp_eval_error(e, "expected ':' in #if");
+  }
+  if (e->is_error) {
+    return value;
+  }
+  e->pos++;
+  b = pp_eval_cond(e, is_live && value.bits == 0);
+  value.bits = value.bits != 0 ? a.bits : b.bits;
+  value.is_unsigned = a.is_unsigned || b.is_unsigned;
+  return value;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_eval_error(PPExpr *e, const char *message)
+{
+  if (e->is_error) {
+    return;
+  }
+  if (e->pos >= e->end) {
+    e->pos = e->end - 1;
+  }
+  pp_error_token(e->pp, &e->tokens[e->pos], message);
+  e->is_error = 1;
+}
+
+/*----------------------------------------------------------*/
+PPValue
+pp_eval_number(PPExpr *e)
+{
+  PPValue value;
+  Strview text;
+  unsigned long digit = 0;
+  int base = 0;
+  int is_overflow = 0;
+  int has_u = 0;
+  int has_l = 0;
+  int64 i = 0;
+  int ch = 0;
+  /**/
+  value.bits = 0;
+  value.is_unsigned = 0;
+  text = pp_tok_spell(e->pp, &e->tokens[e->pos]);
+  base = 10;
+  if (text.at[0] == '0' && text.length > 1
+      && (text.at[1] == 'x' || text.at[1] == 'X')) {
+    base = 16;
+    i = 2;
+  } else if (text.at[0] == '0') {
+    base = 8;
+  }
+  for (; i < text.length; i++) {
+    digit = hex_digit(text.at[i]);
+    if (digit >= (unsigned long)base) {
+      break;
+    }
+    if (value.bits > (ULONG_MAX - digit) / base) {
+      is_overflow = 1;
+    }
+    value.bits = value.bits * base + digit;
+  }
+  for (; i < text.length; i++) {
+    ch = text.at[i];
+    if ((ch == 'u' || ch == 'U') && !has_u) {
+      has_u = 1;
+    } else if ((ch == 'l' || ch == 'L') && !has_l) {
+      has_l = 1;
+    } else {
+      break;
+    }
+  }
+  if (i < text.length || (base == 16 && text.length == 2)) {
+    pp_eval_error(e, "invalid integer constant in #if");
+  } else if (is_overflow) {
+    pp_eval_error(e, "integer constant is too large");
+  }
+  value.is_unsigned = has_u || value.bits > LONG_MAX;
+  e->pos++;
+  return value;
+}
+
+/*----------------------------------------------------------*/
+PPValue
+pp_eval_unary(PPExpr *e, int is_live)
+{
+  PPToken *tokens = NULL;
+  PPValue value;
+  int has_paren = 0;
+  int kind = 0;
+  /**/
+  tokens = e->tokens;
+  value.bits = 0;
+  value.is_unsigned = 0;
+  if (e->is_error) {
+    return value;
+  }
+  if (e->pos >= e->end) {
+    pp_eval_error(e, "missing expression in #if");
+    return value;
+  }
+  kind = tokens[e->pos].kind;
+  switch (kind) {
+  case TK_PLUS:
+  case TK_MINUS:
+  case TK_TILDE:
+  case TK_NOT:
+    e->pos++;
+    value = pp_eval_unary(e, is_live);
+    if (kind == TK_MINUS) {
+      value.bits = 0 - value.bits;
+    } else if (kind == TK_TILDE) {
+      value.bits = ~value.bits;
+    } else if (kind == TK_NOT) {
+      value.bits = value.bits == 0;
+      value.is_unsigned = 0;
+    }
+    return value;
+  case TK_LPAREN:
+    e->pos++;
+    value = pp_eval_cond(e, is_live);
+    if (!e->is_error && (e->pos >= e->end
+        || tokens[e->pos].kind != TK_RPAREN)) {
+      pp_eval_error(e, "missing ')' in #if");
+    }
+    e->pos++;
+    return value;
+  case TK_NUMBER:
+    return pp_eval_number(e);
+  case TK_CHAR:
+    return pp_eval_char(e);
+  case TK_IDENT:
+    break;
+  default:
+    pp_eval_error(e, "invalid token in #if");
+    return value;
+  }
+  e->pos++;
+  if (tokens[e->pos - 1].id != PW_DEFINED) {
+    /* Identifiers left in `#if` are 0. */
+    return value;
+  }
+  if (e->pos < e->end && tokens[e->pos].kind == TK_LPAREN) {
+    has_paren = 1;
+    e->pos++;
+  }
+  if (e->pos >= e->end || tokens[e->pos].kind != TK_IDENT) {
+    pp_eval_error(e, "macro name must be an identifier");
+    return value;
+  }
+  value.bits = map_get(&e->pp->macros, tokens[e->pos].id) != NULL;
+  e->pos++;
+  if (has_paren && (e->pos >= e->end
+      || tokens[e->pos].kind != TK_RPAREN)) {
+    pp_eval_error(e, "missing ')' after defined");
+  }
+  e->pos += has_paren;
+  return value;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_expand(Preprocessor *pp, PPToken *list, PPInput *input,
+  int to_out)
+{
+  const Macro *macro = NULL;
+  PPToken *head = NULL;
+  PPToken **tail = NULL;
+  PPToken *tok = NULL;
+  PPSite site;
+  int flags = 0;
+  /**/
+  tail = &head;
+  while (list != NULL) {
+    tok = list;
+    list = tok->next;
+    macro = NULL;
+    if (tok->kind == TK_IDENT) {
+      macro = map_get(&pp->macros, tok->id);
+    }
+    if (macro != NULL && ((tok->flags & PP_PAINTED)
+        || pp_context_has(tok->context, tok->id))) {
+      /* Met in its own expansion, the name stays for good. */
+      tok->flags |= PP_PAINTED;
+      macro = NULL;
+    }
+    if (macro != NULL && macro->num_params >= 0) {
+      /* A function-like macro needs `(` next. */
+      if (list == NULL && input != NULL) {
+        list = pp_pull(pp, input);
+      }
+      if (list == NULL || list->kind != TK_LPAREN) {
+        macro = NULL;
+      }
+    }
+    if (macro != NULL) {
+      list = pp_expand_macro(pp, macro, tok, list, input);
+      continue;
+    }
+    if (to_out) {
+      flags = tok->flags & ~PP_PAINTED;
+      if (tok->header == NULL) {
+        flags |= TF_SCRATCH | TF_EXPANDED;
+      } else if (tok->context != NULL) {
+        flags |= TF_EXPANDED;
+      }
+      if ((flags & TF_BOL) && (flags & TF_EXPANDED)
+          && pp->writer != NULL) {
+        site.token = pp->out->count;
+        site.offset = tok->site;
+        vec_push(&pp->sites, &site);
+      }
+      tok_push(pp->out, tok->kind, flags,
+        tok->header != NULL ? tok->header->base + tok->offset
+          : tok->offset,
+        tok->length, tok->id
+      );
+    } else {
+      *tail = tok;
+      tail = &tok->next;
+    }
+  }
+  *tail = NULL;
+  return head;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_expand_macro(Preprocessor *pp, const Macro *macro,
+  const PPToken *name, PPToken *rest, PPInput *input)
+{
+  const PPContext *context = NULL;
+  PPToken *rparen = NULL;
+  PPToken *copy = NULL;
+  PPArg *args = NULL;
+  /**/
+  G->pp_stats.num_expansions++;
+  if (macro->header == NULL) {
+    return pp_builtin(pp, name, rest);
+  }
+  if (macro->num_params < 0) {
+    context = pp_context_push(pp, name->context, name->id);
+    return pp_subst(pp, macro, NULL, context, name, rest);
+  }
+  rparen = rest;
+  args = pp_collect_args(pp, macro, name, &rparen, input);
+  if (args == NULL) {
+    /* A wrong invocation stays as it is. */
+    copy = pp_copy(pp, name);
+    copy->flags |= PP_PAINTED;
+    copy->next = rest;
+    return copy;
+  }
+  /* Expansions that ended before `)` are over. */
+  context = pp_context_push(pp, rparen->context, name->id);
+  return pp_subst(pp, macro, args, context, name, rparen->next);
+}
+
+/*----------------------------------------------------------*/
+void
+pp_file(Preprocessor *pp, Header *header)
+{
+  const Tokens *tokens = NULL;
+  unsigned char *marks = NULL;
+  ArenaMark mark;
+  PPFile *parent = NULL;
+  PPFile file;
+  PPInput input;
+  PPCond *cond = NULL;
+  int i = 0;
+  /**/
+  mem_clear(&file, sizeof(file));
+  file.header = header;
+  file.tokens = &header->tokens;
+  vec_init(&file.conds, sizeof(PPCond), 0);
+  file.is_active = 1;
+  parent = pp->file;
+  if (pp->writer != NULL && parent != NULL
+      && parent->line_path.at != NULL) {
+    /* The lines of the parent are printed as `#line` set. */
+    pp_print_out(pp);
+  }
+  pp->file = &file;
+  marks = pp_mark(pp, header);
+  if (!(*marks & PP_MARK_ENTERED)) {
+    /* The same messages in every unit however it is cached. */
+    sb_append_sv(&pp->errors, sb_view(&header->errors));
+    *marks |= PP_MARK_ENTERED;
+  }
+  if (!header->is_lex_ok) {
+    pp->num_errors++;
+  }
+  G->phase_stats[PHASE_PP].bytes += header->src.text.length;
+  tokens = file.tokens;
+  i = 0;
+  while (tokens->kinds[i] != TK_EOF) {
+    if (pp->writer != NULL && pp->out->count >= PP_PRINT_TOKENS) {
+      pp_print_out(pp);
+    }
+    if (tokens->kinds[i] == TK_HASH && (tokens->flags[i] & TF_BOL)) {
+      i = pp_directive(pp, &file, i);
+      continue;
+    }
+    if (!file.is_active) {
+      /* Only directives matter in skipped groups. */
+      for (i++; tokens->kinds[i] != TK_EOF; i++) {
+        if (tokens->kinds[i] == TK_HASH
+            && (tokens->flags[i] & TF_BOL)) {
+          break;
+        }
+      }
+      continue;
+    }
+    if (tokens->kinds[i] == TK_IDENT
+        && map_get(&pp->macros, tokens->ids[i]) != NULL) {
+      pp->site = header;
+      pp->site_token = i;
+      input.header = header;
+      input.pos = i + 1;
+      mark = arena_mark(&pp->expand_arena);
+      pp_expand(pp, pp_file_token(pp, header, i), &input, 1);
+      arena_rewind(&pp->expand_arena, mark);
+      i = input.pos;
+      continue;
+    }
+    pp_check_token(pp, header, i);
+    tok_push(pp->out, tokens->kinds[i], tokens->flags[i],
+      header->base + tokens->offsets[i], tokens->lengths[i],
+      tokens->ids[i]
+    );
+    i++;
+  }
+  while (file.conds.length > 0) {
+    cond = vec_pop(&file.conds);
+    pp_error(pp, header, cond->token, "unterminated conditional");
+  }
+  vec_deinit(&file.conds);
+  if (pp->writer != NULL && file.line_path.at != NULL) {
+    pp_print_out(pp);
+  }
+  pp->file = parent;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_file_token(Preprocessor *pp, Header *header, int i)
+{
+  PPToken *tok = NULL;
+  /**/
+  tok = arena_alloc(&pp->expand_arena, sizeof(*tok));
+  tok->next = NULL;
+  tok->header = header;
+  tok->context = NULL;
+  tok->offset = header->tokens.offsets[i];
+  tok->site = header->base + tok->offset;
+  tok->length = header->tokens.lengths[i];
+  tok->id = header->tokens.ids[i];
+  tok->kind = header->tokens.kinds[i];
+  tok->flags = header->tokens.flags[i];
+  return tok;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_include(Preprocessor *pp, PPFile *file, int i, int end)
+{
+  const Tokens *tokens = NULL;
+  Interns *interns = NULL;
+  Header *header = NULL;
+  ArenaMark mark;
+  PPToken *list = NULL;
+  PPToken *tok = NULL;
+  Strview name;
+  int64 num_loads = 0;
+  int is_quoted = 0;
+  int j = 0;
+  /**/
+  tokens = file->tokens;
+  interns = pp->cache->interns;
+  name = sv_array("", 0);
+  if (i < end && tokens->kinds[i] == TK_STRING
+      && !(tokens->flags[i] & TF_UNCLOSED)) {
+    name = pp_spell(pp, file->header, i);
+    if (name.at[0] == '"') {
+      name = sv_cut(sv_cut_end(name, 1), 1);
+    }
+    is_quoted = 1;
+  } else if (i < end && tokens->kinds[i] == TK_LT) {
+    for (j = i + 1; j < end && tokens->kinds[j] != TK_GT; j++) {
+    }
+    if (j < end) {
+      name = sv_array(
+        file->header->src.text.at + tokens->offsets[i] + 1,
+        tokens->offsets[j] - tokens->offsets[i] - 1
+      );
+    }
+  } else if (i < end) {
+    /* The name is made by macros. */
+    mark = arena_mark(&pp->expand_arena);
+    pp->site = file->header;
+    pp->site_token = i;
+    list = pp_expand(pp, pp_line_tokens(pp, file->header, i, end),
+      NULL, 0
+    );
+    if (list != NULL && list->kind == TK_STRING
+        && !(list->flags & TF_UNCLOSED)) {
+      name = pp_tok_spell(pp, list);
+      if (name.at[0] == '"') {
+        name = sv_cut(sv_cut_end(name, 1), 1);
+      }
+      is_quoted = 1;
+    } else if (list != NULL && list->kind == TK_LT) {
+      sb_clear(&pp->message);
+      for (tok = list->next; tok != NULL && tok->kind != TK_GT;
+          tok = tok->next) {
+        if (tok != list->next && (tok->flags & TF_SPACE)) {
+          sb_append_char(&pp->message, ' ');
+        }
+        sb_append_sv(&pp->message, pp_tok_spell(pp, tok));
+      }
+      if (tok != NULL) {
+        name = sb_view(&pp->message);
+      }
+    }
+    /* Keep the name past the buffers it was spelled into. */
+    if (name.length > 0) {
+      name = intern_view(interns, intern_sv(interns, name));
+    }
+    arena_rewind(&pp->expand_arena, mark);
+  }
+  if (name.length == 0) {
+    pp_error(pp, file->header, i < end ? i : i - 1,
+      "#include expects \"FILE\" or <FILE>"
+    );
+    return;
+  }
+  G->pp_stats.num_includes++;
+  num_loads = G->pp_stats.num_loads;
+  header = hc_find(pp->cache, name, is_quoted ? file->header : NULL,
+    &pp->path
+  );
+  if (header == NULL) {
+    sb_clear(&pp->message);
+    sb_append(&pp->message, "cannot find include file '%.*s'",
+      (int)name.length, name.at
+    );
+    pp_error(pp, file->header, i, pp->message.at);
+    return;
+  }
+  if (header->guard_id != 0
+      && map_get(&pp->macros, header->guard_id) != NULL) {
+    G->pp_stats.num_guard_skips++;
+    return;
+  }
+  if (*pp_mark(pp, header) & PP_MARK_ONCE) {
+    G->pp_stats.num_once_skips++;
+    return;
+  }
+  if (G->pp_stats.num_loads == num_loads) {
+    G->pp_stats.num_reuses++;
+  }
+  if (pp->depth >= PP_MAX_DEPTH) {
+    pp_error(pp, file->header, i, "#include nested too deeply");
+    return;
+  }
+  pp->depth++;
+  pp_file(pp, header);
+  pp->depth--;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_init(Preprocessor *pp, HeaderCache *cache, Tokens *out)
+{
+  Macro *macro = NULL;
+  struct tm *tm = NULL;
+  time_t now = 0;
+  int id = 0;
+  /**/
+  assert(pp != NULL);
+  assert(!pp->is_inited);
+  assert(cache != NULL);
+  assert(cache->is_inited);
+  assert(out != NULL);
+  assert(out->is_inited);
+  /**/
+  pp->cache = cache;
+  pp->out = out;
+  map_init(&pp->macros);
+  arena_init(&pp->arena, 0);
+  arena_init(&pp->expand_arena, 0);
+  sb_init(&pp->scratch);
+  sb_init(&pp->message);
+  sb_init(&pp->errors);
+  sb_init(&pp->spelling);
+  sb_init(&pp->path);
+  vec_init(&pp->marks, 1, VEC_ZEROS);
+  vec_init(&pp->sites, sizeof(PPSite), 0);
+  for (id = PW_MACRO_DATE; id <= PW_MACRO_TIME; id++) {
+    macro = arena_alloc_zeros(&pp->arena, sizeof(*macro));
+    macro->header = NULL;
+    macro->name = 0;
+    macro->num_params = -1;
+    map_set(&pp->macros, id, macro);
+  }
+  /* The same date and time for the whole translation unit. */
+  now = time(NULL);
+#ifndef UACC_NO_THREADS
+  pthread_mutex_lock(&time_lock);
+#endif
+  tm = localtime(&now);
+  pp->date_offset = pp->scratch.length;
+  if (tm != NULL) {
+    sb_append(&pp->scratch, "\"%s %2d %d\"",
+      month_names[tm->tm_mon], tm->tm_mday, tm->tm_year + 1900
+    );
+  } else {
+    sb_append(&pp->scratch, "%s", "\"??? ?? ????\"");
+  }
+  pp->time_offset = pp->scratch.length;
+  if (tm != NULL) {
+    sb_append(&pp->scratch, "\"%02d:%02d:%02d\"",
+      tm->tm_hour, tm->tm_min, tm->tm_sec
+    );
+  } else {
+    sb_append(&pp->scratch, "%s", "\"??:??:??\"");
+  }
+#ifndef UACC_NO_THREADS
+  pthread_mutex_unlock(&time_lock);
+#endif
+  pp->site = NULL;
+  pp->site_token = 0;
+  pp->file = NULL;
+  pp->writer = NULL;
+  pp->print_header = NULL;
+  pp->print_line = 0;
+  pp->print_kind = TK_EOF;
+  pp->print_flags = 0;
+  pp->print_last = '\n';
+  pp->num_printed = 0;
+  pp->depth = 0;
+  pp->pch = NULL;
+  pp->num_errors = 0;
+  pp->is_inited = 1;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_line(Preprocessor *pp, PPFile *file, int i, int end)
+{
+  const Tokens *tokens = NULL;
+  Interns *interns = NULL;
+  ArenaMark mark;
+  PPToken *list = NULL;
+  PPToken *name = NULL;
+  Strview text;
+  int64 number = 0;
+  int64 line = 0;
+  int64 column = 0;
+  int64 j = 0;
+  /**/
+  tokens = file->tokens;
+  interns = pp->cache->interns;
+  mark = arena_mark(&pp->expand_arena);
+  pp->site = file->header;
+  pp->site_token = i - 1;
+  list = pp_expand(pp, pp_line_tokens(pp, file->header, i, end),
+    NULL, 0
+  );
+  if (list == NULL) {
+    pp_error(pp, file->header, i - 1, "#line expects a line number");
+    arena_rewind(&pp->expand_arena, mark);
+    return;
+  }
+  text = pp_tok_spell(pp, list);
+  number = list->kind == TK_NUMBER ? 0 : -1;
+  for (j = 0; j < text.length && number >= 0; j++) {
+    if (!cc_is(text.at[j], CC_DIGIT) || number > PP_MAX_LINE / 10) {
+      number = -1;
+    } else {
+      number = number * 10 + (text.at[j] - '0');
+    }
+  }
+  if (number <= 0 || number > PP_MAX_LINE) {
+    sb_clear(&pp->message);
+    sb_append(&pp->message,
+      "'%.*s' after #line is not a positive line number",
+      (int)text.length, text.at
+    );
+    pp_error_token(pp, list, pp->message.at);
+    arena_rewind(&pp->expand_arena, mark);
+    return;
+  }
+  name = list->next;
+  if (name != NULL && (name->kind != TK_STRING
+      || (name->flags & TF_UNCLOSED)
+      || pp_tok_spell(pp, name).at[0] != '"')) {
+    pp_error_token(pp, name, "invalid file name in #line");
+    arena_rewind(&pp->expand_arena, mark);
+    return;
+  }
+  if (name != NULL && name->next != NULL) {
+    pp_error_token(pp, name->next,
+      "extra tokens at end of #line directive"
+    );
+    arena_rewind(&pp->expand_arena, mark);
+    return;
+  }
+  if (pp->writer != NULL) {
+    /* What is before the directive keeps the old lines. */
+    pp_print_out(pp);
+    pp->print_header = NULL;
+  }
+  if (name != NULL) {
+    text = pp_tok_spell(pp, name);
+    sb_clear(&pp->message);
+    for (j = 1; j < text.length - 1; j++) {
+      if (text.at[j] == '\\' && j + 1 < text.length - 1) {
+        j++;
+      }
+      sb_append_char(&pp->message, text.at[j]);
+    }
+    file->line_path = intern_view(interns,
+      intern_sv(interns, sb_view(&pp->message))
+    );
+  } else if (file->line_path.at == NULL) {
+    file->line_path = sb_view(&file->header->src.path);
+  }
+  /* The line after the directive gets the number. */
+  src_locate(&file->header->src,
+    tokens->offsets[end - 1] + tokens->lengths[end - 1], &line, &column
+  );
+  file->line_delta = number - (line + 1);
+  arena_rewind(&pp->expand_arena, mark);
+}
+
+/*----------------------------------------------------------*/
+int
+pp_line_end(const Tokens *tokens, int i)
+{
+  for (i++; tokens->kinds[i] != TK_EOF; i++) {
+    if (tokens->flags[i] & TF_BOL) {
+      break;
+    }
+  }
+  return i;
+}
+
+/*----------------------------------------------------------*/
+Strview
+pp_line_path(Preprocessor *pp, const Header *header, int64 *line)
+{
+  if (pp->file == NULL || pp->file->header != header
+      || pp->file->line_path.at == NULL) {
+    return sv_array(header->src.path.at, header->src.path.length);
+  }
+  *line += pp->file->line_delta;
+  return pp->file->line_path;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_line_tokens(Preprocessor *pp, Header *header, int i, int end)
+{
+  PPToken *head = NULL;
+  PPToken **tail = NULL;
+  /**/
+  tail = &head;
+  for (; i < end; i++) {
+    *tail = pp_file_token(pp, header, i);
+    tail = &(*tail)->next;
+  }
+  return head;
+}
+
+/*----------------------------------------------------------*/
+int
+pp_macro_equal(const Macro *a, const Macro *b)
+{
+  const Tokens *at = NULL;
+  const Tokens *bt = NULL;
+  int i = 0;
+  int j = 0;
+  int k = 0;
+  /**/
+  if (a->header == NULL || b->header == NULL) {
+    return a->header == b->header;
+  }
+  if (a->num_params != b->num_params || a->num_body != b->num_body) {
+    return 0;
+  }
+  for (k = 0; k < a->num_params; k++) {
+    if (a->params[k] != b->params[k]) {
+      return 0;
+    }
+  }
+  at = &a->header->tokens;
+  bt = &b->header->tokens;
+  for (k = 0; k < a->num_body; k++) {
+    i = a->first + k;
+    j = b->first + k;
+    if (at->kinds[i] != bt->kinds[j]
+        || (k > 0 && (at->flags[i] & TF_SPACE)
+          != (bt->flags[j] & TF_SPACE))
+        || !sv_equal(tok_text(at, i, a->header->src.text),
+          tok_text(bt, j, b->header->src.text))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+unsigned char *
+pp_mark(Preprocessor *pp, const Header *header)
+{
+  Vector *marks = NULL;
+  /**/
+  assert(pp != NULL);
+  assert(header != NULL);
+  /**/
+  marks = &pp->marks;
+  if (header->index >= marks->length) {
+    vec_insert(marks, marks->length, NULL,
+      header->index + 1 - marks->length
+    );
+  }
+  return (unsigned char *)marks->at + header->index;
+}
+
+/*----------------------------------------------------------*/
+int
+pp_param(const Macro *macro, int i)
+{
+  const Tokens *tokens = NULL;
+  int k = 0;
+  /**/
+  tokens = &macro->header->tokens;
+  if (tokens->kinds[i] != TK_IDENT) {
+    return -1;
+  }
+  for (k = 0; k < macro->num_params; k++) {
+    if (macro->params[k] == tokens->ids[i]) {
+      return k;
+    }
+  }
+  return -1;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_paste(Preprocessor *pp, PPToken *left, PPToken *right)
+{
+  Strview text;
+  int64 start = 0;
+  int64 split = 0;
+  int kind = 0;
+  int id = 0;
+  /**/
+  assert(left != NULL);
+  assert(right != NULL);
+  /**/
+  start = pp->scratch.length;
+  sb_append_sv(&pp->scratch, pp_tok_spell(pp, left));
+  split = pp->scratch.length - start;
+  sb_append_sv(&pp->scratch, pp_tok_spell(pp, right));
+  text = sv_array(pp->scratch.at + start, pp->scratch.length - start);
+  kind = lex_single(pp->cache->interns, text, &id);
+  if (kind < 0) {
+    sb_clear(&pp->message);
+    sb_append(&pp->message,
+      "pasting '%.*s' and '%.*s' does not give a valid token",
+      (int)split, text.at, (int)(text.length - split), text.at + split
+    );
+    pp_error(pp, pp->site, pp->site_token, pp->message.at);
+    sb_remove(&pp->scratch, start, text.length);
+    return right;
+  }
+  left->header = NULL;
+  left->offset = start;
+  left->length = text.length;
+  left->id = id;
+  left->kind = kind;
+  left->flags &= ~(TF_DIRTY | PP_PAINTED);
+  return right->next;
+}
+
+/*----------------------------------------------------------*/
+int
+pp_precedence(int kind)
+{
+  switch (kind) {
+  case TK_OR:
+    return 1;
+  case TK_AND:
+    return 2;
+  case TK_PIPE:
+    return 3;
+  case TK_CARET:
+    return 4;
+  case TK_AMP:
+    return 5;
+  case TK_EQ:
+  case TK_NE:
+    return 6;
+  case TK_LT:
+  case TK_GT:
+  case TK_LE:
+  case TK_GE:
+    return 7;
+  case TK_SHL:
+  case TK_SHR:
+    return 8;
+  case TK_PLUS:
+  case TK_MINUS:
+    return 9;
+  case TK_STAR:
+  case TK_SLASH:
+  case TK_PERCENT:
+    return 10;
+  }
+  return 0;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_print_end_line(Preprocessor *pp)
+{
+  if (pp->print_last == '\n') {
+    return;
+  }
+  wr_char(pp->writer, '\n');
+  pp->print_line++;
+  pp->print_last = '\n';
+}
+
+/*----------------------------------------------------------*/
+void
+pp_print_line(Preprocessor *pp, Header *header, int64 line)
+{
+  Strview path;
+  /**/
+  path = pp_line_path(pp, header, &line);
+  pp_print_end_line(pp);
+  if (header == pp->print_header && line >= pp->print_line
+      && line - pp->print_line <= PP_PRINT_GAP) {
+    for (; pp->print_line < line; pp->print_line++) {
+      wr_char(pp->writer, '\n');
+    }
+    return;
+  }
+  sb_clear(&pp->message);
+  sb_append(&pp->message, "#line %ld ", (long)line);
+  pp_append_quoted(&pp->message, path);
+  sb_append_char(&pp->message, '\n');
+  wr_write(pp->writer, pp->message.at, pp->message.length);
+  pp->print_header = header;
+  pp->print_line = line;
+}
+
+/*----------------------------------------------------------*/
+int
+pp_print_needs_space(int last_kind, int last, int kind, int first)
+{
+  if (last_kind == TK_NUMBER) {
+    /* Numbers take letters, dots and signs after `e`. */
+    return cc_is(first, CC_IDENT) || first == '.' || first == '+'
+      || first == '-';
+  }
+  if (cc_is(last, CC_IDENT)) {
+    /* `L` is also the prefix of wide literals. */
+    return cc_is(first, CC_IDENT) || kind == TK_STRING
+      || kind == TK_CHAR;
+  }
+  if (last == '.' && cc_is(first, CC_DIGIT)) {
+    return 1;
+  }
+  return strchr("+-*/%<>=!&|^.#", last) != NULL
+    && strchr("+-*/%<>=!&|^.#", first) != NULL;
+}
+
+/*----------------------------------------------------------*/
+void
+pp_print_out(Preprocessor *pp)
+{
+  Tokens *out = NULL;
+  Header *header = NULL;
+  PPSite *sites = NULL;
+  Strview text;
+  int64 offset = 0;
+  int64 line = 0;
+  int64 column = 0;
+  int num_sites = 0;
+  int flags = 0;
+  int kind = 0;
+  int i = 0;
+  /**/
+  out = pp->out;
+  sites = (PPSite *)pp->sites.at;
+  for (i = 0; i < out->count; i++) {
+    kind = out->kinds[i];
+    flags = out->flags[i];
+    if (kind == TK_EOF) {
+      pp_print_end_line(pp);
+      continue;
+    }
+    text = pp_token_text(pp, i);
+    offset = out->offsets[i];
+    if ((flags & TF_BOL) && (flags & TF_EXPANDED)) {
+      /* An expansion is on the line of the macro name. */
+      offset = -1;
+      if (num_sites < pp->sites.length
+          && sites[num_sites].token == i) {
+        offset = sites[num_sites++].offset;
+      }
+    }
+    if ((flags & TF_BOL) && offset >= 0) {
+      header = hc_locate(pp->cache, offset);
+      src_locate(&header->src, offset - header->base, &line, &column);
+      pp_print_line(pp, header, line);
+    } else if (flags & TF_BOL) {
+      /* The line is not known, take the next. */
+      pp_print_end_line(pp);
+    } else if (pp->print_last != '\n' && ((flags & TF_SPACE)
+        || (((flags | pp->print_flags) & TF_EXPANDED)
+          && pp_print_needs_space(pp->print_kind, pp->print_last,
+            kind, text.at[0])))) {
+      wr_char(pp->writer, ' ');
+    }
+    wr_write(pp->writer, text.at, text.length);
+    pp->print_kind = kind;
+    pp->print_flags = flags;
+    pp->print_last = text.at[text.length - 1];
+  }
+  pp->num_printed += out->count;
+  tok_clear(out);
+  vec_clear(&pp->sites);
+}
+
+/*----------------------------------------------------------*/
+void
+pp_print_stats(FILE *file)
+{
+  PPStats *stats = NULL;
+  /**/
+  assert(file != NULL);
+  /**/
+  stats = &G->pp_stats;
+  fprintf(file, "%s", "      PREPROCESSOR\n");
+  fprintf(file, "%-20s %12ld\n", "includes", stats->num_includes);
+  fprintf(file, "%-20s %12ld\n", "files loaded", stats->num_loads);
+  fprintf(file, "%-20s %12ld\n", "re-reads skipped",
+    stats->num_reuses + stats->num_guard_skips + stats->num_once_skips
+  );
+  fprintf(file, "%-20s %12ld\n", "  tokens reused", stats->num_reuses);
+  fprintf(file, "%-20s %12ld\n", "  guard skips",
+    stats->num_guard_skips
+  );
+  fprintf(file, "%-20s %12ld\n", "  once skips", stats->num_once_skips);
+  fprintf(file, "%-20s %12ld\n", "stat calls", stats->num_stats);
+  fprintf(file, "%-20s %12ld\n", "known missing",
+    stats->num_missing_hits
+  );
+  fprintf(file, "%-20s %12ld\n", "macros expanded",
+    stats->num_expansions
+  );
+  fprintf(file, "%-20s %12ld\n", "precompiled tokens",
+    stats->num_pch_tokens
+  );
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_pull(Preprocessor *pp, PPInput *input)
+{
+  const Tokens *tokens = NULL;
+  int i = 0;
+  /**/
+  tokens = &input->header->tokens;
+  i = input->pos;
+  if (tokens->kinds[i] == TK_EOF
+      || (tokens->kinds[i] == TK_HASH && (tokens->flags[i] & TF_BOL))) {
+    return NULL;
+  }
+  pp_check_token(pp, input->header, i);
+  input->pos++;
+  return pp_file_token(pp, input->header, i);
+}
+
+/*----------------------------------------------------------*/
+int
+pp_run(Preprocessor *pp, const char *path)
+{
+  Header *header = NULL;
+  PhaseStats *stats = NULL;
+  double start = 0;
+  double nested = 0;
+  int64 count = 0;
+  /**/
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  assert(path != NULL);
+  /**/
+  start = time_now();
+  nested = G->phase_stats[PHASE_LOAD].seconds
+    + G->phase_stats[PHASE_LEX].seconds;
+  header = hc_open(pp->cache, sv_cstr(path));
+  if (header == NULL) {
+    sb_append(&pp->errors, "%s%s%s%s",
+      path, ": ", strerror(errno), "\n"
+    );
+    return 0;
+  }
+  count = pp->out->count + pp->num_printed;
+  if (pp->pch != NULL) {
+    pp_apply_pch(pp);
+  } else {
+    pp_file(pp, pp->cache->builtin);
+  }
+  pp_file(pp, header);
+  tok_push(pp->out, TK_EOF, TF_BOL,
+    header->base + header->src.text.length, 0, 0
+  );
+  if (pp->writer != NULL) {
+    pp_print_out(pp);
+  }
+  /* Loading and lexing are timed by themselves. */
+  nested = G->phase_stats[PHASE_LOAD].seconds
+    + G->phase_stats[PHASE_LEX].seconds - nested;
+  stats = &G->phase_stats[PHASE_PP];
+  stats->seconds += time_now() - start - nested;
+  stats->items += pp->out->count + pp->num_printed - count;
+  return pp->num_errors == 0;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_scratch_token(Preprocessor *pp, int kind, int64 offset,
+  int64 length, int flags)
+{
+  PPToken *tok = NULL;
+  /**/
+  tok = arena_alloc(&pp->expand_arena, sizeof(*tok));
+  tok->next = NULL;
+  tok->header = NULL;
+  tok->context = NULL;
+  tok->offset = offset;
+  tok->site = -1;
+  tok->length = length;
+  tok->id = 0;
+  tok->kind = kind;
+  tok->flags = flags;
+  return tok;
+}
+
+/*----------------------------------------------------------*/
+Strview
+pp_spell(Preprocessor *pp, const Header *header, int i)
+{
+  Strview text;
+  /**/
+  text = tok_text(&header->tokens, i, header->src.text);
+  if (!(header->tokens.flags[i] & TF_DIRTY)) {
+    return text;
+  }
+  sb_clear(&pp->spelling);
+  lex_spell(&pp->spelling, text);
+  return sb_view(&pp->spelling);
+}
+
+/*----------------------------------------------------------*/
+void
+pp_stream(Preprocessor *pp, Writer *writer)
+{
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  assert(writer != NULL);
+  assert(writer->is_inited);
+  /**/
+  pp->writer = writer;
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_stringize(Preprocessor *pp, const PPToken *list, int flags)
+{
+  const PPToken *tok = NULL;
+  Strview text;
+  int64 start = 0;
+  int64 i = 0;
+  /**/
+  start = pp->scratch.length;
+  sb_append_char(&pp->scratch, '"');
+  for (tok = list; tok != NULL; tok = tok->next) {
+    if (tok != list && (tok->flags & TF_SPACE)) {
+      sb_append_char(&pp->scratch, ' ');
+    }
+    text = pp_tok_spell(pp, tok);
+    if (tok->kind != TK_STRING && tok->kind != TK_CHAR) {
+      sb_append_sv(&pp->scratch, text);
+      continue;
+    }
+    for (i = 0; i < text.length; i++) {
+      if (text.at[i] == '"' || text.at[i] == '\\') {
+        sb_append_char(&pp->scratch, '\\');
+      }
+      sb_append_char(&pp->scratch, text.at[i]);
+    }
+  }
+  sb_append_char(&pp->scratch, '"');
+  return pp_scratch_token(pp, TK_STRING, start,
+    pp->scratch.length - start, flags
+  );
+}
+
+/*----------------------------------------------------------*/
+PPToken *
+pp_subst(Preprocessor *pp, const Macro *macro, PPArg *args,
+  const PPContext *context, const PPToken *name, PPToken *rest)
+{
+  const Tokens *tokens = NULL;
+  PPToken *head = NULL;
+  PPToken **tail = NULL;
+  PPToken *last = NULL;
+  PPToken *list = NULL;
+  PPToken *tok = NULL;
+  PPArg *arg = NULL;
+  int is_placemarker = 0;
+  int is_pasted = 0;
+  int param = 0;
+  int end = 0;
+  int i = 0;
+  /**/
+  tokens = &macro->header->tokens;
+  tail = &head;
+  end = macro->first + macro->num_body;
+  for (i = macro->first; i < end; i++) {
+    is_pasted = i + 1 < end && tokens->kinds[i + 1] == TK_HASH_HASH;
+    param = pp_param(macro, i);
+    if (tokens->kinds[i] == TK_HASH && macro->num_params >= 0) {
+      /* `pp_define` made sure a parameter follows. */
+      i++;
+      list = pp_stringize(pp, args[pp_param(macro, i)].raw,
+        tokens->flags[i - 1] & TF_SPACE
+      );
+      is_placemarker = 0;
+    } else if (tokens->kinds[i] == TK_HASH_HASH) {
+      i++;
+      param = pp_param(macro, i);
+      if (param >= 0) {
+        list = pp_copy_list(pp, args[param].raw);
+      } else {
+        list = pp_file_token(pp, macro->header, i);
+      }
+      /* An empty argument is a placemarker: pasting it to
+      anything gives that thing. */
+      if (list == NULL) {
+        continue;
+      }
+      if (!is_placemarker) {
+        list = pp_paste(pp, last, list);
+      }
+      is_placemarker = 0;
+    } else if (param >= 0 && is_pasted) {
+      list = pp_copy_list(pp, args[param].raw);
+      is_placemarker = list == NULL;
+    } else if (param >= 0) {
+      arg = &args[param];
+      if (!arg->is_expanded) {
+        list = pp_copy_list(pp, arg->raw);
+        for (tok = list; tok != NULL; tok = tok->next) {
+          tok->context = context->next;
+        }
+        arg->expanded = pp_expand(pp, list, NULL, 0);
+        arg->is_expanded = 1;
+      }
+      list = pp_copy_list(pp, arg->expanded);
+      is_placemarker = 0;
+    } else {
+      list = pp_file_token(pp, macro->header, i);
+      is_placemarker = 0;
+    }
+    if (param >= 0 && list != NULL
+        && tokens->kinds[i - 1] != TK_HASH_HASH) {
+      /* The argument takes the place of the parameter. */
+      list->flags = (list->flags & ~TF_SPACE)
+        | (tokens->flags[i] & TF_SPACE);
+    }
+    for (; list != NULL; list = list->next) {
+      *tail = list;
+      tail = &list->next;
+      last = list;
+    }
+  }
+  *tail = NULL;
+  for (list = head; list != NULL; list = list->next) {
+    list->context = context;
+  }
+  /* The expansion takes the place of the name. */
+  if (head != NULL) {
+    head->flags = (head->flags & ~(TF_SPACE | TF_BOL))
+      | (name->flags & (TF_SPACE | TF_BOL));
+    head->site = name->site;
+  } else if (rest != NULL) {
+    if ((name->flags & TF_BOL) && !(rest->flags & TF_BOL)) {
+      rest->site = name->site;
+    }
+    rest->flags |= name->flags & (TF_SPACE | TF_BOL);
+  }
+  *tail = rest;
+  return head != NULL ? head : rest;
+}
+
+/*----------------------------------------------------------*/
+Strview
+pp_tok_spell(Preprocessor *pp, const PPToken *tok)
+{
+  Strview text;
+  /**/
+  if (tok->header == NULL) {
+    /* `scratch` may move while the view is used. */
+    sb_clear(&pp->spelling);
+    sb_append_bytes(&pp->spelling, pp->scratch.at + tok->offset,
+      tok->length
+    );
+    return sb_view(&pp->spelling);
+  }
+  text = sv_array(tok->header->src.text.at + tok->offset, tok->length);
+  if (!(tok->flags & TF_DIRTY)) {
+    return text;
+  }
+  sb_clear(&pp->spelling);
+  lex_spell(&pp->spelling, text);
+  return sb_view(&pp->spelling);
+}
+
+/*----------------------------------------------------------*/
+Strview
+pp_token_text(Preprocessor *pp, int i)
+{
+  Header *header = NULL;
+  Strview text;
+  int64 offset = 0;
+  /**/
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  assert(0 <= i && i < pp->out->count);
+  /**/
+  offset = pp->out->offsets[i];
+  if (pp->out->flags[i] & TF_SCRATCH) {
+    return sv_array(pp->scratch.at + offset, pp->out->lengths[i]);
+  }
+  header = hc_locate(pp->cache, offset);
+  text = sv_array(header->src.text.at + offset - header->base,
+    pp->out->lengths[i]
+  );
+  if (!(pp->out->flags[i] & TF_DIRTY)) {
+    return text;
+  }
+  sb_clear(&pp->spelling);
+  lex_spell(&pp->spelling, text);
+  return sb_view(&pp->spelling);
+}
+
+/*----------------------------------------------------------*/
+void
+pp_use_pch(Preprocessor *pp, PCH *pch)
+{
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  assert(pch != NULL);
+  assert(pch->is_inited);
+  /**/
+  pp->pch = pch;
+}
+
+/*----------------------------------------------------------*/
+/* IMPLEMENTATION: PRECOMPILED HEADER                       */
+/*----------------------------------------------------------*/
+
+/*----------------------------------------------------------*/
+void
+pch_align(Writer *w)
+{
+  static const char zeros[8] = {0};
+  /**/
+  wr_write(w, zeros, (8 - w->length % 8) % 8);
+}
+
+/*----------------------------------------------------------*/
+const char *
+pch_at(const PCH *pch, int64 offset, int64 count, int64 size)
+{
+  int64 length = 0;
+  /**/
+  length = pch->src.text.length;
+  if (offset < 0 || offset > length || count < 0 || count > INT_MAX
+      || count > (length - offset) / size) {
+    return NULL;
+  }
+  return pch->src.text.at + offset;
+}
+
+/*----------------------------------------------------------*/
+int
+pch_check(PCH *pch, HeaderCache *hc, Strbuf *message)
+{
+  const PCHHead *head = NULL;
+  const PCHString *strings = NULL;
+  const PCHFile *files = NULL;
+  const PCHMacro *macros = NULL;
+  const PCHMacro *m = NULL;
+  const Tokens *tokens = NULL;
+  const char *at = NULL;
+  int64 i = 0;
+  /**/
+  head = (const PCHHead *)pch_at(pch, 0, 1, sizeof(*head));
+  if (head == NULL
+      || memcmp(head->magic, PCH_MAGIC, sizeof(head->magic)) != 0) {
+    sb_append(message, "%s", "not a precompiled header of uacc");
+    return 0;
+  }
+  if (head->size != pch->src.text.length) {
+    sb_append(message, "%s", "the file is truncated");
+    return 0;
+  }
+  if (head->checksum != sv_hash(sv_cut(pch->src.text,
+      offsetof(PCHHead, size)))) {
+    sb_append(message, "%s", "the file is corrupt");
+    return 0;
+  }
+  if (head->options_hash != pch_hash_options(hc)) {
+    sb_append(message, "%s",
+      "made with other definitions or include directories"
+    );
+    return 0;
+  }
+  /* The same IDs as when it was made, so tokens need no change. */
+  strings = (const PCHString *)pch_at(pch, head->strings,
+    head->num_strings, sizeof(*strings)
+  );
+  for (i = 0; strings != NULL && i < head->num_strings; i++) {
+    at = pch_at(pch, strings[i].at, strings[i].length, 1);
+    if (at == NULL) {
+      strings = NULL;
+    } else if (intern_sv(hc->interns,
+        sv_array(at, strings[i].length)) != i + 1) {
+      sb_append(message, "%s", "made by another build of uacc");
+      return 0;
+    }
+  }
+  files = (const PCHFile *)pch_at(pch, head->files, head->num_files,
+    sizeof(*files)
+  );
+  macros = (const PCHMacro *)pch_at(pch, head->macros,
+    head->num_macros, sizeof(*macros)
+  );
+  if (strings == NULL || files == NULL || macros == NULL
+      || !pch_tokens(pch, &head->out, &pch->out)
+      || pch_at(pch, head->scratch, head->scratch_length, 1) == NULL) {
+    sb_append(message, "%s", "the file is corrupt");
+    return 0;
+  }
+  pch->scratch = sv_array(pch->src.text.at + head->scratch,
+    head->scratch_length
+  );
+  pch->first_base = head->first_base;
+  pch->num_headers = (int)head->num_files;
+  if (pch->num_headers > 0) {
+    pch->headers = mem_alloc_zeros(
+      mem_size_mul(pch->num_headers, sizeof(Header *))
+    );
+    pch->marks = mem_alloc(pch->num_headers);
+  }
+  for (i = 0; i < head->num_files; i++) {
+    pch->headers[i] = pch_check_file(pch, hc, &files[i], message);
+    if (pch->headers[i] == NULL) {
+      return 0;
+    }
+    pch->marks[i] = (unsigned char)files[i].marks;
+  }
+  for (i = 0; i < head->num_macros; i++) {
+    m = &macros[i];
+    tokens = NULL;
+    if (m->file == -1) {
+      tokens = &hc->builtin->tokens;
+    } else if (m->file >= 0 && m->file < head->num_files) {
+      tokens = &pch->headers[m->file]->tokens;
+    }
+    if (tokens == NULL || m->id < 1 || m->id > head->num_strings
+        || m->name < 0 || m->name >= tokens->count
+        || m->first < 0 || m->num_body < 0
+        || m->first + m->num_body >= tokens->count
+        || (m->num_params >= 0 && pch_at(pch, m->params,
+          m->num_params + 1, sizeof(int)) == NULL)) {
+      sb_append(message, "%s", "the file is corrupt");
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+Header *
+pch_check_file(PCH *pch, HeaderCache *hc, const PCHFile *file,
+  Strbuf *message)
+{
+  struct stat st;
+  Source src;
+  Header *header = NULL;
+  const char *text = NULL;
+  const char *path = NULL;
+  int is_fresh = 0;
+  /**/
+  text = pch_at(pch, file->text, file->text_length, 1);
+  if (text == NULL || file->path_id < 1
+      || file->path_id >= ATOMIC_LOAD(&hc->interns->num_strings)) {
+    sb_append(message, "%s", "the file is corrupt");
+    return NULL;
+  }
+  path = intern_view(hc->interns, (int)file->path_id).at;
+  /* By the content: a time can stay the same after a change. */
+  G->pp_stats.num_stats++;
+  if (stat(path, &st) == 0 && S_ISREG(st.st_mode)
+      && (int64)st.st_size == file->text_length) {
+    mem_clear(&src, sizeof(src));
+    if (src_load(&src, path)) {
+      is_fresh = sv_hash(src.text) == file->hash;
+      src_unload(&src);
+    }
+  }
+  if (!is_fresh) {
+    sb_append(message, "out of date, '%s' has changed", path);
+    return NULL;
+  }
+  header = mem_alloc_zeros(sizeof(*header));
+  if (!pch_tokens(pch, &file->tokens, &header->tokens)
+      || header->tokens.count == 0
+      || header->tokens.kinds[header->tokens.count - 1] != TK_EOF) {
+    mem_free(header);
+    sb_append(message, "%s", "the file is corrupt");
+    return NULL;
+  }
+  header->src.text = sv_array(text, file->text_length);
+  sb_init(&header->src.path);
+  sb_append(&header->src.path, "%s", path);
+  header->src.device = st.st_dev;
+  header->src.inode = st.st_ino;
+  header->src.mtime = st.st_mtime;
+  header->src.is_inited = 1;
+  sb_init(&header->errors);
+  header->path_id = (int)file->path_id;
+  header->guard_id = (int)file->guard_id;
+  header->is_lex_ok = 1;
+  header->is_pch = 1;
+  return header;
+}
+
+/*----------------------------------------------------------*/
+void
+pch_deinit(PCH *pch)
+{
+  assert(pch != NULL);
+  assert(pch->is_inited);
+  /**/
+  if (pch->headers != NULL) {
+    mem_free(pch->headers);
+    mem_free(pch->marks);
+  }
+  if (pch->macros != NULL) {
+    mem_free(pch->macros);
+    mem_free(pch->macro_ids);
+  }
+  src_unload(&pch->src);
+  mem_clear(pch, sizeof(*pch));
+}
+
+/*----------------------------------------------------------*/
+uint64
+pch_hash_options(HeaderCache *hc)
+{
+  Strbuf text;
+  uint64 hash = 0;
+  int64 i = 0;
+  /**/
+  mem_clear(&text, sizeof(text));
+  sb_init(&text);
+  sb_append_sv(&text, hc->builtin->src.text);
+  for (i = 0; i < hc->dirs.length; i++) {
+    sb_append_char(&text, '\0');
+    sb_append(&text, "%s", ((char **)hc->dirs.at)[i]);
+  }
+  hash = sv_hash(sb_view(&text));
+  sb_deinit(&text);
+  return hash;
+}
+
+/*----------------------------------------------------------*/
+int
+pch_load(PCH *pch, HeaderCache *hc, const char *path,
+  Strbuf *errors)
+{
+  const PCHHead *head = NULL;
+  const PCHMacro *m = NULL;
+  PhaseStats *stats = NULL;
+  Macro *macro = NULL;
+  Strbuf message;
+  double start = 0;
+  int is_ok = 0;
+  int i = 0;
+  /**/
+  assert(pch != NULL);
+  assert(!pch->is_inited);
+  assert(hc != NULL);
+  assert(hc->is_inited);
+  assert(path != NULL);
+  assert(errors != NULL);
+  /**/
+  start = time_now();
+  if (!src_load(&pch->src, path)) {
+    sb_append(errors, "%s%s%s%s", path, ": ", strerror(errno), "\n");
+    return 0;
+  }
+  pch->is_inited = 1;
+  mem_clear(&message, sizeof(message));
+  sb_init(&message);
+  is_ok = pch_check(pch, hc, &message);
+  if (!is_ok) {
+    sb_append(errors, "%s%s%s%s", path, ": ", message.at, "\n");
+    for (i = 0; i < pch->num_headers; i++) {
+      if (pch->headers[i] != NULL) {
+        hc_free(pch->headers[i]);
+      }
+    }
+    pch_deinit(pch);
+  }
+  sb_deinit(&message);
+  if (!is_ok) {
+    return 0;
+  }
+  for (i = 0; i < pch->num_headers; i++) {
+    pch->headers[i] = hc_publish(hc, pch->headers[i],
+      pch->headers[i]->path_id
+    );
+  }
+  if (pch->num_headers > 0) {
+    pch->delta = pch->headers[0]->base - pch->first_base;
+  }
+  head = (const PCHHead *)pch->src.text.at;
+  pch->num_macros = (int)head->num_macros;
+  if (pch->num_macros > 0) {
+    pch->macros = mem_alloc(
+      mem_size_mul(pch->num_macros, sizeof(Macro))
+    );
+    pch->macro_ids = mem_alloc(
+      mem_size_mul(pch->num_macros, sizeof(int))
+    );
+  }
+  /* Shared by the units, which never change a macro. */
+  for (i = 0; i < pch->num_macros; i++) {
+    m = (const PCHMacro *)(pch->src.text.at + head->macros) + i;
+    macro = &pch->macros[i];
+    macro->header = m->file < 0 ? hc->builtin
+      : pch->headers[m->file];
+    macro->name = (int)m->name;
+    macro->first = (int)m->first;
+    macro->num_body = (int)m->num_body;
+    macro->params = NULL;
+    macro->num_params = (int)m->num_params;
+    if (m->num_params >= 0) {
+      macro->params = (int *)(pch->src.text.at + m->params);
+    }
+    pch->macro_ids[i] = (int)m->id;
+  }
+  stats = &G->phase_stats[PHASE_LOAD];
+  stats->seconds += time_now() - start;
+  stats->bytes += pch->src.text.length;
+  stats->items++;
+  return 1;
+}
+
+/*----------------------------------------------------------*/
+void
+pch_put_tokens(Writer *w, const Tokens *tokens, int count,
+  PCHTokens *to)
+{
+  pch_align(w);
+  to->kinds = w->length;
+  wr_write(w, (const char *)tokens->kinds, count);
+  pch_align(w);
+  to->flags = w->length;
+  wr_write(w, (const char *)tokens->flags, count);
+  pch_align(w);
+  to->offsets = w->length;
+  wr_write(w, (const char *)tokens->offsets, count * sizeof(int64));
+  pch_align(w);
+  to->lengths = w->length;
+  wr_write(w, (const char *)tokens->lengths, count * sizeof(int));
+  pch_align(w);
+  to->ids = w->length;
+  wr_write(w, (const char *)tokens->ids, count * sizeof(int));
+  to->count = count;
+}
+
+/*----------------------------------------------------------*/
+int
+pch_save(Preprocessor *pp, const char *path)
+{
+  HeaderCache *hc = NULL;
+  Interns *interns = NULL;
+  Header *header = NULL;
+  Macro *macro = NULL;
+  Writer w;
+  Vector strings;
+  Vector files;
+  Vector macros;
+  PCHHead head;
+  PCHString string;
+  PCHFile file;
+  PCHMacro m;
+  Strview text;
+  int num_strings = 0;
+  int zero = 0;
+  int is_ok = 0;
+  int id = 0;
+  int i = 0;
+  /**/
+  assert(pp != NULL);
+  assert(pp->is_inited);
+  assert(pp->writer == NULL);
+  assert(pp->out->count > 0);
+  assert(pp->out->kinds[pp->out->count - 1] == TK_EOF);
+  assert(path != NULL);
+  /**/
+  hc = pp->cache;
+  interns = hc->interns;
+  for (i = 1; i < hc->num_headers; i++) {
+    if (!hc->headers[i]->is_lex_ok) {
+      sb_append(&pp->errors, "%s%s%s%s", path,
+        ": cannot precompile '", hc->headers[i]->src.path.at,
+        "' with errors\n"
+      );
+      return 0;
+    }
+  }
+  mem_clear(&head, sizeof(head));
+  mem_clear(&w, sizeof(w));
+  mem_clear(&strings, sizeof(strings));
+  mem_clear(&files, sizeof(files));
+  mem_clear(&macros, sizeof(macros));
+  memcpy(head.magic, PCH_MAGIC, sizeof(head.magic));
+  wr_init(&w, -1);
+  wr_write(&w, (const char *)&head, sizeof(head));
+  vec_init(&strings, sizeof(PCHString), 0);
+  vec_init(&files, sizeof(PCHFile), 0);
+  vec_init(&macros, sizeof(PCHMacro), 0);
+  num_strings = ATOMIC_LOAD(&interns->num_strings);
+  for (id = 1; id < num_strings; id++) {
+    text = intern_view(interns, id);
+    string.at = w.length;
+    string.length = text.length;
+    wr_write(&w, text.at, text.length);
+    vec_push(&strings, &string);
+  }
+  /* The definitions of the host are rebuilt by `hc_init`. */
+  for (i = 1; i < hc->num_headers; i++) {
+    header = hc->headers[i];
+    mem_clear(&file, sizeof(file));
+    file.path_id = header->path_id;
+    file.base = header->base;
+    file.text = w.length;
+    file.text_length = header->src.text.length;
+    file.hash = sv_hash(header->src.text);
+    wr_write(&w, header->src.text.at, header->src.text.length);
+    pch_put_tokens(&w, &header->tokens, header->tokens.count,
+      &file.tokens
+    );
+    file.guard_id = header->guard_id;
+    file.marks = *pp_mark(pp, header);
+    vec_push(&files, &file);
+  }
+  for (id = 1; id < num_strings; id++) {
+    macro = map_get(&pp->macros, id);
+    if (macro == NULL || macro->header == NULL) {
+      continue;
+    }
+    mem_clear(&m, sizeof(m));
+    m.id = id;
+    m.file = macro->header->index - 1;
+    m.name = macro->name;
+    m.first = macro->first;
+    m.num_body = macro->num_body;
+    m.num_params = macro->num_params;
+    if (macro->num_params >= 0) {
+      pch_align(&w);
+      m.params = w.length;
+      wr_write(&w, (const char *)macro->params,
+        macro->num_params * sizeof(int)
+      );
+      wr_write(&w, (const char *)&zero, sizeof(zero));
+    }
+    vec_push(&macros, &m);
+  }
+  pch_put_tokens(&w, pp->out, pp->out->count - 1, &head.out);
+  head.scratch = w.length;
+  head.scratch_length = pp->scratch.length;
+  wr_write(&w, pp->scratch.at, pp->scratch.length);
+  pch_align(&w);
+  head.strings = w.length;
+  head.num_strings = strings.length;
+  wr_write(&w, strings.at, strings.length * sizeof(PCHString));
+  head.files = w.length;
+  head.num_files = files.length;
+  wr_write(&w, files.at, files.length * sizeof(PCHFile));
+  head.macros = w.length;
+  head.num_macros = macros.length;
+  wr_write(&w, macros.at, macros.length * sizeof(PCHMacro));
+  head.first_base = hc->num_headers > 1 ? hc->headers[1]->base
+    : hc->next_base;
+  head.options_hash = pch_hash_options(hc);
+  head.size = w.length;
+  memcpy(w.at, &head, sizeof(head));
+  head.checksum = sv_hash(sv_cut(sv_array(w.at, w.length),
+    offsetof(PCHHead, size)
+  ));
+  memcpy(w.at, &head, sizeof(head));
+  /* Saved whole, so no one maps half a file. */
+  is_ok = wr_save(path, w.at, w.length);
+  if (!is_ok) {
+    sb_append(&pp->errors, "%s%s%s%s", path, ": ", strerror(errno),
+      "\n"
+    );
+  }
+  vec_deinit(&macros);
+  vec_deinit(&files);
+  vec_deinit(&strings);
+  wr_deinit(&w);
+  return is_ok;
+}
+
+/*----------------------------------------------------------*/
+int
+pch_tokens(const PCH *pch, const PCHTokens *from, Tokens *tokens)
+{
+  int64 count = 0;
+  /**/
+  count = from->count;
+  mem_clear(tokens, sizeof(*tokens));
+  tokens->kinds = (unsigned char *)pch_at(pch, from->kinds, count, 1);
+  tokens->flags = (unsigned char *)pch_at(pch, from->flags, count, 1);
+  tokens->offsets = (int64 *)pch_at(pch, from->offsets, count,
+    sizeof(int64)
+  );
+  tokens->lengths = (int *)pch_at(pch, from->lengths, count,
+    sizeof(int)
+  );
+  tokens->ids = (int *)pch_at(pch, from->ids, count, sizeof(int));
+  if (tokens->kinds == NULL || tokens->flags == NULL
+      || tokens->offsets == NULL || tokens->lengths == NULL
+      || tokens->ids == NULL) {
+    return 0;
+  }
+  tokens->count = (int)count;
+  tokens->capacity = (int)count;
+  tokens->is_inited = 1;
+  return 1;
+}